@@ -0,0 +1,325 @@
+#include "PExpr.h"
+#include "internal/Lexer.h"
+#include "internal/Parser.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <new>
+
+using namespace PExpr;
+
+/* Every allocation of the process is counted to report allocations and bytes per node.
+ * Over-aligned allocations are not counted.
+ */
+static std::atomic<size_t> sAllocations{ 0 };
+static std::atomic<size_t> sAllocatedBytes{ 0 };
+
+// GCC sees through the replacement and wrongly assumes a mismatch between new and free
+#if defined(PEXPR_CC_GNU) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    sAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+/// A parameterized family of sources stressing a single aspect of the pipeline
+struct Corpus {
+    const char* Name;
+    std::function<std::string(size_t)> Generate;
+    std::vector<size_t> Sizes;
+};
+
+/// (((x+1)*2)-3)/4 ... nested size times
+static std::string generateDeep(size_t size)
+{
+    static const char* ops = "+*-/";
+
+    std::string src = "x";
+    for (size_t i = 0; i < size; ++i)
+        src = "(" + src + ops[i % 4] + std::to_string(i % 7 + 1) + ")";
+    return src;
+}
+
+/// mix(x, y, sin(x)) + cos(y*2) + ... with size calls
+static std::string generateCalls(size_t size)
+{
+    std::string src;
+    for (size_t i = 0; i < size; ++i) {
+        if (i > 0)
+            src += " + ";
+        src += (i % 2 == 0) ? "mix(x, y, sin(x))" : "cos(y*2)";
+    }
+    return src;
+}
+
+/// name == 'aaa...' || ... with size literals of 256 characters
+static std::string generateStrings(size_t size)
+{
+    std::string src;
+    for (size_t i = 0; i < size; ++i) {
+        if (i > 0)
+            src += " || ";
+        src += "name == '" + std::string(256, (char)('a' + i % 26)) + "'";
+    }
+    return src;
+}
+
+/// (((v.wzyx).xy).yx).x + (uv.yx).x + ... with size terms. Swizzles can only be chained via parentheses
+static std::string generateSwizzles(size_t size)
+{
+    std::string src;
+    for (size_t i = 0; i < size; ++i) {
+        if (i > 0)
+            src += " + ";
+        src += (i % 2 == 0) ? "(((v.wzyx).xy).yx).x" : "(uv.yx).x";
+    }
+    return src;
+}
+
+static size_t countNodes(const Ptr<Expression>& expr)
+{
+    switch (expr->type()) {
+    case ExpressionType::Unary:
+        return 1 + countNodes(static_cast<const UnaryExpression*>(expr.get())->inner());
+    case ExpressionType::Binary:
+        return 1 + countNodes(static_cast<const BinaryExpression*>(expr.get())->left()) + countNodes(static_cast<const BinaryExpression*>(expr.get())->right());
+    case ExpressionType::Call: {
+        size_t count = 1;
+        for (const auto& param : static_cast<const CallExpression*>(expr.get())->parameters())
+            count += countNodes(param);
+        return count;
+    }
+    case ExpressionType::Access:
+        return 1 + countNodes(static_cast<const AccessExpression*>(expr.get())->inner());
+    default:
+        return 1;
+    }
+}
+
+/// Visitor constructing a string of the transpiled operations, like a source generator for another language would do
+class DumpVisitor : public TranspileVisitor<std::string> {
+public:
+    std::string onVariable(const std::string& name, ElementaryType) override { return name; }
+    std::string onInteger(Integer v) override { return std::to_string(v); }
+    std::string onNumber(Number v) override { return std::to_string(v); }
+    std::string onBool(bool v) override { return v ? "true" : "false"; }
+    std::string onString(const std::string& v) override { return "'" + v + "'"; }
+    std::string onCast(const std::string& v, ElementaryType, ElementaryType) override { return "double(" + v + ")"; }
+    std::string onPosNeg(bool isNeg, ElementaryType, const std::string& v) override { return isNeg ? "-" + v : v; }
+    std::string onNot(const std::string& v) override { return "!" + v; }
+    std::string onAddSub(bool isSub, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + (isSub ? "-" : "+") + b + ")"; }
+    std::string onMulDiv(bool isDiv, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + (isDiv ? "/" : "*") + b + ")"; }
+    std::string onScale(bool isDiv, ElementaryType, const std::string& a, const std::string& f) override { return "(" + a + (isDiv ? "/" : "*") + f + ")"; }
+    std::string onPow(ElementaryType, const std::string& a, const std::string& f) override { return "pow(" + a + "," + f + ")"; }
+    std::string onMod(const std::string& a, const std::string& b) override { return "(" + a + "%" + b + ")"; }
+    std::string onAndOr(bool isOr, const std::string& a, const std::string& b) override { return "(" + a + (isOr ? "||" : "&&") + b + ")"; }
+    std::string onRelOp(RelationalOp, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + "<" + b + ")"; }
+    std::string onEqual(bool isNeg, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + (isNeg ? "!=" : "==") + b + ")"; }
+    std::string onFunctionCall(const std::string& name, ElementaryType, const std::vector<ElementaryType>&, const std::vector<std::string>& args) override
+    {
+        std::string str = name + "(";
+        for (size_t i = 0; i < args.size(); ++i)
+            str += (i > 0 ? "," : "") + args[i];
+        return str + ")";
+    }
+    std::string onAccess(const std::string& v, size_t, const std::vector<uint8>& permutation) override
+    {
+        std::string str = v + ".";
+        for (uint8 c : permutation)
+            str += "xyzw"[c];
+        return str;
+    }
+};
+
+struct Measurement {
+    double Nanoseconds;
+    double Allocations;
+    double Bytes;
+};
+
+/// Run the given function repeatedly for at least the given time and return the averages of a single run
+template <typename Func>
+static Measurement measure(double minSeconds, Func func)
+{
+    using Clock = std::chrono::steady_clock;
+
+    func(); // Warm up
+
+    const size_t allocations = sAllocations.load();
+    const size_t bytes       = sAllocatedBytes.load();
+    const auto start         = Clock::now();
+
+    size_t iterations = 0;
+    double elapsed    = 0;
+    do {
+        func();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    return Measurement{ elapsed * 1e9 / iterations,
+                        (double)(sAllocations.load() - allocations) / iterations,
+                        (double)(sAllocatedBytes.load() - bytes) / iterations };
+}
+
+/// Like measure(Func), but calls setup before each run without timing it or counting its allocations
+template <typename Setup, typename Func>
+static Measurement measure(double minSeconds, Setup setup, Func func)
+{
+    using Clock = std::chrono::steady_clock;
+
+    setup();
+    func(); // Warm up
+
+    size_t allocations = 0;
+    size_t bytes       = 0;
+    size_t iterations  = 0;
+    double elapsed     = 0;
+    do {
+        setup();
+
+        const size_t allocationsBefore = sAllocations.load();
+        const size_t bytesBefore       = sAllocatedBytes.load();
+        const auto start               = Clock::now();
+        func();
+        elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+        allocations += sAllocations.load() - allocationsBefore;
+        bytes += sAllocatedBytes.load() - bytesBefore;
+        ++iterations;
+    } while (elapsed < minSeconds);
+
+    return Measurement{ elapsed * 1e9 / iterations,
+                        (double)allocations / iterations,
+                        (double)bytes / iterations };
+}
+
+static void report(const char* corpus, size_t size, size_t nodes, const char* stage, const Measurement& m)
+{
+    std::cout << std::left << std::setw(10) << corpus
+              << std::right << std::setw(8) << size
+              << std::setw(10) << nodes << "  "
+              << std::left << std::setw(12) << stage
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << m.Nanoseconds / nodes
+              << std::setw(14) << m.Allocations / nodes
+              << std::setw(14) << m.Bytes / nodes
+              << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    double minSeconds = 0.25;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--quick")
+            minSeconds = 0.01;
+        else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [--quick] [corpus]" << std::endl;
+            return EXIT_SUCCESS;
+        } else
+            filter = arg;
+    }
+
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("y", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerVariable(VariableDef("v", ElementaryType::Vec4));
+    env.registerVariable(VariableDef("name", ElementaryType::String));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerNative("cos", [](Number v) { return std::cos(v); }, true);
+    env.registerNative("mix", [](Number a, Number b, Number t) { return a + (b - a) * t; }, true);
+
+    const std::vector<Corpus> corpora = {
+        { "deep", generateDeep, { 16, 256, 2048 } },
+        { "calls", generateCalls, { 16, 256, 4096 } },
+        { "strings", generateStrings, { 16, 256, 1024 } },
+        { "swizzles", generateSwizzles, { 16, 256, 4096 } },
+    };
+
+    const std::string nameValue = "bench";
+
+    std::cout << std::left << std::setw(10) << "corpus"
+              << std::right << std::setw(8) << "size"
+              << std::setw(10) << "nodes" << "  "
+              << std::left << std::setw(12) << "stage"
+              << std::right << std::setw(12) << "ns/node"
+              << std::setw(14) << "allocs/node"
+              << std::setw(14) << "bytes/node"
+              << std::endl;
+
+    for (const auto& corpus : corpora) {
+        if (!filter.empty() && filter != corpus.Name)
+            continue;
+
+        for (size_t size : corpus.Sizes) {
+            const std::string source = corpus.Generate(size);
+            const auto expr          = env.parse(source);
+            if (!expr) {
+                std::cerr << "Could not parse corpus " << corpus.Name << " of size " << size << std::endl;
+                return EXIT_FAILURE;
+            }
+            const size_t nodes = countNodes(expr);
+
+            report(corpus.Name, size, nodes, "lex", measure(minSeconds, [&]() {
+                       internal::Lexer lexer(source);
+                       while (lexer.next().Type != internal::TokenType::Eof)
+                           ;
+                   }));
+
+            report(corpus.Name, size, nodes, "parse", measure(minSeconds, [&]() {
+                       internal::Lexer lexer(source);
+                       internal::Parser parser(lexer);
+                       parser.parse();
+                   }));
+
+            // Each run checks a tree parsed without type checking, parsing it is not part of the timing
+            Ptr<Expression> unchecked;
+            report(corpus.Name, size, nodes, "typecheck", measure(minSeconds, [&]() { unchecked = env.parse(source, true); }, [&]() { env.doTypeChecking(unchecked); }));
+
+            report(corpus.Name, size, nodes, "stringify", measure(minSeconds, [&]() { StringVisitor::visit(expr); }));
+
+            DumpVisitor visitor;
+            report(corpus.Name, size, nodes, "transpile", measure(minSeconds, [&]() { env.transpile(expr, &visitor); }));
+
+            report(corpus.Name, size, nodes, "compile", measure(minSeconds, [&]() { env.compile(expr, NativeResolver()); }));
+
+            VirtualMachine vm(env.compile(expr, NativeResolver()));
+            const auto& program = vm.program();
+            for (size_t i = 0; i < program.variables().size(); ++i) {
+                switch (program.variables()[i].Type) {
+                case ElementaryType::Number:
+                    vm.setNumber(i, 0.5);
+                    break;
+                case ElementaryType::Vec2:
+                    vm.setVec2(i, Vec2{ 0.1, 0.2 });
+                    break;
+                case ElementaryType::Vec4:
+                    vm.setVec4(i, Vec4{ 0.1, 0.2, 0.3, 0.4 });
+                    break;
+                case ElementaryType::String:
+                    vm.setString(i, &nameValue);
+                    break;
+                default:
+                    break;
+                }
+            }
+            report(corpus.Name, size, nodes, "evaluate", measure(minSeconds, [&]() { vm.run(); }));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
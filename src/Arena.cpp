@@ -0,0 +1,55 @@
+#include "Arena.h"
+
+namespace PExpr {
+ExpressionArena::ExpressionArena(size_t blockSize)
+    : mBlocks()
+    , mDestructors()
+    , mBlockSize(std::max<size_t>(blockSize, 64))
+    , mCurrent(nullptr)
+    , mEnd(nullptr)
+    , mUsedBytes(0)
+{
+}
+
+ExpressionArena::~ExpressionArena()
+{
+    for (auto it = mDestructors.rbegin(); it != mDestructors.rend(); ++it)
+        it->second(it->first);
+
+    for (void* block : mBlocks)
+        ::operator delete(block);
+}
+
+void* ExpressionArena::allocateBlock(size_t size)
+{
+    void* block = ::operator new(size);
+    mBlocks.push_back(block);
+    return block;
+}
+
+void* ExpressionArena::allocate(size_t size, size_t alignment)
+{
+    PEXPR_ASSERT(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Over-aligned types are not supported");
+
+    const auto align = [=](uint8* ptr) {
+        return reinterpret_cast<uint8*>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    };
+
+    uint8* ptr = align(mCurrent);
+    if (mCurrent == nullptr || ptr + size > mEnd) {
+        // Large requests get their own block and keep the current block active
+        if (size > mBlockSize / 4) {
+            mUsedBytes += size;
+            return allocateBlock(size);
+        }
+
+        mCurrent = static_cast<uint8*>(allocateBlock(mBlockSize));
+        mEnd     = mCurrent + mBlockSize;
+        ptr      = align(mCurrent);
+    }
+
+    mCurrent = ptr + size;
+    mUsedBytes += size;
+    return ptr;
+}
+} // namespace PExpr
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "PExpr_Config.h"
+
+namespace PExpr {
+/// Simple bump allocator used to place whole expression trees into a few contiguous blocks.
+/// Nodes created in an arena have no control block of their own and reference their children without owning them.
+/// Trees are handed out as aliasing pointers sharing the control block of the arena, which therefore acts as the handle owning all its nodes.
+/// Once the last handle is gone, the arena destroys all its objects and releases its memory in a single step, without any per node reference counting.
+/// As a consequence, subtrees of a tree placed in an arena are only valid as long as a handle to the arena is alive.
+/// An arena is not threadsafe. Use one arena per thread.
+class ExpressionArena {
+public:
+    static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+    /// Creates an empty arena which allocates memory in blocks of the given size.
+    explicit ExpressionArena(size_t blockSize = DefaultBlockSize);
+    /// Releases all blocks at once.
+    ~ExpressionArena();
+
+    /// Returns memory of the given size and alignment. The memory is only released together with the arena.
+    void* allocate(size_t size, size_t alignment);
+
+    /// Constructs an object in the arena, which is destroyed together with the arena in reverse order of creation.
+    template <typename T, typename... Args>
+    inline T* create(Args&&... args)
+    {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            mDestructors.emplace_back(object, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+        return object;
+    }
+
+    /// Constructs an object in the arena and returns a pointer without control block, which does not keep the object alive.
+    /// Use shareOwnership() to hand it out.
+    template <typename T, typename... Args>
+    inline Ptr<T> createUnowned(Args&&... args)
+    {
+        return Ptr<T>(Ptr<T>(), create<T>(std::forward<Args>(args)...));
+    }
+
+    /// Number of blocks currently allocated.
+    inline size_t blockCount() const { return mBlocks.size(); }
+    /// Number of bytes handed out by allocate().
+    inline size_t usedBytes() const { return mUsedBytes; }
+
+private:
+    void* allocateBlock(size_t size);
+
+    std::vector<void*> mBlocks;
+    std::vector<std::pair<void*, void (*)(void*)>> mDestructors;
+    size_t mBlockSize;
+    uint8* mCurrent;
+    uint8* mEnd;
+    size_t mUsedBytes;
+
+    PEXPR_CLASS_NON_COPYABLE(ExpressionArena);
+};
+
+/// Returns the given object as an owning pointer. Objects without control block, e.g., created by ExpressionArena::createUnowned(), share the ownership of the given owner.
+template <typename T, typename U>
+inline Ptr<T> shareOwnership(const Ptr<U>& owner, const Ptr<T>& object)
+{
+    if (!object || object.use_count() != 0)
+        return object;
+    return Ptr<T>(owner, object.get());
+}
+
+/// Standard conform allocator forwarding to an expression arena.
+/// Deallocation is a no-op, the memory is released together with the arena.
+/// Each allocator keeps the arena alive, therefore it is safe to use with std::allocate_shared.
+/// Note that std::allocate_shared stores a copy of the allocator in each control block, prefer ExpressionArena::create() for many small objects.
+template <typename T>
+class ArenaAllocator {
+    template <typename U>
+    friend class ArenaAllocator;
+
+public:
+    using value_type = T;
+
+    inline explicit ArenaAllocator(const Ptr<ExpressionArena>& arena)
+        : mArena(arena)
+    {
+        PEXPR_ASSERT(arena != nullptr, "Expected a valid arena");
+    }
+
+    template <typename U>
+    inline ArenaAllocator(const ArenaAllocator<U>& other)
+        : mArena(other.mArena)
+    {
+    }
+
+    inline T* allocate(size_t n)
+    {
+        return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    inline void deallocate(T*, size_t)
+    {
+        // Nothing to do, the arena releases its memory at once
+    }
+
+    template <typename U>
+    inline bool operator==(const ArenaAllocator<U>& other) const { return mArena == other.mArena; }
+    template <typename U>
+    inline bool operator!=(const ArenaAllocator<U>& other) const { return mArena != other.mArena; }
+
+private:
+    Ptr<ExpressionArena> mArena;
+};
+} // namespace PExpr
@@ -0,0 +1,436 @@
+#include "BatchEvaluator.h"
+#include "internal/Simd.h"
+
+namespace PExpr {
+SimdLevel detectSimdLevel()
+{
+#ifdef PEXPR_ARCH_X64
+    static const SimdLevel level = internal::cpuSupportsAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// All kernels process the elements in increasing order and read each element before writing to the same index.
+// This allows the destination to overlap the operands, as long as the destination does not start after them.
+#define PEXPR_BINARY_KERNEL(Name, Target, Width, Load, Store, Op, ScalarOp)                    \
+    Target static void Name(Number* dst, const Number* a, const Number* b, size_t n)            \
+    {                                                                                           \
+        size_t i = 0;                                                                           \
+        for (; i + (Width) <= n; i += (Width))                                                  \
+            Store(dst + i, Op(Load(a + i), Load(b + i)));                                       \
+        for (; i < n; ++i)                                                                      \
+            dst[i] = a[i] ScalarOp b[i];                                                        \
+    }
+
+#define PEXPR_UNARY_KERNEL(Name, Target, Width, Load, Store, Op, ScalarOp) \
+    Target static void Name(Number* dst, const Number* a, size_t n)        \
+    {                                                                      \
+        size_t i = 0;                                                      \
+        for (; i + (Width) <= n; i += (Width))                             \
+            Store(dst + i, Op(Load(a + i)));                               \
+        for (; i < n; ++i)                                                 \
+            dst[i] = ScalarOp a[i];                                        \
+    }
+
+#define PEXPR_SCALAR_LOAD(p) (*(p))
+#define PEXPR_SCALAR_STORE(p, v) (*(p) = (v))
+#define PEXPR_SCALAR_ADD(a, b) ((a) + (b))
+#define PEXPR_SCALAR_SUB(a, b) ((a) - (b))
+#define PEXPR_SCALAR_MUL(a, b) ((a) * (b))
+#define PEXPR_SCALAR_DIV(a, b) ((a) / (b))
+#define PEXPR_SCALAR_NEG(a) (-(a))
+
+PEXPR_BINARY_KERNEL(addScalar, , 1, PEXPR_SCALAR_LOAD, PEXPR_SCALAR_STORE, PEXPR_SCALAR_ADD, +)
+PEXPR_BINARY_KERNEL(subScalar, , 1, PEXPR_SCALAR_LOAD, PEXPR_SCALAR_STORE, PEXPR_SCALAR_SUB, -)
+PEXPR_BINARY_KERNEL(mulScalar, , 1, PEXPR_SCALAR_LOAD, PEXPR_SCALAR_STORE, PEXPR_SCALAR_MUL, *)
+PEXPR_BINARY_KERNEL(divScalar, , 1, PEXPR_SCALAR_LOAD, PEXPR_SCALAR_STORE, PEXPR_SCALAR_DIV, /)
+PEXPR_UNARY_KERNEL(negScalar, , 1, PEXPR_SCALAR_LOAD, PEXPR_SCALAR_STORE, PEXPR_SCALAR_NEG, -)
+
+#ifdef PEXPR_ARCH_X64
+#define PEXPR_SSE2_NEG(a) _mm_xor_pd((a), _mm_set1_pd(-0.0))
+PEXPR_BINARY_KERNEL(addSSE2, , 2, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, +)
+PEXPR_BINARY_KERNEL(subSSE2, , 2, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd, -)
+PEXPR_BINARY_KERNEL(mulSSE2, , 2, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, *)
+PEXPR_BINARY_KERNEL(divSSE2, , 2, _mm_loadu_pd, _mm_storeu_pd, _mm_div_pd, /)
+PEXPR_UNARY_KERNEL(negSSE2, , 2, _mm_loadu_pd, _mm_storeu_pd, PEXPR_SSE2_NEG, -)
+
+#define PEXPR_AVX2_NEG(a) _mm256_xor_pd((a), _mm256_set1_pd(-0.0))
+PEXPR_BINARY_KERNEL(addAVX2, PEXPR_TARGET_AVX2, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, +)
+PEXPR_BINARY_KERNEL(subAVX2, PEXPR_TARGET_AVX2, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd, -)
+PEXPR_BINARY_KERNEL(mulAVX2, PEXPR_TARGET_AVX2, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, *)
+PEXPR_BINARY_KERNEL(divAVX2, PEXPR_TARGET_AVX2, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd, /)
+PEXPR_UNARY_KERNEL(negAVX2, PEXPR_TARGET_AVX2, 4, _mm256_loadu_pd, _mm256_storeu_pd, PEXPR_AVX2_NEG, -)
+#endif
+
+BatchEvaluator::BatchEvaluator(const Ptr<const Program>& program, const BatchNativeResolver& resolver, SimdLevel level)
+    : mProgram(program)
+    , mLevel(std::min(level, detectSimdLevel()))
+    , mKernels()
+    , mBatchNatives()
+    , mArgumentLanes()
+    , mInputs()
+    , mOutputs()
+    , mWorkspace()
+    , mThreadWorkspaces()
+{
+    switch (mLevel) {
+    default:
+    case SimdLevel::Scalar:
+        mKernels = Kernels{ addScalar, subScalar, mulScalar, divScalar, negScalar };
+        break;
+#ifdef PEXPR_ARCH_X64
+    case SimdLevel::SSE2:
+        mKernels = Kernels{ addSSE2, subSSE2, mulSSE2, divSSE2, negSSE2 };
+        break;
+    case SimdLevel::AVX2:
+        mKernels = Kernels{ addAVX2, subAVX2, mulAVX2, divAVX2, negAVX2 };
+        break;
+#endif
+    }
+
+    for (const auto& def : program->functions()) {
+        mBatchNatives.push_back(resolver ? resolver(def) : BatchNativeFunction());
+
+        size_t lanes = 0;
+        for (const auto& type : def.parameters())
+            lanes += typeArraySize(type);
+        mArgumentLanes.push_back(lanes);
+    }
+
+    size_t variableRegisters = 0;
+    for (const auto& var : program->variables())
+        variableRegisters += typeArraySize(var.Type);
+    mInputs.resize(variableRegisters, Column{ nullptr, ElementaryType::Unspecified });
+    mOutputs.fill(nullptr);
+
+    mWorkspace = createWorkspace();
+}
+
+BatchEvaluator::Workspace BatchEvaluator::createWorkspace() const
+{
+    Workspace workspace;
+    workspace.Registers.resize(mProgram->registerCount() * BlockSize, Cell{ 0 });
+
+    // Broadcast constants once
+    for (size_t i = 0; i < mProgram->constants().size(); ++i)
+        std::fill_n(workspace.column((uint32)i), BlockSize, mProgram->constants()[i]);
+
+    // Four columns for results, one for scalar operands and the arguments of a single record
+    const size_t maxLanes = mArgumentLanes.empty() ? 0 : *std::max_element(mArgumentLanes.begin(), mArgumentLanes.end());
+    workspace.Scratch.resize(5 * BlockSize + maxLanes, Cell{ 0 });
+
+    return workspace;
+}
+
+void BatchEvaluator::bindInput(size_t variable, size_t component, const Number* column)
+{
+    const auto& var = mProgram->variables().at(variable);
+    PEXPR_ASSERT(var.Type == ElementaryType::Number || isArray(var.Type), "Expected a 'num' or vector variable");
+    PEXPR_ASSERT(component < typeArraySize(var.Type), "Invalid component");
+    mInputs[var.Register - mProgram->constants().size() + component] = Column{ column, ElementaryType::Number };
+}
+
+void BatchEvaluator::bindInput(size_t variable, const Integer* column)
+{
+    const auto& var = mProgram->variables().at(variable);
+    PEXPR_ASSERT(var.Type == ElementaryType::Integer, "Expected an 'int' variable");
+    mInputs[var.Register - mProgram->constants().size()] = Column{ column, ElementaryType::Integer };
+}
+
+void BatchEvaluator::bindInput(size_t variable, const bool* column)
+{
+    const auto& var = mProgram->variables().at(variable);
+    PEXPR_ASSERT(var.Type == ElementaryType::Boolean, "Expected a 'bool' variable");
+    mInputs[var.Register - mProgram->constants().size()] = Column{ column, ElementaryType::Boolean };
+}
+
+void BatchEvaluator::bindInput(size_t variable, const std::string* column)
+{
+    const auto& var = mProgram->variables().at(variable);
+    PEXPR_ASSERT(var.Type == ElementaryType::String, "Expected a 'str' variable");
+    mInputs[var.Register - mProgram->constants().size()] = Column{ column, ElementaryType::String };
+}
+
+void BatchEvaluator::bindOutput(size_t component, Number* column)
+{
+    PEXPR_ASSERT(mProgram->resultType() == ElementaryType::Number || isArray(mProgram->resultType()), "Expected a 'num' or vector result");
+    PEXPR_ASSERT(component < typeArraySize(mProgram->resultType()), "Invalid component");
+    mOutputs[component] = column;
+}
+
+void BatchEvaluator::bindOutput(Integer* column)
+{
+    PEXPR_ASSERT(mProgram->resultType() == ElementaryType::Integer, "Expected an 'int' result");
+    mOutputs[0] = column;
+}
+
+void BatchEvaluator::bindOutput(bool* column)
+{
+    PEXPR_ASSERT(mProgram->resultType() == ElementaryType::Boolean, "Expected a 'bool' result");
+    mOutputs[0] = column;
+}
+
+void BatchEvaluator::evaluate(size_t begin, size_t count)
+{
+    evaluateRange(mWorkspace, begin, count);
+}
+
+void BatchEvaluator::evaluateParallel(size_t begin, size_t count, ThreadPool& pool, size_t chunkSize)
+{
+    // Thread 0 is the calling thread, which uses the default workspace
+    while (mThreadWorkspaces.size() + 1 < pool.threadCount())
+        mThreadWorkspaces.push_back(createWorkspace());
+
+    chunkSize = std::max<size_t>(1, (chunkSize + BlockSize - 1) / BlockSize) * BlockSize;
+    pool.parallelFor(count, chunkSize, [&](size_t b, size_t e, size_t thread) {
+        evaluateRange(thread == 0 ? mWorkspace : mThreadWorkspaces[thread - 1], begin + b, e - b);
+    });
+}
+
+void BatchEvaluator::evaluateRange(Workspace& workspace, size_t begin, size_t count) const
+{
+    const uint32 firstVariable = (uint32)mProgram->constants().size();
+    const uint32 resultLanes   = typeArraySize(mProgram->resultType());
+    const ElementaryType type  = mProgram->resultType();
+
+    const size_t end = begin + count;
+    for (size_t offset = begin; offset < end; offset += BlockSize) {
+        const size_t n = std::min(BlockSize, end - offset);
+
+        for (size_t i = 0; i < mInputs.size(); ++i) {
+            const auto& input = mInputs[i];
+            PEXPR_ASSERT(input.Data != nullptr, "Expected all inputs to be bound");
+
+            Cell* dst = workspace.column(firstVariable + (uint32)i);
+            switch (input.Type) {
+            default:
+            case ElementaryType::Number:
+                for (size_t k = 0; k < n; ++k)
+                    dst[k].Num = reinterpret_cast<const Number*>(input.Data)[offset + k];
+                break;
+            case ElementaryType::Integer:
+                for (size_t k = 0; k < n; ++k)
+                    dst[k].Int = reinterpret_cast<const Integer*>(input.Data)[offset + k];
+                break;
+            case ElementaryType::Boolean:
+                for (size_t k = 0; k < n; ++k)
+                    dst[k].Bool = reinterpret_cast<const bool*>(input.Data)[offset + k];
+                break;
+            case ElementaryType::String:
+                for (size_t k = 0; k < n; ++k)
+                    dst[k].Str = &reinterpret_cast<const std::string*>(input.Data)[offset + k];
+                break;
+            }
+        }
+
+        run(workspace, n);
+
+        for (uint32 c = 0; c < resultLanes; ++c) {
+            if (!mOutputs[c])
+                continue;
+
+            const Cell* src = workspace.column(mProgram->resultRegister() + c);
+            switch (type) {
+            default:
+                for (size_t k = 0; k < n; ++k)
+                    reinterpret_cast<Number*>(mOutputs[c])[offset + k] = src[k].Num;
+                break;
+            case ElementaryType::Integer:
+                for (size_t k = 0; k < n; ++k)
+                    reinterpret_cast<Integer*>(mOutputs[c])[offset + k] = src[k].Int;
+                break;
+            case ElementaryType::Boolean:
+                for (size_t k = 0; k < n; ++k)
+                    reinterpret_cast<bool*>(mOutputs[c])[offset + k] = src[k].Bool;
+                break;
+            }
+        }
+    }
+}
+
+// The scalar operand of a scale or power operation might be overwritten by the first component of the result, copy it away in this case
+const Number* BatchEvaluator::scalarOperand(Workspace& workspace, const Instruction& ins, size_t n) const
+{
+    const Cell* b = workspace.column(ins.B);
+    if (ins.B >= ins.Dst && ins.B < ins.Dst + ins.Lanes) {
+        Cell* copy = &workspace.Scratch[4 * BlockSize];
+        std::copy_n(b, n, copy);
+        b = copy;
+    }
+    return &b->Num;
+}
+
+template <typename Func>
+static inline void recordwise(Cell* dst, const Cell* a, const Cell* b, size_t n, Func func)
+{
+    for (size_t k = 0; k < n; ++k)
+        func(dst[k], a[k], b[k]);
+}
+
+void BatchEvaluator::run(Workspace& workspace, size_t n) const
+{
+    const auto nums = [](Cell* cells) { return &cells->Num; };
+
+    for (const Instruction& ins : mProgram->instructions()) {
+        Cell* dst     = workspace.column(ins.Dst);
+        const Cell* a = workspace.column(ins.A);
+        const Cell* b = workspace.column(ins.B);
+
+        switch (ins.Op) {
+        case OpCode::Move:
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                std::memmove(dst + l * BlockSize, a + l * BlockSize, n * sizeof(Cell));
+            break;
+        case OpCode::CastIntToNum:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell&) { d.Num = Number(x.Int); });
+            break;
+        case OpCode::NegInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell&) { d.Int = negateInteger(x.Int); });
+            break;
+        case OpCode::NegNum:
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                mKernels.Neg(nums(dst + l * BlockSize), &a[l * BlockSize].Num, n);
+            break;
+        case OpCode::Not:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell&) { d.Bool = !x.Bool; });
+            break;
+        case OpCode::AddInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = addInteger(x.Int, y.Int); });
+            break;
+        case OpCode::AddNum:
+            mKernels.Add(nums(dst), &a->Num, &b->Num, ins.Lanes * BlockSize - (BlockSize - n));
+            break;
+        case OpCode::SubInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = subtractInteger(x.Int, y.Int); });
+            break;
+        case OpCode::SubNum:
+            mKernels.Sub(nums(dst), &a->Num, &b->Num, ins.Lanes * BlockSize - (BlockSize - n));
+            break;
+        case OpCode::MulInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = multiplyInteger(x.Int, y.Int); });
+            break;
+        case OpCode::MulNum:
+            mKernels.Mul(nums(dst), &a->Num, &b->Num, ins.Lanes * BlockSize - (BlockSize - n));
+            break;
+        case OpCode::DivInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = divideInteger(x.Int, y.Int); });
+            break;
+        case OpCode::DivNum:
+            mKernels.Div(nums(dst), &a->Num, &b->Num, ins.Lanes * BlockSize - (BlockSize - n));
+            break;
+        case OpCode::ScaleNum: {
+            const Number* f = scalarOperand(workspace, ins, n);
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                mKernels.Mul(nums(dst + l * BlockSize), &a[l * BlockSize].Num, f, n);
+        } break;
+        case OpCode::DivScaleNum: {
+            const Number* f = scalarOperand(workspace, ins, n);
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                mKernels.Div(nums(dst + l * BlockSize), &a[l * BlockSize].Num, f, n);
+        } break;
+        case OpCode::PowInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = powerInteger(x.Int, y.Int); });
+            break;
+        case OpCode::PowNum: {
+            const Number* f = scalarOperand(workspace, ins, n);
+            for (uint8 l = 0; l < ins.Lanes; ++l) {
+                for (size_t k = 0; k < n; ++k)
+                    dst[l * BlockSize + k].Num = std::pow(a[l * BlockSize + k].Num, f[k]);
+            }
+        } break;
+        case OpCode::ModInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Int = moduloInteger(x.Int, y.Int); });
+            break;
+        case OpCode::And:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Bool && y.Bool; });
+            break;
+        case OpCode::Or:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Bool || y.Bool; });
+            break;
+        case OpCode::LessInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int < y.Int; });
+            break;
+        case OpCode::LessNum:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Num < y.Num; });
+            break;
+        case OpCode::GreaterInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int > y.Int; });
+            break;
+        case OpCode::GreaterNum:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Num > y.Num; });
+            break;
+        case OpCode::LessEqualInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int <= y.Int; });
+            break;
+        case OpCode::LessEqualNum:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Num <= y.Num; });
+            break;
+        case OpCode::GreaterEqualInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int >= y.Int; });
+            break;
+        case OpCode::GreaterEqualNum:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Num >= y.Num; });
+            break;
+        case OpCode::EqualBool:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Bool == y.Bool; });
+            break;
+        case OpCode::EqualInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int == y.Int; });
+            break;
+        case OpCode::EqualString:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = *x.Str == *y.Str; });
+            break;
+        case OpCode::NotEqualBool:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Bool != y.Bool; });
+            break;
+        case OpCode::NotEqualInt:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = x.Int != y.Int; });
+            break;
+        case OpCode::NotEqualString:
+            recordwise(dst, a, b, n, [](Cell& d, const Cell& x, const Cell& y) { d.Bool = *x.Str != *y.Str; });
+            break;
+        case OpCode::EqualNum:
+        case OpCode::NotEqualNum: {
+            const bool isNeg = ins.Op == OpCode::NotEqualNum;
+            for (size_t k = 0; k < n; ++k) {
+                bool res = true;
+                for (uint8 l = 0; l < ins.Lanes; ++l)
+                    res = res && a[l * BlockSize + k].Num == b[l * BlockSize + k].Num;
+                dst[k].Bool = isNeg ? !res : res;
+            }
+        } break;
+        case OpCode::Swizzle:
+            // Components of the result might overlap the input, therefore construct the result in the scratch area first
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                std::copy_n(a + ((ins.Extra >> (2 * l)) & 0x3) * BlockSize, n, &workspace.Scratch[l * BlockSize]);
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                std::copy_n(&workspace.Scratch[l * BlockSize], n, dst + l * BlockSize);
+            break;
+        case OpCode::Call: {
+            const auto& batchNative = mBatchNatives[ins.Extra];
+            if (batchNative) {
+                batchNative(a, workspace.Scratch.data(), n, BlockSize);
+            } else {
+                const auto& native = mProgram->natives()[ins.Extra];
+                const size_t lanes = mArgumentLanes[ins.Extra];
+                Cell* args         = &workspace.Scratch[5 * BlockSize];
+                for (size_t k = 0; k < n; ++k) {
+                    for (size_t l = 0; l < lanes; ++l)
+                        args[l] = a[l * BlockSize + k];
+
+                    Cell out[4];
+                    native(args, out);
+                    for (uint8 l = 0; l < ins.Lanes; ++l)
+                        workspace.Scratch[l * BlockSize + k] = out[l];
+                }
+            }
+
+            for (uint8 l = 0; l < ins.Lanes; ++l)
+                std::copy_n(&workspace.Scratch[l * BlockSize], n, dst + l * BlockSize);
+        } break;
+        }
+    }
+}
+} // namespace PExpr
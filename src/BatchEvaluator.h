@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Program.h"
+#include "ThreadPool.h"
+
+namespace PExpr {
+/// Instruction sets used by the batch evaluator.
+enum class SimdLevel {
+    Scalar, /// Plain loops, left to the compiler
+    SSE2,   /// Two lanes of 'num' per instruction
+    AVX2    /// Four lanes of 'num' per instruction
+};
+
+/// Returns the best instruction set supported by the current cpu.
+SimdLevel detectSimdLevel();
+
+/// Native implementation of a function working on many records at once.
+/// Component i of argument and result registers for record j is at index i*stride+j. Only the first count records are valid.
+using BatchNativeFunction = std::function<void(const Cell* args, Cell* result, size_t count, size_t stride)>;
+
+/// Callback returning a batch implementation for the given function definition or an empty function if none is available.
+/// Functions without a batch implementation fall back to the native function of the program, which is called once per record.
+using BatchNativeResolver = std::function<BatchNativeFunction(const FunctionDef& def)>;
+
+/// Evaluates a compiled program over many records given as structure of arrays.
+/// Each component of a variable is read from its own input column and each component of the result is written to its own output column.
+/// Records are processed in blocks, which keeps all registers of a block in cache. Operations on 'num' and vector types use SIMD kernels.
+/// An evaluator is not threadsafe, but multiple evaluators can share the same program.
+/// Use evaluateParallel() to split the records over multiple threads instead.
+class BatchEvaluator {
+public:
+    /// Number of records handled at once.
+    static constexpr size_t BlockSize = 64;
+    /// Default number of records handled by a single task of evaluateParallel().
+    static constexpr size_t DefaultChunkSize = 64 * BlockSize;
+
+    /// Creates an evaluator for the given program. The instruction set is limited to the one supported by the current cpu.
+    explicit BatchEvaluator(const Ptr<const Program>& program, const BatchNativeResolver& resolver = nullptr, SimdLevel level = detectSimdLevel());
+
+    /// The program evaluated.
+    inline const Program& program() const { return *mProgram; }
+    /// The instruction set in use.
+    inline SimdLevel simdLevel() const { return mLevel; }
+
+    /// Bind the column of the given component of a 'num' or vector variable, see Program::variableIndex.
+    void bindInput(size_t variable, size_t component, const Number* column);
+    /// Bind the column of an 'int' variable.
+    void bindInput(size_t variable, const Integer* column);
+    /// Bind the column of a 'bool' variable.
+    void bindInput(size_t variable, const bool* column);
+    /// Bind the column of a 'str' variable. The strings are referenced, not copied, and have to stay alive during evaluation.
+    void bindInput(size_t variable, const std::string* column);
+
+    /// Bind the output column of the given component of a 'num' or vector result.
+    void bindOutput(size_t component, Number* column);
+    /// Bind the output column of an 'int' result.
+    void bindOutput(Integer* column);
+    /// Bind the output column of a 'bool' result.
+    void bindOutput(bool* column);
+
+    /// Evaluate the records [0, count) of all bound columns.
+    inline void evaluate(size_t count) { evaluate(0, count); }
+    /// Evaluate the records [begin, begin+count) of all bound columns.
+    /// All inputs have to be bound in advance.
+    void evaluate(size_t begin, size_t count);
+
+    /// Evaluate the records [0, count) of all bound columns in parallel.
+    /// See evaluateParallel(size_t, size_t, ThreadPool&, size_t) for more information.
+    inline void evaluateParallel(size_t count, ThreadPool& pool, size_t chunkSize = DefaultChunkSize) { evaluateParallel(0, count, pool, chunkSize); }
+
+    /// Evaluate the records [begin, begin+count) of all bound columns in parallel.
+    /// The range is split into chunks of the given size, rounded up to a multiple of the block size, which are distributed over the threads of the pool.
+    /// All threads share the program and the bindings, but use their own registers. As each record is computed independently, the result is the same as for evaluate().
+    /// Batch natives and natives of the program have to be threadsafe.
+    void evaluateParallel(size_t begin, size_t count, ThreadPool& pool, size_t chunkSize = DefaultChunkSize);
+
+private:
+    // Registers and scratch area used by a single thread
+    struct Workspace {
+        std::vector<Cell> Registers;
+        std::vector<Cell> Scratch;
+
+        inline Cell* column(uint32 reg) { return &Registers[reg * BlockSize]; }
+    };
+
+    struct Column {
+        const void* Data;
+        ElementaryType Type;
+    };
+
+    struct Kernels {
+        void (*Add)(Number*, const Number*, const Number*, size_t);
+        void (*Sub)(Number*, const Number*, const Number*, size_t);
+        void (*Mul)(Number*, const Number*, const Number*, size_t);
+        void (*Div)(Number*, const Number*, const Number*, size_t);
+        void (*Neg)(Number*, const Number*, size_t);
+    };
+
+    Workspace createWorkspace() const;
+    void evaluateRange(Workspace& workspace, size_t begin, size_t count) const;
+    void run(Workspace& workspace, size_t n) const;
+    const Number* scalarOperand(Workspace& workspace, const Instruction& ins, size_t n) const;
+
+    Ptr<const Program> mProgram;
+    SimdLevel mLevel;
+    Kernels mKernels;
+    std::vector<BatchNativeFunction> mBatchNatives;
+    std::vector<size_t> mArgumentLanes;
+
+    std::vector<Column> mInputs; // One column per component of all variables
+    std::array<void*, 4> mOutputs;
+
+    Workspace mWorkspace;
+    std::vector<Workspace> mThreadWorkspaces;
+};
+} // namespace PExpr
@@ -0,0 +1,89 @@
+#include "Bindings.h"
+
+namespace PExpr {
+uint32 VariableLayout::add(const VariableDef& def)
+{
+    const auto it = mSlotMap.find(def.name());
+    if (it != mSlotMap.end())
+        return mVariables[it->second].type() == def.type() ? it->second : InvalidSlot;
+
+    const uint32 slot = (uint32)mVariables.size();
+    mVariables.push_back(def);
+    mOffsets.push_back((uint32)mCellCount);
+    mCellCount += typeArraySize(def.type());
+    mSlotMap.emplace(def.name(), slot);
+    return slot;
+}
+
+bool VariableLayout::assign(const Ptr<Expression>& expr)
+{
+    return assign(expr.get());
+}
+
+bool VariableLayout::assign(Expression* expr)
+{
+    switch (expr->type()) {
+    default:
+    case ExpressionType::Error:
+        return false;
+    case ExpressionType::Literal:
+        return true;
+    case ExpressionType::Variable: {
+        const auto var = static_cast<VariableExpression*>(expr);
+        if (!var->definition().has_value())
+            return false;
+        var->mSlot = add(var->definition().value());
+        return var->mSlot != InvalidSlot;
+    }
+    case ExpressionType::Unary:
+        return assign(static_cast<UnaryExpression*>(expr)->inner().get());
+    case ExpressionType::Binary: {
+        const auto bin = static_cast<BinaryExpression*>(expr);
+        // Do not stop early, as all other variables should be assigned anyway
+        const bool left  = assign(bin->left().get());
+        const bool right = assign(bin->right().get());
+        return left && right;
+    }
+    case ExpressionType::Call: {
+        bool res = true;
+        for (const auto& param : static_cast<CallExpression*>(expr)->parameters())
+            res = assign(param.get()) && res;
+        return res;
+    }
+    case ExpressionType::Access:
+        return assign(static_cast<AccessExpression*>(expr)->inner().get());
+    }
+}
+
+bool VariableLayout::assign(FlatExpression& expr)
+{
+    bool res = true;
+    for (const auto& node : expr.nodes()) {
+        if (node.Type != ExpressionType::Variable)
+            continue;
+
+        if (node.Definition == FlatExpression::InvalidIndex) {
+            res = false;
+            continue;
+        }
+
+        const uint32 slot                    = add(expr.mVariableDefs[node.Definition]);
+        expr.mVariableSlots[node.Definition] = slot;
+        res                                  = res && slot != InvalidSlot;
+    }
+    return res;
+}
+
+uint32 VariableLayout::slot(const std::string& name) const
+{
+    const auto it = mSlotMap.find(name);
+    return it != mSlotMap.end() ? it->second : InvalidSlot;
+}
+
+Bindings::Bindings(const Ptr<const VariableLayout>& layout)
+    : mLayout(layout)
+    , mCells(layout->cellCount())
+{
+    std::memset(mCells.data(), 0, mCells.size() * sizeof(Cell));
+}
+} // namespace PExpr
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "FlatExpression.h"
+#include "Program.h"
+
+namespace PExpr {
+/// Dense mapping of variables to slots.
+/// Assigning a type checked expression to a layout stores the slot of each variable inside the expression.
+/// Multiple expressions can share the same layout, variables with the same name share the same slot.
+class VariableLayout {
+public:
+    /// Slot of variables not part of the layout.
+    static constexpr uint32 InvalidSlot = VariableExpression::InvalidSlot;
+
+    /// Add a variable and return its slot. If a variable with the same name exists already, its slot is returned.
+    /// InvalidSlot is returned if the existing variable has a different type.
+    uint32 add(const VariableDef& def);
+
+    /// Assign slots to all variables of the given type checked expression.
+    /// Returns false if a variable was not type checked or conflicts with an existing variable.
+    bool assign(const Ptr<Expression>& expr);
+    /// Assign slots to all variable nodes of the given type checked flat expression.
+    /// See assign(const Ptr<Expression>&) for more information.
+    bool assign(FlatExpression& expr);
+
+    /// The slot of the variable with the given name or InvalidSlot if not part of the layout.
+    uint32 slot(const std::string& name) const;
+
+    /// Number of slots.
+    inline size_t size() const { return mVariables.size(); }
+    /// The variable of the given slot.
+    inline const VariableDef& variable(uint32 slot) const { return mVariables[slot]; }
+    /// Offset of the first cell of the given slot. Vector types occupy one cell for each component.
+    inline uint32 cellOffset(uint32 slot) const { return mOffsets[slot]; }
+    /// Number of cells required for all slots.
+    inline size_t cellCount() const { return mCellCount; }
+
+private:
+    bool assign(Expression* expr);
+
+    std::vector<VariableDef> mVariables;
+    std::vector<uint32> mOffsets;
+    size_t mCellCount = 0;
+    std::unordered_map<std::string, uint32> mSlotMap;
+};
+
+/// Values of all variables of a layout, stored in a flat array indexed by slot.
+/// Changing a value is a single store, no names are involved.
+/// The layout must not be extended after the bindings are created.
+class Bindings {
+public:
+    /// Creates bindings for all slots of the given layout. All values are zero initialized.
+    explicit Bindings(const Ptr<const VariableLayout>& layout);
+
+    /// The layout of the bindings.
+    inline const VariableLayout& layout() const { return *mLayout; }
+
+    /// Set the value of the given slot.
+    inline void setBool(uint32 slot, bool v) { cells(slot)[0].Bool = v; }
+    inline void setInteger(uint32 slot, Integer v) { cells(slot)[0].Int = v; }
+    inline void setNumber(uint32 slot, Number v) { cells(slot)[0].Num = v; }
+    inline void setVec2(uint32 slot, const Vec2& v) { setLanes(slot, v.data(), 2); }
+    inline void setVec3(uint32 slot, const Vec3& v) { setLanes(slot, v.data(), 3); }
+    inline void setVec4(uint32 slot, const Vec4& v) { setLanes(slot, v.data(), 4); }
+    /// The string has to be valid while the bindings are used.
+    inline void setString(uint32 slot, const std::string* v) { cells(slot)[0].Str = v; }
+
+    /// Get the value of the given slot.
+    inline bool getBool(uint32 slot) const { return cells(slot)[0].Bool; }
+    inline Integer getInteger(uint32 slot) const { return cells(slot)[0].Int; }
+    inline Number getNumber(uint32 slot) const { return cells(slot)[0].Num; }
+    inline Vec2 getVec2(uint32 slot) const { return Vec2{ cells(slot)[0].Num, cells(slot)[1].Num }; }
+    inline Vec3 getVec3(uint32 slot) const { return Vec3{ cells(slot)[0].Num, cells(slot)[1].Num, cells(slot)[2].Num }; }
+    inline Vec4 getVec4(uint32 slot) const { return Vec4{ cells(slot)[0].Num, cells(slot)[1].Num, cells(slot)[2].Num, cells(slot)[3].Num }; }
+    inline const std::string& getString(uint32 slot) const { return *cells(slot)[0].Str; }
+
+    /// Cells of the given slot.
+    inline Cell* cells(uint32 slot)
+    {
+        PEXPR_ASSERT(slot < mLayout->size(), "Invalid slot");
+        return &mCells[mLayout->cellOffset(slot)];
+    }
+
+    /// Cells of the given slot.
+    inline const Cell* cells(uint32 slot) const
+    {
+        PEXPR_ASSERT(slot < mLayout->size(), "Invalid slot");
+        return &mCells[mLayout->cellOffset(slot)];
+    }
+
+private:
+    inline void setLanes(uint32 slot, const Number* v, size_t lanes)
+    {
+        Cell* dst = cells(slot);
+        for (size_t i = 0; i < lanes; ++i)
+            dst[i].Num = v[i];
+    }
+
+    Ptr<const VariableLayout> mLayout;
+    std::vector<Cell> mCells;
+};
+} // namespace PExpr
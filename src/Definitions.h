@@ -31,11 +31,18 @@ private:
 /// A general purpose function definition with a fixed signature.
 class FunctionDef {
 public:
+    /// Index used by functions without a bound native implementation.
+    static constexpr size_t NoNative = ~size_t(0);
+
     /// Construct a function definition with a given name, return type and parameter types.
-    inline FunctionDef(const std::string& name, ElementaryType retType, const std::vector<ElementaryType>& params)
+    /// The optional native index refers to an implementation bound via Environment::registerNative.
+    /// A pure function only depends on its arguments and has no side effects, which allows calls with constant arguments to be folded.
+    inline FunctionDef(const std::string& name, ElementaryType retType, const std::vector<ElementaryType>& params, size_t nativeIndex = NoNative, bool pure = false)
         : mName(name)
         , mReturnType(retType)
         , mParameters(params)
+        , mNativeIndex(nativeIndex)
+        , mPure(pure)
     {
         PEXPR_ASSERT(retType != ElementaryType::Unspecified, "Expected a specified type for an external definition");
     }
@@ -46,11 +53,19 @@ public:
     inline ElementaryType returnType() const { return mReturnType; }
     /// The all parameter types the function has to be called with.
     inline const std::vector<ElementaryType>& parameters() const { return mParameters; }
+    /// Index of the bound native implementation or NoNative if the function is not bound.
+    inline size_t nativeIndex() const { return mNativeIndex; }
+    /// True if a native implementation is bound to the function.
+    inline bool hasNative() const { return mNativeIndex != NoNative; }
+    /// True if the function only depends on its arguments and has no side effects.
+    inline bool isPure() const { return mPure; }
 
 private:
     std::string mName;
     ElementaryType mReturnType;
     std::vector<ElementaryType> mParameters;
+    size_t mNativeIndex;
+    bool mPure;
 };
 
 } // namespace PExpr
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Location.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace PExpr {
+/// A single message emitted while lexing, parsing or type checking an expression.
+struct Diagnostic {
+    LogLevel Level;
+    PExpr::Location Location;
+    std::string Message;
+};
+
+/// Receiver of diagnostics of a single call, e.g., Environment::parse.
+/// In contrary to the global logger, a sink is only used by the call it is given to and requires no synchronization.
+class DiagnosticSink {
+public:
+    DiagnosticSink()          = default;
+    virtual ~DiagnosticSink() = default;
+
+    virtual void report(const Diagnostic& diagnostic) = 0;
+};
+
+/// Simple sink collecting all diagnostics.
+class DiagnosticList : public DiagnosticSink {
+public:
+    inline void report(const Diagnostic& diagnostic) override { mEntries.push_back(diagnostic); }
+
+    /// All collected diagnostics in the order of occurrence.
+    inline const std::vector<Diagnostic>& entries() const { return mEntries; }
+    /// True if at least one diagnostic is an error.
+    inline bool hasError() const
+    {
+        return std::any_of(mEntries.begin(), mEntries.end(), [](const Diagnostic& d) { return d.Level >= LogLevel::Error; });
+    }
+    /// Remove all collected diagnostics.
+    inline void clear() { mEntries.clear(); }
+
+private:
+    std::vector<Diagnostic> mEntries;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Diagnostic& diagnostic)
+{
+    os << diagnostic.Location << ": " << diagnostic.Message;
+    return os;
+}
+} // namespace PExpr
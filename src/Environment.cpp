@@ -1,8 +1,14 @@
 #include "Environment.h"
+#include "internal/Compiler.h"
 #include "internal/DefContainer.h"
+#include "internal/MappedFile.h"
+#include "internal/Optimizer.h"
 #include "internal/Parser.h"
+#include "internal/Serializer.h"
 #include "internal/TypeChecker.h"
 
+#include <fstream>
+
 namespace PExpr {
 Environment::Environment()
     : mDefinitions()
@@ -13,6 +19,26 @@ Environment::~Environment()
 {
 }
 
+void Environment::registerVariable(const VariableDef& def)
+{
+    mDefinitions.addVariable(def);
+}
+
+void Environment::registerFunction(const FunctionDef& def)
+{
+    mDefinitions.addFunction(def);
+}
+
+const NativeFunction& Environment::native(size_t index) const
+{
+    return mDefinitions.native(index);
+}
+
+size_t Environment::nativeCount() const
+{
+    return mDefinitions.nativeCount();
+}
+
 void Environment::registerVariableLookupFunction(const VariableLookupFunction& cb)
 {
     mDefinitions.addVariableLookupFunction(cb);
@@ -23,38 +49,292 @@ void Environment::registerFunctionLookupFunction(const FunctionLookupFunction& c
     mDefinitions.addFunctionLookupFunction(cb);
 }
 
-Ptr<Expression> Environment::parse(std::istream& stream, bool skipTypeChecking) const
+void Environment::enableFunctionCache(bool b)
+{
+    mDefinitions.functionCache().setEnabled(b);
+    if (!b)
+        mDefinitions.functionCache().clear();
+}
+
+bool Environment::isFunctionCacheEnabled() const
+{
+    return mDefinitions.functionCache().isEnabled();
+}
+
+void Environment::clearFunctionCache()
+{
+    mDefinitions.functionCache().clear();
+}
+
+FunctionCacheStatistics Environment::functionCacheStatistics() const
+{
+    return mDefinitions.functionCache().statistics();
+}
+
+void Environment::resetFunctionCacheStatistics()
+{
+    mDefinitions.functionCache().resetStatistics();
+}
+
+void Environment::enableStatistics(bool b)
 {
-    internal::Lexer lexer(stream);
-    internal::Parser parser(lexer);
+    mDefinitions.statistics().setEnabled(b);
+}
+
+bool Environment::isStatisticsEnabled() const
+{
+    return mDefinitions.statistics().isEnabled();
+}
+
+EnvironmentStatistics Environment::statistics() const
+{
+    return mDefinitions.statistics().snapshot();
+}
+
+void Environment::resetStatistics()
+{
+    mDefinitions.statistics().reset();
+}
+
+void Environment::setTraceRecorder(const Ptr<TraceRecorder>& recorder, bool traceLookups)
+{
+    mDefinitions.setTraceRecorder(recorder, traceLookups);
+}
+
+const Ptr<TraceRecorder>& Environment::traceRecorder() const
+{
+    return mDefinitions.traceRecorder();
+}
+
+static Ptr<Expression> parseFromLexer(const Environment& env, internal::Lexer& lexer, const ParseOptions& options, const internal::StatisticsCollector& stats)
+{
+    using Collector = internal::StatisticsCollector;
+
+    // The span contains the type checking and is tagged with the returned root and the number of parsed nodes
+    internal::TraceSpan span(env.traceRecorder().get(), "parse");
+
+    // Interned trees are copied into the pool, the temporary tree does not need an arena
+    internal::Parser parser(lexer, options.Interner ? nullptr : options.Arena, options.Diagnostics);
+
+    const bool timed = stats.isEnabled();
+    lexer.setTimed(timed);
+    const auto start = timed ? Collector::Clock::now() : Collector::Clock::time_point();
 
     auto expr = parser.parse();
 
-    if (!expr || parser.hasError())
+    if (timed) {
+        // The parser pulls the tokens, therefore the time spent in the lexer is contained in the measured time
+        const uint64 elapsed = Collector::elapsedNanoseconds(start);
+        const uint64 lexing  = std::min(elapsed, lexer.elapsedNanoseconds());
+        stats.add(Collector::LexTime, lexing);
+        stats.add(Collector::ParseTime, elapsed - lexing);
+        stats.add(Collector::Tokens, lexer.tokenCount());
+        stats.add(Collector::Nodes, parser.nodeCount());
+    }
+
+    span.setExpression(nullptr, parser.nodeCount());
+
+    if (!expr || parser.hasError()) {
+        stats.increment(Collector::Errors);
         return nullptr;
+    }
 
-    if (!skipTypeChecking) {
-        if (!doTypeChecking(expr))
+    if (!options.SkipTypeChecking) {
+        if (!env.doTypeChecking(expr, options.Diagnostics))
             return nullptr;
     }
 
+    if (options.Interner)
+        expr = options.Interner->intern(expr);
+
+    span.setExpression(expr.get(), parser.nodeCount());
     return expr;
 }
 
+Ptr<Expression> Environment::parse(std::istream& stream, const ParseOptions& options) const
+{
+    internal::Lexer lexer(stream, options.Diagnostics);
+    return parseFromLexer(*this, lexer, options, mDefinitions.statistics());
+}
+
+Ptr<Expression> Environment::parse(std::string_view str, const ParseOptions& options) const
+{
+    internal::Lexer lexer(str, options.Diagnostics);
+    return parseFromLexer(*this, lexer, options, mDefinitions.statistics());
+}
+
+Ptr<Expression> Environment::parse(std::istream& stream, bool skipTypeChecking) const
+{
+    ParseOptions options;
+    options.SkipTypeChecking = skipTypeChecking;
+    return parse(stream, options);
+}
+
 Ptr<Expression> Environment::parse(const std::string& str, bool skipTypeChecking) const
 {
-    std::stringstream stream(str);
-    return parse(stream, skipTypeChecking);
+    return parse(std::string_view(str), skipTypeChecking);
+}
+
+Ptr<Expression> Environment::parse(std::string_view str, bool skipTypeChecking) const
+{
+    ParseOptions options;
+    options.SkipTypeChecking = skipTypeChecking;
+    return parse(str, options);
+}
+
+Ptr<Expression> Environment::parse(std::string_view str, const Ptr<ExpressionArena>& arena, bool skipTypeChecking) const
+{
+    ParseOptions options;
+    options.SkipTypeChecking = skipTypeChecking;
+    options.Arena            = arena;
+    return parse(str, options);
+}
+
+Ptr<Expression> Environment::parse(const char* str, bool skipTypeChecking) const
+{
+    return parse(std::string_view(str), skipTypeChecking);
+}
+
+Ptr<Expression> Environment::parse(const char* str, size_t size, bool skipTypeChecking) const
+{
+    return parse(std::string_view(str, size), skipTypeChecking);
+}
+
+std::vector<BatchParseResult> Environment::parseBatch(const std::string_view* sources, size_t count, const BatchParseOptions& options) const
+{
+    std::vector<BatchParseResult> results(count);
+    if (count == 0)
+        return results;
+
+    std::unique_ptr<ThreadPool> ownPool;
+    ThreadPool* pool = options.Pool;
+    if (!pool) {
+        ownPool = std::make_unique<ThreadPool>(std::min(count, options.ThreadCount > 0 ? options.ThreadCount : (size_t)std::thread::hardware_concurrency()));
+        pool    = ownPool.get();
+    }
+
+    // Small chunks keep the batch balanced if a few sources are much larger than the rest
+    const size_t chunkSize = std::max<size_t>(1, count / (pool->threadCount() * 16));
+    pool->parallelFor(count, chunkSize, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            ParseOptions parseOptions;
+            parseOptions.SkipTypeChecking = options.SkipTypeChecking;
+            parseOptions.Interner         = options.Interner;
+            parseOptions.Diagnostics      = &results[i].Diagnostics;
+            results[i].Expression         = parse(sources[i], parseOptions);
+        }
+    });
+
+    return results;
+}
+
+std::vector<BatchParseResult> Environment::parseBatch(const std::vector<std::string_view>& sources, const BatchParseOptions& options) const
+{
+    return parseBatch(sources.data(), sources.size(), options);
 }
 
-bool Environment::doTypeChecking(const Ptr<Expression>& expr) const
+std::string Environment::serialize(const std::vector<Ptr<Expression>>& exprs)
 {
-    internal::TypeChecker checker(mDefinitions);
+    internal::Serializer serializer;
+    for (const auto& expr : exprs)
+        serializer.add(expr);
+    return serializer.finish();
+}
+
+bool Environment::serializeToFile(const std::filesystem::path& path, const std::vector<Ptr<Expression>>& exprs)
+{
+    const std::string data = serialize(exprs);
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream.write(data.data(), (std::streamsize)data.size());
+    return (bool)stream;
+}
+
+std::optional<std::vector<Ptr<Expression>>> Environment::deserialize(std::string_view data, const ParseOptions& options) const
+{
+    internal::Deserializer deserializer(mDefinitions, options.Interner ? nullptr : options.Arena, !options.UseStoredDefinitions, options.Diagnostics);
+    auto exprs = deserializer.handle(data);
+
+    if (!exprs.has_value())
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
+    else if (options.Interner) {
+        for (auto& expr : exprs.value())
+            expr = options.Interner->intern(expr);
+    }
+
+    return exprs;
+}
+
+std::optional<std::vector<Ptr<Expression>>> Environment::deserializeFile(const std::filesystem::path& path, const ParseOptions& options) const
+{
+    const internal::MappedFile file(path);
+    if (!file.isValid()) {
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
+        internal::Reporter(options.Diagnostics).error(Location(0)) << "Can not open file " << path;
+        return {};
+    }
+
+    return deserialize(file.data(), options);
+}
+
+bool Environment::doTypeChecking(const Ptr<Expression>& expr, DiagnosticSink* diagnostics) const
+{
+    const internal::StatisticsCollector::ScopedTimer timer(mDefinitions.statistics(), internal::StatisticsCollector::TypeCheckTime);
+    internal::TraceSpan span(mDefinitions.traceRecorder().get(), "typecheck");
+    span.setExpression(expr.get());
+
+    internal::TypeChecker checker(mDefinitions, diagnostics);
     auto retType = checker.handle(expr);
-    if (retType == ElementaryType::Unspecified)
+    if (retType == ElementaryType::Unspecified) {
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
         return false;
+    }
 
     expr->setReturnType(retType);
     return true;
 }
-} // namespace PExpr
+
+bool Environment::doTypeChecking(FlatExpression& expr, DiagnosticSink* diagnostics) const
+{
+    const internal::StatisticsCollector::ScopedTimer timer(mDefinitions.statistics(), internal::StatisticsCollector::TypeCheckTime);
+    internal::TraceSpan span(mDefinitions.traceRecorder().get(), "typecheck");
+    span.setExpression(&expr, expr.size());
+
+    internal::TypeChecker checker(mDefinitions, diagnostics);
+    if (checker.handle(expr) == ElementaryType::Unspecified) {
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
+        return false;
+    }
+    return true;
+}
+
+Ptr<Expression> Environment::optimize(const Ptr<Expression>& expr, const OptimizeOptions& options) const
+{
+    PEXPR_ASSERT(expr->returnType() != ElementaryType::Unspecified, "Expected a type checked expression");
+
+    internal::Optimizer optimizer(mDefinitions, options.Resolver, options.FoldConstants, options.SimplifyIdentities);
+    return optimizer.handle(expr);
+}
+
+Ptr<Program> Environment::compile(const Ptr<Expression>& expr, const NativeResolver& resolver, DiagnosticSink* diagnostics) const
+{
+    PEXPR_ASSERT(expr->returnType() != ElementaryType::Unspecified, "Expected a type checked expression");
+
+    internal::BytecodeCompiler compiler(mDefinitions, resolver, diagnostics);
+    auto program = compiler.finish(transpile(expr, &compiler));
+    if (!program)
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
+    return program;
+}
+
+Ptr<Program> Environment::compile(const FlatExpression& expr, const NativeResolver& resolver, DiagnosticSink* diagnostics) const
+{
+    PEXPR_ASSERT(expr.returnType() != ElementaryType::Unspecified, "Expected a type checked expression");
+
+    internal::BytecodeCompiler compiler(mDefinitions, resolver, diagnostics);
+    auto program = compiler.finish(transpile(expr, &compiler));
+    if (!program)
+        mDefinitions.statistics().increment(internal::StatisticsCollector::Errors);
+    return program;
+}
+} // namespace PExpr
\ No newline at end of file
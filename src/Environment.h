@@ -1,11 +1,77 @@
 #pragma once
 
-#include "Lookup.h"
+#include "Arena.h"
+#include "Diagnostics.h"
 #include "Expression.h"
+#include "ExpressionInterner.h"
+#include "FlatExpression.h"
+#include "Lookup.h"
+#include "NativeBinding.h"
+#include "Program.h"
+#include "Statistics.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "TranspileCache.h"
 #include "internal/Transpiler.h"
 
 namespace PExpr {
+/// Options for a single parse call.
+struct ParseOptions {
+    /// If true, no typechecking will be performed and no variables or functions have to be defined in advance.
+    bool SkipTypeChecking = false;
+    /// Optional arena all nodes of the resulting AST tree are placed in.
+    /// The returned tree shares the ownership of the arena, subtrees are only valid as long as it is alive, see ExpressionArena.
+    Ptr<ExpressionArena> Arena;
+    /// Optional pool the resulting AST tree is interned into after type checking. Identical subtrees of all expressions parsed with the same pool share their nodes.
+    Ptr<ExpressionInterner> Interner;
+    /// Optional sink receiving all diagnostics of the call. If not set, the global logger is used.
+    DiagnosticSink* Diagnostics = nullptr;
+    /// Only used by Environment::deserialize. If true, the definitions stored with the trees are used instead of resolving them against the environment.
+    /// Stored functions have no native implementation bound.
+    bool UseStoredDefinitions = false;
+};
+
+/// Options for parsing multiple sources at once.
+struct BatchParseOptions {
+    /// If true, no typechecking will be performed and no variables or functions have to be defined in advance.
+    bool SkipTypeChecking = false;
+    /// Number of threads used if no pool is given. If zero, the number of hardware threads is used.
+    size_t ThreadCount = 0;
+    /// Optional pool to use. Sharing a pool between calls prevents repeated thread creation.
+    ThreadPool* Pool = nullptr;
+    /// Optional pool all resulting AST trees are interned into, see ParseOptions::Interner.
+    Ptr<ExpressionInterner> Interner;
+};
+
+/// Result of a single source parsed by Environment::parseBatch.
+struct BatchParseResult {
+    /// The resulting AST tree or nullptr if an error was detected.
+    Ptr<PExpr::Expression> Expression;
+    /// All diagnostics reported while parsing the source.
+    DiagnosticList Diagnostics;
+};
+
+/// Options for transpiling a type checked expression.
+struct TranspileOptions {
+    /// Transpile structurally identical subtrees only once and reuse them via TranspileVisitor::onTemporary and TranspileVisitor::onTemporaryRef.
+    /// Calls to functions not flagged pure are never merged.
+    bool EliminateCommonSubexpressions = false;
+};
+
+/// Options for the optimization of a type checked expression.
+struct OptimizeOptions {
+    /// Evaluate constant subtrees, including swizzles of constant vectors and calls to pure functions with constant arguments.
+    bool FoldConstants = true;
+    /// Apply algebraic identities like x*1, x+0, !!b and --x.
+    bool SimplifyIdentities = true;
+    /// Optional resolver for pure functions without a native implementation bound via Environment::registerNative.
+    NativeResolver Resolver;
+};
+
 /// Main class for parsing and transpiling.
+/// After all definitions and lookup functions are registered, parse(), doTypeChecking() and transpile() can be called from multiple threads at once.
+/// Registered lookup functions have to be threadsafe in this case and nothing may be registered while other threads are parsing.
+/// Use a per-call DiagnosticSink to get the diagnostics of a single call without interleaving them with other threads.
 class Environment {
 public:
     /// Creates an empty environment.
@@ -13,14 +79,76 @@ public:
     /// Destroys an environment.
     ~Environment();
 
+    /// Register a variable definition.
+    /// Registered definitions are looked up via a hash map and take precedence over lookup functions.
+    /// A previous definition with the same name will be replaced.
+    void registerVariable(const VariableDef& def);
+
+    /// Register a function definition. Multiple overloads with the same name can be registered.
+    /// Registered definitions are looked up via a hash map bucketed by the number of parameters and take precedence over lookup functions.
+    /// Exact signatures are preferred, else a single overload reachable by implicit conversions is chosen.
+    /// A previous definition with the same name and signature will be replaced.
+    void registerFunction(const FunctionDef& def);
+
+    /// Register a C++ function or callable with the given name.
+    /// The signature is deduced from the C++ types, see NativeSignature for the supported types.
+    /// The function is registered like registerFunction() and its implementation is bound to the definition by index.
+    /// Visitors can call it via native() with the index given by FunctionDef::nativeIndex(), compile() binds it without a resolver.
+    /// If pure is true, calls with constant arguments are folded by optimize().
+    template <typename Func>
+    inline void registerNative(const std::string& name, Func&& func, bool pure = false)
+    {
+        using Signature    = NativeSignature<Func>;
+        const size_t index = mDefinitions.addNative(Signature::wrap(std::forward<Func>(func)));
+        mDefinitions.addFunction(FunctionDef(name, Signature::returnType(), Signature::parameters(), index, pure));
+    }
+
+    /// The native implementation with the given index, bound by registerNative.
+    const NativeFunction& native(size_t index) const;
+    /// Number of native implementations bound by registerNative.
+    size_t nativeCount() const;
+
     /// Register a variable lookup function.
     /// Callback has to return a valid variable definition if variable exists.
+    /// Lookup functions are only called if no registered definition matches, which makes them useful for dynamic cases.
     void registerVariableLookupFunction(const VariableLookupFunction& def);
 
     /// Register a function lookup function.
     /// Callback has to return a valid function definition if function exists with exact or convertible signature.
     void registerFunctionLookupFunction(const FunctionLookupFunction& def);
 
+    /// Enable memoization of function lookup functions.
+    /// Results are cached by function name and parameter types across all parse and type checking calls.
+    /// The cache is invalidated if a function or function lookup function is registered.
+    /// Only enable it if the lookup functions return the same result for the same signature, regardless of the location.
+    void enableFunctionCache(bool b = true);
+    /// True if memoization of function lookup functions is enabled.
+    bool isFunctionCacheEnabled() const;
+    /// Remove all cached function resolutions. Use it if lookup functions change their behaviour.
+    void clearFunctionCache();
+    /// Current hit and miss counters of the function cache.
+    FunctionCacheStatistics functionCacheStatistics() const;
+    /// Reset the hit and miss counters of the function cache.
+    void resetFunctionCacheStatistics();
+
+    /// Enable the collection of timings and counters for all following calls, see EnvironmentStatistics.
+    /// Disabled by default, as measuring the time spent in the lexer adds a small overhead to each token.
+    void enableStatistics(bool b = true);
+    /// True if timings and counters are collected.
+    bool isStatisticsEnabled() const;
+    /// Snapshot of the timings and counters accumulated since the last reset.
+    /// Can be called from any thread, also while other threads are parsing.
+    EnvironmentStatistics statistics() const;
+    /// Reset all timings and counters. Can be called from any thread.
+    void resetStatistics();
+
+    /// Record spans of all following parse, type checking and transpile calls in the given recorder, see TraceRecorder.
+    /// If traceLookups is true, each resolution of a variable or function is recorded as well.
+    /// A nullptr disables tracing. Like registrations, the recorder may not be changed while other threads use the environment.
+    void setTraceRecorder(const Ptr<TraceRecorder>& recorder, bool traceLookups = false);
+    /// The current recorder or nullptr if tracing is disabled.
+    const Ptr<TraceRecorder>& traceRecorder() const;
+
     /// Parse the stream until eof and return the corresponding AST tree.
     /// If skipTypeChecking is true, no typechecking will be performed and no variables or functions have to be defined in advance.
     /// This is useful, as no returnType() will be specified and further exploration can be done at later stages.
@@ -33,19 +161,154 @@ public:
     /// If an error was detected, a nullptr will be returned instead.
     Ptr<Expression> parse(const std::string& str, bool skipTypeChecking = false) const;
 
+    /// Parse the given string without copying it and return the corresponding AST tree.
+    /// The string only has to be valid for the duration of the call.
+    /// See parse(const std::string&, bool) for more information.
+    Ptr<Expression> parse(std::string_view str, bool skipTypeChecking = false) const;
+
+    /// Parse the given null terminated string without copying it and return the corresponding AST tree.
+    /// See parse(const std::string&, bool) for more information.
+    Ptr<Expression> parse(const char* str, bool skipTypeChecking = false) const;
+
+    /// Parse the given range of characters without copying it and return the corresponding AST tree.
+    /// The range does not have to be null terminated and only has to be valid for the duration of the call.
+    /// See parse(const std::string&, bool) for more information.
+    Ptr<Expression> parse(const char* str, size_t size, bool skipTypeChecking = false) const;
+
+    /// Parse the stream until eof with the given options and return the corresponding AST tree.
+    /// If an error was detected, a nullptr will be returned instead.
+    Ptr<Expression> parse(std::istream& stream, const ParseOptions& options) const;
+
+    /// Parse the given string without copying it with the given options and return the corresponding AST tree.
+    /// If an error was detected, a nullptr will be returned instead.
+    Ptr<Expression> parse(std::string_view str, const ParseOptions& options) const;
+
+    /// Parse all given sources in parallel and return the results in the same order.
+    /// Each source is lexed, parsed and type checked by one of the threads, idle threads steal sources from busy ones.
+    /// Diagnostics are collected per source and not reported to the global logger.
+    /// Registered lookup functions have to be threadsafe.
+    std::vector<BatchParseResult> parseBatch(const std::string_view* sources, size_t count, const BatchParseOptions& options = BatchParseOptions()) const;
+
+    /// Parse all given sources in parallel and return the results in the same order.
+    /// See parseBatch(const std::string_view*, size_t, const BatchParseOptions&) for more information.
+    std::vector<BatchParseResult> parseBatch(const std::vector<std::string_view>& sources, const BatchParseOptions& options = BatchParseOptions()) const;
+
+    /// Parse the given string and place all nodes of the resulting AST tree inside the given arena.
+    /// The arena can be shared by many expressions and is released in a single step together with the last expression allocated from it.
+    /// Subtrees do not own their nodes and are only valid as long as the returned tree is alive, see ExpressionArena.
+    /// As arenas are not threadsafe, the same arena should not be used by multiple threads at once.
+    /// See parse(const std::string&, bool) for more information.
+    Ptr<Expression> parse(std::string_view str, const Ptr<ExpressionArena>& arena, bool skipTypeChecking = false) const;
+
+    /// Store the given type checked AST trees in a compact, versioned binary representation independent of the platform.
+    /// Subtrees shared within or between the trees, e.g., by an ExpressionInterner, are stored once.
+    static std::string serialize(const std::vector<Ptr<Expression>>& exprs);
+
+    /// Store the given type checked AST trees in the given file. Returns false if the file could not be written.
+    /// See serialize(const std::vector<Ptr<Expression>>&) for more information.
+    static bool serializeToFile(const std::filesystem::path& path, const std::vector<Ptr<Expression>>& exprs);
+
+    /// Restore AST trees stored by serialize() without lexing or parsing them again.
+    /// Variables and functions are resolved against this environment, unless UseStoredDefinitions is set, in which case the stored definitions without natives are used.
+    /// The stored types are always validated against the type rules, in time linear to the number of stored nodes.
+    /// Arena, Interner, Diagnostics and UseStoredDefinitions of the options are respected. If the data is invalid, violates the type rules or a definition is missing, nothing will be returned.
+    std::optional<std::vector<Ptr<Expression>>> deserialize(std::string_view data, const ParseOptions& options = ParseOptions()) const;
+
+    /// Restore AST trees from the given file, which is memory mapped if supported by the platform.
+    /// See deserialize(std::string_view, const ParseOptions&) for more information.
+    std::optional<std::vector<Ptr<Expression>>> deserializeFile(const std::filesystem::path& path, const ParseOptions& options = ParseOptions()) const;
+
     /// A late type checking.
+    /// Diagnostics are reported to the given sink or, if not set, to the global logger.
+    /// If no error was found, true will be returned, false otherwise.
+    bool doTypeChecking(const Ptr<Expression>& expr, DiagnosticSink* diagnostics = nullptr) const;
+
+    /// A late type checking of a flat expression. All nodes are handled in a single sequential walk.
     /// If no error was found, true will be returned, false otherwise.
-    bool doTypeChecking(const Ptr<Expression>& expr) const;
+    bool doTypeChecking(FlatExpression& expr, DiagnosticSink* diagnostics = nullptr) const;
+
+    /// Optimize the given type checked AST and return the optimized tree.
+    /// Constant subtrees evaluating to 'bool', 'int', 'num' or 'str' are replaced by literals, constant vectors are kept as they are.
+    /// The given tree is not modified, unchanged subtrees are shared with the returned tree.
+    /// Identities are applied only if no conversion is involved. Note that x+0 does not preserve the sign of a zero x.
+    Ptr<Expression> optimize(const Ptr<Expression>& expr, const OptimizeOptions& options = OptimizeOptions()) const;
 
     /// Together will the mandatory visitor the given AST will be transpiled.
     /// The template payload has to be defined by the user.
     template <typename Payload>
     inline Payload transpile(const Ptr<Expression>& expr, TranspileVisitor<Payload>* visitor) const
     {
+        const internal::StatisticsCollector::ScopedTimer timer(mDefinitions.statistics(), internal::StatisticsCollector::TranspileTime);
+        internal::TraceSpan span(mDefinitions.traceRecorder().get(), "transpile");
+        span.setExpression(expr.get());
+
+        internal::Transpiler<Payload> transpiler(mDefinitions, visitor);
+        return transpiler.handle(expr);
+    }
+
+    /// Together will the mandatory visitor the given type checked AST will be transpiled with the given options.
+    /// The template payload has to be defined by the user.
+    template <typename Payload>
+    inline Payload transpile(const Ptr<Expression>& expr, TranspileVisitor<Payload>* visitor, const TranspileOptions& options) const
+    {
+        if (!options.EliminateCommonSubexpressions)
+            return transpile(expr, visitor);
+
+        const internal::StatisticsCollector::ScopedTimer timer(mDefinitions.statistics(), internal::StatisticsCollector::TranspileTime);
+        internal::TraceSpan span(mDefinitions.traceRecorder().get(), "transpile");
+        span.setExpression(expr.get());
+        span.setDetail("cse");
+
+        const internal::CommonSubexpressions subexpressions(expr);
+        internal::Transpiler<Payload> transpiler(mDefinitions, visitor, &subexpressions);
+        return transpiler.handle(expr);
+    }
+
+    /// Return the payload stored in the given cache for the type checked AST, the backend key and the options or transpile the AST and store the result.
+    /// The payload has to be convertible via TranspileCacheCodec and has to describe the result completely, output produced by the visitor on the side is not replayed.
+    template <typename Payload>
+    inline Payload transpile(const Ptr<Expression>& expr, TranspileVisitor<Payload>* visitor, TranspileCache& cache, std::string_view backendKey, const TranspileOptions& options = TranspileOptions()) const
+    {
+        const Fingerprint key = fingerprint(expr).combine(options.EliminateCommonSubexpressions ? "cse" : "");
+
+        const auto data = cache.load(key, backendKey);
+        if (data.has_value()) {
+            auto payload = TranspileCacheCodec<Payload>::decode(data.value());
+            if (payload.has_value()) {
+                mDefinitions.statistics().increment(internal::StatisticsCollector::CacheHits);
+                return std::move(payload.value());
+            }
+        }
+
+        Payload payload = transpile(expr, visitor, options);
+        cache.store(key, backendKey, TranspileCacheCodec<Payload>::encode(payload));
+        return payload;
+    }
+
+    /// Together will the mandatory visitor the given flat expression will be transpiled in a single sequential walk.
+    /// The template payload has to be defined by the user.
+    template <typename Payload>
+    inline Payload transpile(const FlatExpression& expr, TranspileVisitor<Payload>* visitor) const
+    {
+        const internal::StatisticsCollector::ScopedTimer timer(mDefinitions.statistics(), internal::StatisticsCollector::TranspileTime);
+        internal::TraceSpan span(mDefinitions.traceRecorder().get(), "transpile");
+        span.setExpression(&expr, expr.size());
+
         internal::Transpiler<Payload> transpiler(mDefinitions, visitor);
         return transpiler.handle(expr);
     }
 
+    /// Compile the given type checked AST to a program, which can be evaluated by a VirtualMachine.
+    /// Functions registered by registerNative() are bound directly by index.
+    /// The resolver has to provide a native implementation for each other function called by the expression and may be empty otherwise.
+    /// Diagnostics are reported to the given sink or, if not set, to the global logger.
+    /// If an error was detected, a nullptr will be returned instead.
+    Ptr<Program> compile(const Ptr<Expression>& expr, const NativeResolver& resolver, DiagnosticSink* diagnostics = nullptr) const;
+
+    /// Compile the given type checked flat expression to a program, which can be evaluated by a VirtualMachine.
+    /// See compile(const Ptr<Expression>&, const NativeResolver&, DiagnosticSink*) for more information.
+    Ptr<Program> compile(const FlatExpression& expr, const NativeResolver& resolver, DiagnosticSink* diagnostics = nullptr) const;
+
 private:
     internal::DefContainer mDefinitions;
 };
@@ -1,17 +1,25 @@
 #pragma once
 
+#include "Definitions.h"
 #include "Enums.h"
 #include "Location.h"
 
 namespace PExpr {
 namespace internal {
+class Deserializer;
+class Optimizer;
 class TypeChecker;
 }
+class ExpressionInterner;
+class VariableLayout;
 
 /// Abstract expression. Can not be created directly.
 class Expression {
+    friend internal::Deserializer;
+    friend internal::Optimizer;
     friend internal::TypeChecker;
     friend class Environment;
+    friend ExpressionInterner;
 
 public:
     Expression() = delete;
@@ -57,17 +65,37 @@ public:
 
 /// A simple access to a variable
 class VariableExpression : public Expression {
+    friend internal::Deserializer;
+    friend internal::TypeChecker;
+    friend ExpressionInterner;
+    friend VariableLayout;
+
 public:
+    /// Slot of variables not assigned to a layout yet.
+    static constexpr uint32 InvalidSlot = ~0u;
+
     inline VariableExpression(const Location& loc, const std::string& name)
         : Expression(loc, ExpressionType::Variable)
         , mName(name)
+        , mDefinition()
+        , mSlot(InvalidSlot)
     {
     }
 
     inline const std::string& name() const { return mName; }
 
+    /// The definition the variable was resolved to while type checking.
+    /// Empty if no type checking was performed yet.
+    inline const std::optional<VariableDef>& definition() const { return mDefinition; }
+
+    /// The slot assigned by VariableLayout::assign.
+    /// InvalidSlot if the variable is not assigned to a layout yet.
+    inline uint32 slot() const { return mSlot; }
+
 private:
     std::string mName;
+    std::optional<VariableDef> mDefinition;
+    uint32 mSlot;
 };
 
 /// A simple access to a literal
@@ -81,6 +109,9 @@ public:
         setReturnType(type);
     }
 
+    /// The underlying literal value. The type of this literal is given by returnType().
+    inline const ValueVariant& value() const { return mValue; }
+
     /// Return the literal value as 'bool'. Undefined behaviour if underlying literal is not a 'bool'.
     /// The type of this literal is given by returnType().
     inline bool getBool() const
@@ -131,7 +162,7 @@ public:
     /// The actual unary operation of this expression.
     inline UnaryOperation op() const { return mOperation; }
     /// The inner expression the unary operation is applied to.
-    inline Ptr<Expression> inner() const { return mExpr; }
+    inline const Ptr<Expression>& inner() const { return mExpr; }
 
 private:
     UnaryOperation mOperation;
@@ -153,9 +184,9 @@ public:
     /// The actual binary operation of this expression.
     inline BinaryOperation op() const { return mOperation; }
     /// The left expression the binary operation is applied to.
-    inline Ptr<Expression> left() const { return mLeft; }
+    inline const Ptr<Expression>& left() const { return mLeft; }
     /// The right expression the binary operation is applied to.
-    inline Ptr<Expression> right() const { return mRight; }
+    inline const Ptr<Expression>& right() const { return mRight; }
 
 private:
     BinaryOperation mOperation;
@@ -165,6 +196,11 @@ private:
 
 /// A simple function call.
 class CallExpression : public Expression {
+    friend internal::Deserializer;
+    friend internal::Optimizer;
+    friend internal::TypeChecker;
+    friend ExpressionInterner;
+
 public:
     using ParameterList = std::vector<Ptr<Expression>>;
 
@@ -172,6 +208,7 @@ public:
         : Expression(loc, ExpressionType::Call)
         , mName(name)
         , mParameters(parameters)
+        , mDefinition()
     {
     }
 
@@ -179,6 +216,7 @@ public:
         : Expression(loc, ExpressionType::Call)
         , mName(name)
         , mParameters(std::move(parameters))
+        , mDefinition()
     {
     }
 
@@ -187,9 +225,14 @@ public:
     /// The parameters of the given function.
     inline const ParameterList& parameters() const { return mParameters; }
 
+    /// The definition the function call was resolved to while type checking.
+    /// Empty if no type checking was performed yet.
+    inline const std::optional<FunctionDef>& definition() const { return mDefinition; }
+
 private:
     std::string mName;
     ParameterList mParameters;
+    std::optional<FunctionDef> mDefinition;
 };
 
 /// A component access/swizzle expression.
@@ -204,7 +247,7 @@ public:
     }
 
     /// The inner expression the access operation is applied to.
-    inline Ptr<Expression> inner() const { return mExpr; }
+    inline const Ptr<Expression>& inner() const { return mExpr; }
     /// A character coded swizzle. E.g., xzy will return a 'vec3' with [x, z, y].
     inline const std::string& swizzle() const { return mSwizzle; }
 
@@ -0,0 +1,176 @@
+#include "ExpressionInterner.h"
+
+namespace PExpr {
+template <typename T>
+static inline void appendBytes(std::string& key, const T& value)
+{
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+ExpressionInterner::ExpressionInterner(size_t blockSize)
+    : mMutex()
+    , mArena(std::make_shared<ExpressionArena>(blockSize))
+    , mNodes()
+{
+}
+
+Ptr<Expression> ExpressionInterner::intern(const Ptr<Expression>& expr)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    VisitedMap visited;
+    return shareOwnership(mArena, internNode(expr, visited));
+}
+
+size_t ExpressionInterner::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNodes.size();
+}
+
+size_t ExpressionInterner::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mArena->usedBytes();
+}
+
+Ptr<Expression> ExpressionInterner::internNode(const Ptr<Expression>& expr, VisitedMap& visited)
+{
+    const auto visitedIt = visited.find(expr.get());
+    if (visitedIt != visited.end())
+        return visitedIt->second;
+
+    std::string key;
+    key += (char)expr->type();
+    key += (char)expr->returnType();
+
+    // Children are interned first, therefore their identity is sufficient for the key
+    std::vector<Ptr<Expression>> children;
+    switch (expr->type()) {
+    case ExpressionType::Variable:
+        key += static_cast<const VariableExpression*>(expr.get())->name();
+        break;
+    case ExpressionType::Literal: {
+        const auto lit = static_cast<const LiteralExpression*>(expr.get());
+        switch (lit->returnType()) {
+        case ElementaryType::Boolean:
+            key += lit->getBool() ? '1' : '0';
+            break;
+        case ElementaryType::Integer:
+            appendBytes(key, lit->getInteger());
+            break;
+        case ElementaryType::Number:
+            appendBytes(key, lit->getNumber());
+            break;
+        case ElementaryType::String:
+            key += lit->getString();
+            break;
+        default: {
+            // Untyped literals keep the type of the value only
+            const ValueVariant& value = lit->value();
+            key += (char)value.index();
+            std::visit([&](auto&& v) {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, std::string>)
+                    key += v;
+                else
+                    appendBytes(key, v);
+            },
+                       value);
+            break;
+        }
+        }
+        break;
+    }
+    case ExpressionType::Unary: {
+        const auto unary = static_cast<const UnaryExpression*>(expr.get());
+        key += (char)unary->op();
+        children.push_back(internNode(unary->inner(), visited));
+        break;
+    }
+    case ExpressionType::Binary: {
+        const auto binary = static_cast<const BinaryExpression*>(expr.get());
+        key += (char)binary->op();
+        children.push_back(internNode(binary->left(), visited));
+        children.push_back(internNode(binary->right(), visited));
+        break;
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr.get());
+        key += call->name();
+        key += '\0';
+        if (call->definition().has_value()) {
+            const FunctionDef& def = call->definition().value();
+            appendBytes(key, def.nativeIndex());
+            key += def.isPure() ? '1' : '0';
+            key += (char)def.returnType();
+            for (const auto& type : def.parameters())
+                key += (char)type;
+        }
+        key += '\0';
+        for (const auto& param : call->parameters())
+            children.push_back(internNode(param, visited));
+        break;
+    }
+    case ExpressionType::Access: {
+        const auto access = static_cast<const AccessExpression*>(expr.get());
+        key += access->swizzle();
+        key += '\0';
+        children.push_back(internNode(access->inner(), visited));
+        break;
+    }
+    default:
+        // Errors are never shared
+        appendBytes(key, expr.get());
+        break;
+    }
+
+    for (const auto& child : children)
+        appendBytes(key, child.get());
+
+    const auto it = mNodes.find(key);
+    if (it != mNodes.end()) {
+        visited.emplace(expr.get(), it->second);
+        return it->second;
+    }
+
+    Ptr<Expression> node;
+    switch (expr->type()) {
+    case ExpressionType::Variable: {
+        const auto var = static_cast<const VariableExpression*>(expr.get());
+        auto copy      = create<VariableExpression>(expr->location(), var->name());
+        copy->mDefinition = var->definition();
+        node              = copy;
+        break;
+    }
+    case ExpressionType::Literal: {
+        const auto lit = static_cast<const LiteralExpression*>(expr.get());
+        node           = create<LiteralExpression>(expr->location(), lit->returnType(), lit->value());
+        break;
+    }
+    case ExpressionType::Unary:
+        node = create<UnaryExpression>(expr->location(), static_cast<const UnaryExpression*>(expr.get())->op(), children[0]);
+        break;
+    case ExpressionType::Binary:
+        node = create<BinaryExpression>(expr->location(), static_cast<const BinaryExpression*>(expr.get())->op(), children[0], children[1]);
+        break;
+    case ExpressionType::Call: {
+        const auto call   = static_cast<const CallExpression*>(expr.get());
+        auto copy         = create<CallExpression>(expr->location(), call->name(), std::move(children));
+        copy->mDefinition = call->definition();
+        node              = copy;
+        break;
+    }
+    case ExpressionType::Access:
+        node = create<AccessExpression>(expr->location(), children[0], static_cast<const AccessExpression*>(expr.get())->swizzle());
+        break;
+    default:
+        node = expr;
+        break;
+    }
+
+    node->setReturnType(expr->returnType());
+    mNodes.emplace(std::move(key), node);
+    visited.emplace(expr.get(), node);
+    return node;
+}
+} // namespace PExpr
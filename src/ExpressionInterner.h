@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Arena.h"
+#include "Expression.h"
+
+#include <mutex>
+
+namespace PExpr {
+/// Pool of unique expression nodes, also known as hash consing.
+/// Interning a tree replaces every subtree by a canonical node identified by its operation, return type, resolved definition, literal value and canonical children.
+/// Identical subtrees of one or many expressions are thereby represented by a single shared node and the tree becomes a directed acyclic graph.
+/// Two interned trees are structurally equal, including their types, if and only if they are the same pointer.
+/// The location of a canonical node refers to its first occurrence.
+/// Interned nodes are shared and must not be modified afterwards, e.g., by type checking or assigning them to a VariableLayout.
+/// All canonical nodes are owned by a single arena, which stays alive as long as the pool or an interned tree does.
+/// Interning is threadsafe.
+class ExpressionInterner {
+public:
+    /// Creates an empty pool placing all canonical nodes in an arena with the given block size.
+    explicit ExpressionInterner(size_t blockSize = ExpressionArena::DefaultBlockSize);
+
+    /// Return the canonical representation of the given tree. The given tree is not modified.
+    Ptr<Expression> intern(const Ptr<Expression>& expr);
+
+    /// Number of unique nodes in the pool.
+    size_t size() const;
+    /// Number of bytes used by all unique nodes.
+    size_t usedBytes() const;
+
+private:
+    // Nodes already handled during the current call, which keeps interning trees with shared subtrees linear
+    using VisitedMap = std::unordered_map<const Expression*, Ptr<Expression>>;
+    Ptr<Expression> internNode(const Ptr<Expression>& expr, VisitedMap& visited);
+
+    template <typename T, typename... Args>
+    inline Ptr<T> create(Args&&... args)
+    {
+        return mArena->createUnowned<T>(std::forward<Args>(args)...);
+    }
+
+    mutable std::mutex mMutex;
+    Ptr<ExpressionArena> mArena;
+    std::unordered_map<std::string, Ptr<Expression>> mNodes;
+
+    PEXPR_CLASS_NON_COPYABLE(ExpressionInterner);
+};
+} // namespace PExpr
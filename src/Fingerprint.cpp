@@ -0,0 +1,167 @@
+#include "Fingerprint.h"
+
+namespace PExpr {
+namespace {
+constexpr uint64 Prime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64 Prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64 Prime3 = 0x165667B19E3779F9ull;
+
+inline uint64 rotl(uint64 v, int r) { return (v << r) | (v >> (64 - r)); }
+
+inline uint64 avalanche(uint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/// Two lane hash over 64-bit words. Everything is converted to words explicitly to be independent of the platform
+class Hasher {
+public:
+    inline void add(uint64 v)
+    {
+        mLow  = rotl(mLow + v * Prime2, 31) * Prime1;
+        mHigh = rotl(mHigh ^ (v * Prime1), 29) * Prime3 + mLow;
+        ++mLength;
+    }
+
+    inline void add(Number v)
+    {
+        uint64 bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        add(bits);
+    }
+
+    inline void add(std::string_view str)
+    {
+        add((uint64)str.size());
+        for (size_t i = 0; i < str.size(); i += 8) {
+            uint64 word = 0;
+            for (size_t k = 0; k < 8 && i + k < str.size(); ++k)
+                word |= (uint64)(uint8)str[i + k] << (8 * k);
+            add(word);
+        }
+    }
+
+    inline void add(const Fingerprint& fingerprint)
+    {
+        add(fingerprint.Low);
+        add(fingerprint.High);
+    }
+
+    inline Fingerprint finish() const
+    {
+        Fingerprint fingerprint;
+        fingerprint.Low  = avalanche(mLow ^ mLength);
+        fingerprint.High = avalanche(mHigh ^ rotl(fingerprint.Low, 17));
+        return fingerprint;
+    }
+
+private:
+    uint64 mLow    = Prime1;
+    uint64 mHigh   = Prime2;
+    uint64 mLength = 0;
+};
+} // namespace
+
+std::string Fingerprint::toString() const
+{
+    static const char* digits = "0123456789abcdef";
+
+    std::string str(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        str[15 - i] = digits[(High >> (4 * i)) & 0xF];
+        str[31 - i] = digits[(Low >> (4 * i)) & 0xF];
+    }
+    return str;
+}
+
+Fingerprint Fingerprint::combine(std::string_view data) const
+{
+    Hasher hasher;
+    hasher.add(*this);
+    hasher.add(data);
+    return hasher.finish();
+}
+
+Fingerprint Fingerprinter::fingerprint(const Ptr<Expression>& expr)
+{
+    const auto it = mCache.find(expr.get());
+    if (it != mCache.end())
+        return it->second.second;
+
+    Hasher hasher;
+    hasher.add((uint64)expr->type());
+    hasher.add((uint64)expr->returnType());
+
+    switch (expr->type()) {
+    case ExpressionType::Variable:
+        hasher.add(static_cast<const VariableExpression*>(expr.get())->name());
+        break;
+    case ExpressionType::Literal: {
+        const ValueVariant& value = static_cast<const LiteralExpression*>(expr.get())->value();
+        hasher.add((uint64)value.index());
+        std::visit([&](auto&& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, bool>)
+                hasher.add((uint64)(v ? 1 : 0));
+            else if constexpr (std::is_same_v<T, Integer>)
+                hasher.add((uint64)v);
+            else
+                hasher.add(v);
+        },
+                   value);
+        break;
+    }
+    case ExpressionType::Unary: {
+        const auto unary = static_cast<const UnaryExpression*>(expr.get());
+        hasher.add((uint64)unary->op());
+        hasher.add(fingerprint(unary->inner()));
+        break;
+    }
+    case ExpressionType::Binary: {
+        const auto binary = static_cast<const BinaryExpression*>(expr.get());
+        hasher.add((uint64)binary->op());
+        hasher.add(fingerprint(binary->left()));
+        hasher.add(fingerprint(binary->right()));
+        break;
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr.get());
+        hasher.add(call->name());
+
+        // The signature selects the overload and is therefore part of the structure
+        if (call->definition().has_value()) {
+            const FunctionDef& def = call->definition().value();
+            hasher.add((uint64)1);
+            hasher.add((uint64)(def.isPure() ? 1 : 0));
+            hasher.add((uint64)def.parameters().size());
+            for (const auto& type : def.parameters())
+                hasher.add((uint64)type);
+        } else {
+            hasher.add((uint64)0);
+        }
+
+        hasher.add((uint64)call->parameters().size());
+        for (const auto& param : call->parameters())
+            hasher.add(fingerprint(param));
+        break;
+    }
+    case ExpressionType::Access: {
+        const auto access = static_cast<const AccessExpression*>(expr.get());
+        hasher.add(access->swizzle());
+        hasher.add(fingerprint(access->inner()));
+        break;
+    }
+    default:
+        break;
+    }
+
+    const Fingerprint result = hasher.finish();
+    mCache.emplace(expr.get(), std::make_pair(expr, result));
+    return result;
+}
+} // namespace PExpr
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Expression.h"
+
+namespace PExpr {
+/// 128-bit structural hash of an expression tree.
+struct Fingerprint {
+    uint64 Low  = 0;
+    uint64 High = 0;
+
+    /// 64-bit part of the fingerprint, e.g., for hash maps.
+    inline uint64 value64() const { return Low; }
+    /// Printable hexadecimal representation with 32 characters.
+    std::string toString() const;
+    /// Return a new fingerprint combining this one with the given data, e.g., a version string.
+    Fingerprint combine(std::string_view data) const;
+
+    inline bool operator==(const Fingerprint& other) const { return Low == other.Low && High == other.High; }
+    inline bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+    inline bool operator<(const Fingerprint& other) const { return High < other.High || (High == other.High && Low < other.Low); }
+};
+
+/// Computes structural fingerprints of expression trees bottom-up.
+/// The fingerprint covers node kinds, operations, names, literal values, swizzles and the resolved types of all nodes including the signature of called functions.
+/// Source locations are not part of it, therefore expressions differing only in whitespace or comments share the same fingerprint.
+/// The result is independent of the process and platform and can be persisted, e.g., as a key for a shader cache.
+/// Fingerprints of visited nodes are remembered, making repeated calls on trees sharing subtrees, e.g., interned trees, cheap.
+/// The fingerprinter keeps all visited nodes alive until it is cleared. It is not threadsafe.
+class Fingerprinter {
+public:
+    Fingerprinter() = default;
+
+    /// Return the fingerprint of the given tree.
+    Fingerprint fingerprint(const Ptr<Expression>& expr);
+
+    /// Forget all remembered nodes.
+    inline void clear() { mCache.clear(); }
+    /// Number of remembered nodes.
+    inline size_t size() const { return mCache.size(); }
+
+private:
+    std::unordered_map<const Expression*, std::pair<Ptr<Expression>, Fingerprint>> mCache;
+};
+
+/// Return the fingerprint of the given tree. See Fingerprinter for more information.
+inline Fingerprint fingerprint(const Ptr<Expression>& expr)
+{
+    Fingerprinter fingerprinter;
+    return fingerprinter.fingerprint(expr);
+}
+} // namespace PExpr
+
+namespace std {
+template <>
+struct hash<PExpr::Fingerprint> {
+    inline size_t operator()(const PExpr::Fingerprint& fingerprint) const { return (size_t)fingerprint.value64(); }
+};
+} // namespace std
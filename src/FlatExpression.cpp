@@ -0,0 +1,103 @@
+#include "FlatExpression.h"
+
+namespace PExpr {
+FlatExpression::FlatExpression(const Ptr<Expression>& expr)
+{
+    PEXPR_ASSERT(expr != nullptr, "Expected valid expression");
+    flatten(expr.get());
+    mNameMap.clear();
+}
+
+uint32 FlatExpression::addName(const std::string& name)
+{
+    const auto it = mNameMap.find(name);
+    if (it != mNameMap.end())
+        return it->second;
+
+    const uint32 index = (uint32)mNames.size();
+    mNames.push_back(name);
+    mNameMap.emplace(name, index);
+    return index;
+}
+
+uint32 FlatExpression::push(const Expression* expr, uint8 operation, uint32 op0, uint32 op1, uint32 data, uint32 definition)
+{
+    mNodes.push_back(FlatNode{ expr->location(), expr->type(), expr->returnType(), operation, { op0, op1 }, data, definition });
+    return (uint32)(mNodes.size() - 1);
+}
+
+void FlatExpression::setDefinition(FlatNode& node, const VariableDef& def)
+{
+    if (node.Definition != InvalidIndex) {
+        mVariableDefs[node.Definition] = def;
+    } else {
+        node.Definition = (uint32)mVariableDefs.size();
+        mVariableDefs.push_back(def);
+        mVariableSlots.push_back(InvalidIndex);
+    }
+}
+
+void FlatExpression::setDefinition(FlatNode& node, const FunctionDef& def)
+{
+    if (node.Definition != InvalidIndex) {
+        mFunctionDefs[node.Definition] = def;
+    } else {
+        node.Definition = (uint32)mFunctionDefs.size();
+        mFunctionDefs.push_back(def);
+    }
+}
+
+uint32 FlatExpression::flatten(const Expression* expr)
+{
+    switch (expr->type()) {
+    case ExpressionType::Variable: {
+        const auto var    = static_cast<const VariableExpression*>(expr);
+        const uint32 node = push(expr, 0, InvalidIndex, InvalidIndex, addName(var->name()));
+        if (var->definition().has_value()) {
+            setDefinition(mNodes[node], var->definition().value());
+            mVariableSlots[mNodes[node].Definition] = var->slot();
+        }
+        return node;
+    }
+    case ExpressionType::Literal: {
+        const auto lit = static_cast<const LiteralExpression*>(expr);
+        mLiterals.push_back(lit->value());
+        return push(expr, 0, InvalidIndex, InvalidIndex, (uint32)(mLiterals.size() - 1));
+    }
+    case ExpressionType::Unary: {
+        const auto un     = static_cast<const UnaryExpression*>(expr);
+        const uint32 node = flatten(un->inner().get());
+        return push(expr, (uint8)un->op(), node, InvalidIndex, InvalidIndex);
+    }
+    case ExpressionType::Binary: {
+        const auto bin     = static_cast<const BinaryExpression*>(expr);
+        const uint32 left  = flatten(bin->left().get());
+        const uint32 right = flatten(bin->right().get());
+        return push(expr, (uint8)bin->op(), left, right, InvalidIndex);
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr);
+
+        std::vector<uint32> args;
+        args.reserve(call->parameters().size());
+        for (const auto& param : call->parameters())
+            args.push_back(flatten(param.get()));
+
+        // Arguments of nested calls are already placed, therefore append ours afterwards
+        const uint32 offset = (uint32)mArguments.size();
+        mArguments.insert(mArguments.end(), args.begin(), args.end());
+        const uint32 node = push(expr, 0, offset, (uint32)args.size(), addName(call->name()));
+        if (call->definition().has_value())
+            setDefinition(mNodes[node], call->definition().value());
+        return node;
+    }
+    case ExpressionType::Access: {
+        const auto acc    = static_cast<const AccessExpression*>(expr);
+        const uint32 node = flatten(acc->inner().get());
+        return push(expr, 0, node, InvalidIndex, addName(acc->swizzle()));
+    }
+    default:
+        return push(expr, 0, InvalidIndex, InvalidIndex, InvalidIndex);
+    }
+}
+} // namespace PExpr
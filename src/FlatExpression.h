@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Expression.h"
+
+namespace PExpr {
+namespace internal {
+class TypeChecker;
+}
+
+/// A single node of a flat expression.
+/// Depending on the type, the fields have the following meaning:
+/// - Variable: Data is the index of the name.
+/// - Literal: Data is the index of the literal.
+/// - Unary: Operation is an UnaryOperation, Operands[0] is the inner node.
+/// - Binary: Operation is a BinaryOperation, Operands[0] and Operands[1] are the left and right nodes.
+/// - Call: Data is the index of the name, Operands[0] is the offset and Operands[1] the count of the arguments in the argument table.
+/// - Access: Data is the index of the swizzle (stored in the name table), Operands[0] is the inner node.
+/// Variables and calls reference their resolved definition via Definition, which is set while type checking.
+struct FlatNode {
+    PExpr::Location Location;
+    ExpressionType Type;
+    ElementaryType ReturnType;
+    uint8 Operation;
+    std::array<uint32, 2> Operands;
+    uint32 Data;
+    uint32 Definition;
+};
+
+/// Linearized representation of an expression tree.
+/// All nodes are stored in a contiguous array in post-order, children are referenced by 32-bit indices.
+/// Names, swizzles and literals are stored in separate tables.
+/// As operands are always placed before the node itself, a single sequential walk is sufficient to handle the expression.
+class FlatExpression {
+    friend internal::TypeChecker;
+    friend VariableLayout;
+
+public:
+    /// Range of node indices used as arguments for a call.
+    class ArgumentRange {
+    public:
+        inline ArgumentRange(const uint32* begin, const uint32* end)
+            : mBegin(begin)
+            , mEnd(end)
+        {
+        }
+
+        inline const uint32* begin() const { return mBegin; }
+        inline const uint32* end() const { return mEnd; }
+        inline size_t size() const { return mEnd - mBegin; }
+        inline uint32 operator[](size_t i) const { return mBegin[i]; }
+
+    private:
+        const uint32* mBegin;
+        const uint32* mEnd;
+    };
+
+    /// Index used for unset operands, data or definitions.
+    static constexpr uint32 InvalidIndex = ~0u;
+
+    /// Linearize the given expression tree. The return types and resolved definitions of the tree, if available, are kept.
+    explicit FlatExpression(const Ptr<Expression>& expr);
+
+    /// All nodes in post-order. The last node is the root.
+    inline const std::vector<FlatNode>& nodes() const { return mNodes; }
+    /// Number of nodes.
+    inline size_t size() const { return mNodes.size(); }
+    /// The root node.
+    inline const FlatNode& root() const { return mNodes.back(); }
+    /// The type the whole expression evaluates to. If no type checking is performed yet, this defaults to 'unspecified'.
+    inline ElementaryType returnType() const { return mNodes.empty() ? ElementaryType::Unspecified : root().ReturnType; }
+
+    /// Entry of the name table. Used by variables, calls and swizzles.
+    inline const std::string& name(uint32 index) const { return mNames[index]; }
+    /// Entry of the literal table.
+    inline const ValueVariant& literal(uint32 index) const { return mLiterals[index]; }
+    /// The resolved definition of the given variable node. Only available after type checking.
+    inline const VariableDef* variableDefinition(const FlatNode& node) const
+    {
+        PEXPR_ASSERT(node.Type == ExpressionType::Variable, "Expected a variable node");
+        return node.Definition == InvalidIndex ? nullptr : &mVariableDefs[node.Definition];
+    }
+    /// The slot assigned to the given variable node by VariableLayout::assign or InvalidIndex if not assigned yet.
+    inline uint32 variableSlot(const FlatNode& node) const
+    {
+        PEXPR_ASSERT(node.Type == ExpressionType::Variable, "Expected a variable node");
+        return node.Definition == InvalidIndex ? InvalidIndex : mVariableSlots[node.Definition];
+    }
+    /// The resolved definition of the given call node. Only available after type checking.
+    inline const FunctionDef* functionDefinition(const FlatNode& node) const
+    {
+        PEXPR_ASSERT(node.Type == ExpressionType::Call, "Expected a call node");
+        return node.Definition == InvalidIndex ? nullptr : &mFunctionDefs[node.Definition];
+    }
+    /// The node indices of the arguments of the given call node.
+    inline ArgumentRange arguments(const FlatNode& node) const
+    {
+        PEXPR_ASSERT(node.Type == ExpressionType::Call, "Expected a call node");
+        const uint32* begin = mArguments.data() + node.Operands[0];
+        return ArgumentRange(begin, begin + node.Operands[1]);
+    }
+
+private:
+    uint32 flatten(const Expression* expr);
+    uint32 addName(const std::string& name);
+    uint32 push(const Expression* expr, uint8 operation, uint32 op0, uint32 op1, uint32 data, uint32 definition = InvalidIndex);
+    void setDefinition(FlatNode& node, const VariableDef& def);
+    void setDefinition(FlatNode& node, const FunctionDef& def);
+
+    std::vector<FlatNode> mNodes;
+    std::vector<std::string> mNames;
+    std::vector<ValueVariant> mLiterals;
+    std::vector<uint32> mArguments;
+    std::vector<VariableDef> mVariableDefs;
+    std::vector<uint32> mVariableSlots; // Parallel to mVariableDefs
+    std::vector<FunctionDef> mFunctionDefs;
+
+    std::unordered_map<std::string, uint32> mNameMap; // Only used while building
+};
+} // namespace PExpr
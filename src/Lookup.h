@@ -6,6 +6,9 @@
 #include <functional>
 
 namespace PExpr {
+/// Request for a variable definition.
+/// The lookup only references the given name instead of copying it and is only valid for the duration of the callback.
+/// A lookup must not outlive the call it was created for. When constructing one, e.g., to test a callback, the name has to outlive the lookup.
 class VariableLookup {
 public:
     inline VariableLookup(const Location& location, const std::string& name)
@@ -20,12 +23,15 @@ public:
     inline const Location& location() const { return mLocation; }
 
 private:
-    std::string mName;
+    const std::string& mName;
     Location mLocation;
 };
 /// Callback returning definition of variable if found
 using VariableLookupFunction = std::function<std::optional<VariableDef>(const VariableLookup&)>;
 
+/// Request for a function definition.
+/// The lookup only references the given name and parameters instead of copying them and is only valid for the duration of the callback.
+/// A lookup must not outlive the call it was created for. When constructing one, e.g., to test a callback, name and parameters have to outlive the lookup.
 class FunctionLookup {
 public:
     inline FunctionLookup(const Location& location, const std::string& name, const std::vector<ElementaryType>& params)
@@ -47,6 +53,9 @@ public:
     /// Return true if given set of parameters is compatible with the parameters in the lookup.
     inline bool matchParameter(const std::vector<ElementaryType>& params, bool exactOnly = false) const
     {
+        if (mParameters.size() != params.size())
+            return false;
+
         // First check for exact matches
         if (std::equal(mParameters.begin(), mParameters.end(), params.begin()))
             return true;
@@ -60,11 +69,18 @@ public:
     }
 
 private:
-    std::string mName;
+    const std::string& mName;
     Location mLocation;
-    std::vector<ElementaryType> mParameters;
+    const std::vector<ElementaryType>& mParameters;
 };
 /// Callback returning definition of function if exact match is found
 using FunctionLookupFunction = std::function<std::optional<FunctionDef>(const FunctionLookup&)>;
 
+/// Statistics of the function resolution cache.
+struct FunctionCacheStatistics {
+    size_t Hits    = 0; /// Number of resolutions served from the cache.
+    size_t Misses  = 0; /// Number of resolutions which had to call the lookup functions.
+    size_t Entries = 0; /// Number of cached signatures.
+};
+
 } // namespace PExpr
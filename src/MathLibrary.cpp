@@ -0,0 +1,226 @@
+#include "MathLibrary.h"
+#include "Environment.h"
+#include "internal/Simd.h"
+
+#include <limits>
+
+namespace PExpr {
+namespace {
+// Reference implementation with the same algorithm as the vectorized versions. Masks are represented by doubles with all bits set
+namespace scalar {
+using V                       = double;
+static constexpr size_t Width = 1;
+
+static inline uint64 toBits(V v)
+{
+    uint64 bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static inline V fromBits(uint64 bits)
+{
+    V v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static inline V set(double v) { return v; }
+static inline V load(const double* p) { return *p; }
+static inline void store(double* p, V v) { *p = v; }
+static inline V add(V a, V b) { return a + b; }
+static inline V sub(V a, V b) { return a - b; }
+static inline V mul(V a, V b) { return a * b; }
+static inline V div(V a, V b) { return a / b; }
+static inline V sqrt(V a) { return std::sqrt(a); }
+static inline V bitAnd(V a, V b) { return fromBits(toBits(a) & toBits(b)); }
+static inline V bitOr(V a, V b) { return fromBits(toBits(a) | toBits(b)); }
+static inline V bitXor(V a, V b) { return fromBits(toBits(a) ^ toBits(b)); }
+static inline V bitAndNot(V a, V b) { return fromBits(~toBits(a) & toBits(b)); }
+static inline V mask(bool b) { return fromBits(b ? ~uint64(0) : 0); }
+static inline V less(V a, V b) { return mask(a < b); }
+static inline V lessEqual(V a, V b) { return mask(a <= b); }
+static inline V greater(V a, V b) { return mask(a > b); }
+static inline V equal(V a, V b) { return mask(a == b); }
+static inline V select(V m, V a, V b) { return bitOr(bitAnd(m, a), bitAndNot(m, b)); }
+static inline bool anyTrue(V m) { return toBits(m) != 0; }
+static inline uint64 setBits(int64 v) { return (uint64)v; }
+static inline uint64 addBits(uint64 a, uint64 b) { return a + b; }
+static inline uint64 subBits(uint64 a, uint64 b) { return a - b; }
+static inline uint64 andBits(uint64 a, uint64 b) { return a & b; }
+static inline uint64 orBits(uint64 a, uint64 b) { return a | b; }
+static inline uint64 shiftLeftBits(uint64 a, int n) { return a << n; }
+static inline uint64 shiftRightBits(uint64 a, int n) { return a >> n; }
+
+#include "internal/MathKernels.inl"
+} // namespace scalar
+
+#ifdef PEXPR_ARCH_X64
+namespace sse2 {
+using V                       = __m128d;
+static constexpr size_t Width = 2;
+
+static inline V set(double v) { return _mm_set1_pd(v); }
+static inline V load(const double* p) { return _mm_loadu_pd(p); }
+static inline void store(double* p, V v) { _mm_storeu_pd(p, v); }
+static inline V add(V a, V b) { return _mm_add_pd(a, b); }
+static inline V sub(V a, V b) { return _mm_sub_pd(a, b); }
+static inline V mul(V a, V b) { return _mm_mul_pd(a, b); }
+static inline V div(V a, V b) { return _mm_div_pd(a, b); }
+static inline V sqrt(V a) { return _mm_sqrt_pd(a); }
+static inline V bitAnd(V a, V b) { return _mm_and_pd(a, b); }
+static inline V bitOr(V a, V b) { return _mm_or_pd(a, b); }
+static inline V bitXor(V a, V b) { return _mm_xor_pd(a, b); }
+static inline V bitAndNot(V a, V b) { return _mm_andnot_pd(a, b); }
+static inline V less(V a, V b) { return _mm_cmplt_pd(a, b); }
+static inline V lessEqual(V a, V b) { return _mm_cmple_pd(a, b); }
+static inline V greater(V a, V b) { return _mm_cmpgt_pd(a, b); }
+static inline V equal(V a, V b) { return _mm_cmpeq_pd(a, b); }
+static inline V select(V m, V a, V b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+static inline bool anyTrue(V m) { return _mm_movemask_pd(m) != 0; }
+static inline __m128i toBits(V v) { return _mm_castpd_si128(v); }
+static inline V fromBits(__m128i v) { return _mm_castsi128_pd(v); }
+static inline __m128i setBits(int64 v) { return _mm_set1_epi64x(v); }
+static inline __m128i addBits(__m128i a, __m128i b) { return _mm_add_epi64(a, b); }
+static inline __m128i subBits(__m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+static inline __m128i andBits(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+static inline __m128i orBits(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+static inline __m128i shiftLeftBits(__m128i a, int n) { return _mm_slli_epi64(a, n); }
+static inline __m128i shiftRightBits(__m128i a, int n) { return _mm_srli_epi64(a, n); }
+
+#include "internal/MathKernels.inl"
+} // namespace sse2
+
+// All functions in this region, including the instantiated templates, are compiled for AVX2
+#if defined(PEXPR_CC_CLANG)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(PEXPR_CC_GNU)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace avx2 {
+using V                       = __m256d;
+static constexpr size_t Width = 4;
+
+static inline V set(double v) { return _mm256_set1_pd(v); }
+static inline V load(const double* p) { return _mm256_loadu_pd(p); }
+static inline void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+static inline V add(V a, V b) { return _mm256_add_pd(a, b); }
+static inline V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+static inline V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+static inline V div(V a, V b) { return _mm256_div_pd(a, b); }
+static inline V sqrt(V a) { return _mm256_sqrt_pd(a); }
+static inline V bitAnd(V a, V b) { return _mm256_and_pd(a, b); }
+static inline V bitOr(V a, V b) { return _mm256_or_pd(a, b); }
+static inline V bitXor(V a, V b) { return _mm256_xor_pd(a, b); }
+static inline V bitAndNot(V a, V b) { return _mm256_andnot_pd(a, b); }
+static inline V less(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+static inline V lessEqual(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+static inline V greater(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+static inline V equal(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+static inline V select(V m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+static inline bool anyTrue(V m) { return _mm256_movemask_pd(m) != 0; }
+static inline __m256i toBits(V v) { return _mm256_castpd_si256(v); }
+static inline V fromBits(__m256i v) { return _mm256_castsi256_pd(v); }
+static inline __m256i setBits(int64 v) { return _mm256_set1_epi64x(v); }
+static inline __m256i addBits(__m256i a, __m256i b) { return _mm256_add_epi64(a, b); }
+static inline __m256i subBits(__m256i a, __m256i b) { return _mm256_sub_epi64(a, b); }
+static inline __m256i andBits(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+static inline __m256i orBits(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+static inline __m256i shiftLeftBits(__m256i a, int n) { return _mm256_slli_epi64(a, n); }
+static inline __m256i shiftRightBits(__m256i a, int n) { return _mm256_srli_epi64(a, n); }
+
+#include "internal/MathKernels.inl"
+} // namespace avx2
+#if defined(PEXPR_CC_CLANG)
+#pragma clang attribute pop
+#elif defined(PEXPR_CC_GNU)
+#pragma GCC pop_options
+#endif
+#endif
+} // namespace
+
+static const std::array<const char*, 8> FunctionNames = { "sin", "cos", "tan", "asin", "acos", "atan", "exp", "log" };
+
+std::optional<MathFunction> MathLibrary::find(std::string_view name)
+{
+    for (size_t i = 0; i < FunctionNames.size(); ++i) {
+        if (name == FunctionNames[i])
+            return (MathFunction)i;
+    }
+    return {};
+}
+
+const char* MathLibrary::name(MathFunction func)
+{
+    return FunctionNames[(size_t)func];
+}
+
+std::optional<FunctionDef> MathLibrary::lookup(const FunctionLookup& lkp)
+{
+    if (lkp.parameters().size() != 1 || !isArithmetic(lkp.parameters()[0]) || !find(lkp.name()).has_value())
+        return {};
+
+    const ElementaryType type = lkp.parameters()[0] != ElementaryType::Integer ? lkp.parameters()[0] : ElementaryType::Number;
+    return FunctionDef(lkp.name(), type, { type }, FunctionDef::NoNative, true);
+}
+
+NativeFunction MathLibrary::resolveNative(const FunctionDef& def)
+{
+    const auto func = find(def.name());
+    if (!func.has_value() || def.parameters().size() != 1 || def.parameters()[0] != def.returnType())
+        return {};
+
+    const size_t lanes   = typeArraySize(def.returnType());
+    const MathFunction f = func.value();
+    return [=](const Cell* args, Cell* result) {
+        for (size_t i = 0; i < lanes; ++i)
+            result[i].Num = evaluate(f, args[i].Num);
+    };
+}
+
+BatchNativeFunction MathLibrary::resolveBatchNative(const FunctionDef& def)
+{
+    const auto func = find(def.name());
+    if (!func.has_value() || def.parameters().size() != 1 || def.parameters()[0] != def.returnType())
+        return {};
+
+    const size_t lanes   = typeArraySize(def.returnType());
+    const SimdLevel level = detectSimdLevel();
+    const MathFunction f  = func.value();
+    return [=](const Cell* args, Cell* result, size_t count, size_t stride) {
+        for (size_t i = 0; i < lanes; ++i)
+            evaluate(f, &args[i * stride].Num, &result[i * stride].Num, count, level);
+    };
+}
+
+void MathLibrary::registerFunctions(Environment& env)
+{
+    env.registerFunctionLookupFunction(lookup);
+}
+
+Number MathLibrary::evaluate(MathFunction func, Number x)
+{
+    Number res;
+    scalar::evaluateArray(func, &x, &res, 1);
+    return res;
+}
+
+void MathLibrary::evaluate(MathFunction func, const Number* in, Number* out, size_t count, SimdLevel level)
+{
+    switch (std::min(level, detectSimdLevel())) {
+    default:
+    case SimdLevel::Scalar:
+        scalar::evaluateArray(func, in, out, count);
+        break;
+#ifdef PEXPR_ARCH_X64
+    case SimdLevel::SSE2:
+        sse2::evaluateArray(func, in, out, count);
+        break;
+    case SimdLevel::AVX2:
+        avx2::evaluateArray(func, in, out, count);
+        break;
+#endif
+    }
+}
+} // namespace PExpr
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BatchEvaluator.h"
+#include "Lookup.h"
+
+namespace PExpr {
+class Environment;
+
+/// Built-in math functions.
+enum class MathFunction {
+    Sin,  /// 'sin'
+    Cos,  /// 'cos'
+    Tan,  /// 'tan'
+    ASin, /// 'asin'
+    ACos, /// 'acos'
+    ATan, /// 'atan'
+    Exp,  /// 'exp'
+    Log   /// 'log'
+};
+
+/// Vectorized implementations of the built-in math functions based on the Cephes library.
+/// All functions accept 'num' and vector types, 'int' arguments are converted to 'num'. Vector types are handled component wise.
+/// The same algorithm is used for all instruction sets and the scalar path, which all return bitwise identical results.
+/// Maximum error against the standard library, as measured by test/mathlibrary.cpp:
+/// - sin: 2 ulp, cos: 1 ulp for |x| <= 2^30. Larger arguments are forwarded to std::sin and std::cos.
+/// - tan: 2 ulp for |x| <= 2^30. Larger arguments are forwarded to std::tan.
+/// - asin, acos: 1 ulp for |x| <= 1.
+/// - atan: 1 ulp.
+/// - exp: 2 ulp for results in the normal range. Results below it are flushed to zero.
+/// - log: 1 ulp.
+class MathLibrary {
+public:
+    /// Returns the function with the given name, if available.
+    static std::optional<MathFunction> find(std::string_view name);
+    /// Name of the given function.
+    static const char* name(MathFunction func);
+
+    /// Lookup function providing definitions for all built-in math functions.
+    /// All definitions are flagged pure, use resolveNative as OptimizeOptions::Resolver to fold them.
+    static std::optional<FunctionDef> lookup(const FunctionLookup& lkp);
+    /// Native resolver for all built-in math functions. Can be used with Environment::compile and Environment::optimize.
+    static NativeFunction resolveNative(const FunctionDef& def);
+    /// Batch native resolver for all built-in math functions. Can be used with BatchEvaluator.
+    static BatchNativeFunction resolveBatchNative(const FunctionDef& def);
+    /// Register all built-in math functions to the given environment.
+    static void registerFunctions(Environment& env);
+
+    /// Scalar reference implementation.
+    static Number evaluate(MathFunction func, Number x);
+    /// Evaluate the function for all given values with the given instruction set. The input and output may be the same array.
+    static void evaluate(MathFunction func, const Number* in, Number* out, size_t count, SimdLevel level = detectSimdLevel());
+};
+} // namespace PExpr
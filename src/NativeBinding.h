@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Program.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace PExpr {
+namespace internal {
+/// Mapping of a C++ type to an elementary type and its register layout.
+template <typename T>
+struct NativeType;
+
+template <>
+struct NativeType<bool> {
+    static constexpr ElementaryType Type = ElementaryType::Boolean;
+    static constexpr size_t Size         = 1;
+    static inline bool load(const Cell* cells) { return cells[0].Bool; }
+    static inline void store(Cell* cells, bool v) { cells[0].Bool = v; }
+};
+
+template <>
+struct NativeType<Integer> {
+    static constexpr ElementaryType Type = ElementaryType::Integer;
+    static constexpr size_t Size         = 1;
+    static inline Integer load(const Cell* cells) { return cells[0].Int; }
+    static inline void store(Cell* cells, Integer v) { cells[0].Int = v; }
+};
+
+template <>
+struct NativeType<Number> {
+    static constexpr ElementaryType Type = ElementaryType::Number;
+    static constexpr size_t Size         = 1;
+    static inline Number load(const Cell* cells) { return cells[0].Num; }
+    static inline void store(Cell* cells, Number v) { cells[0].Num = v; }
+};
+
+template <size_t N, ElementaryType VecType>
+struct NativeVecType {
+    static constexpr ElementaryType Type = VecType;
+    static constexpr size_t Size         = N;
+    static inline std::array<Number, N> load(const Cell* cells)
+    {
+        std::array<Number, N> v;
+        for (size_t i = 0; i < N; ++i)
+            v[i] = cells[i].Num;
+        return v;
+    }
+    static inline void store(Cell* cells, const std::array<Number, N>& v)
+    {
+        for (size_t i = 0; i < N; ++i)
+            cells[i].Num = v[i];
+    }
+};
+
+template <>
+struct NativeType<Vec2> : public NativeVecType<2, ElementaryType::Vec2> {
+};
+template <>
+struct NativeType<Vec3> : public NativeVecType<3, ElementaryType::Vec3> {
+};
+template <>
+struct NativeType<Vec4> : public NativeVecType<4, ElementaryType::Vec4> {
+};
+
+/// Strings can only be passed as parameters, as a result would have no storage to live in.
+template <>
+struct NativeType<std::string> {
+    static constexpr ElementaryType Type = ElementaryType::String;
+    static constexpr size_t Size         = 1;
+    static inline const std::string& load(const Cell* cells) { return *cells[0].Str; }
+};
+
+template <typename T>
+using NativeTypeOf = NativeType<std::remove_cv_t<std::remove_reference_t<T>>>;
+
+/// Signature of a native function with the parameters placed in consecutive registers.
+template <typename R, typename... Args>
+struct NativeSignatureBase {
+    static_assert(!std::is_same_v<std::decay_t<R>, std::string>, "Native functions can not return strings");
+
+    static inline ElementaryType returnType() { return NativeTypeOf<R>::Type; }
+    static inline std::vector<ElementaryType> parameters() { return { NativeTypeOf<Args>::Type... }; }
+
+    template <typename Func>
+    static inline NativeFunction wrap(Func&& func)
+    {
+        return [func = std::forward<Func>(func)](const Cell* args, Cell* result) {
+            invoke(func, args, result, std::index_sequence_for<Args...>());
+        };
+    }
+
+private:
+    /// Register offset of each parameter
+    static constexpr std::array<size_t, sizeof...(Args)> offsets()
+    {
+        std::array<size_t, sizeof...(Args)> offsets{};
+        constexpr size_t sizes[] = { NativeTypeOf<Args>::Size..., 0 };
+        size_t offset            = 0;
+        for (size_t i = 0; i < sizeof...(Args); ++i) {
+            offsets[i] = offset;
+            offset += sizes[i];
+        }
+        return offsets;
+    }
+
+    template <typename Func, size_t... I>
+    static inline void invoke(const Func& func, const Cell* args, Cell* result, std::index_sequence<I...>)
+    {
+        constexpr auto Offsets = offsets();
+        PEXPR_UNUSED(Offsets);
+        PEXPR_UNUSED(args);
+        NativeTypeOf<R>::store(result, func(NativeTypeOf<Args>::load(args + Offsets[I])...));
+    }
+};
+
+/// Deduces the signature of function pointers and callables with a single, non-template call operator.
+template <typename Func>
+struct NativeSignature : public NativeSignature<decltype(&Func::operator())> {
+};
+
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...)> : public NativeSignatureBase<R, Args...> {
+};
+
+template <typename R, typename... Args>
+struct NativeSignature<R(Args...)> : public NativeSignatureBase<R, Args...> {
+};
+
+template <typename C, typename R, typename... Args>
+struct NativeSignature<R (C::*)(Args...)> : public NativeSignatureBase<R, Args...> {
+};
+
+template <typename C, typename R, typename... Args>
+struct NativeSignature<R (C::*)(Args...) const> : public NativeSignatureBase<R, Args...> {
+};
+} // namespace internal
+
+/// Signature of a C++ function bindable via Environment::registerNative.
+/// Supported parameter types are 'bool', 'Integer', 'Number', 'Vec2', 'Vec3', 'Vec4' and 'std::string', the latter not as return type.
+template <typename Func>
+using NativeSignature = internal::NativeSignature<std::decay_t<Func>>;
+} // namespace PExpr
@@ -2,12 +2,27 @@
 
 #include "PExpr_Config.h"
 
+#include "Arena.h"
+#include "BatchEvaluator.h"
+#include "Bindings.h"
 #include "Definitions.h"
+#include "Diagnostics.h"
 #include "Enums.h"
 #include "Environment.h"
 #include "Expression.h"
+#include "ExpressionInterner.h"
+#include "Fingerprint.h"
+#include "FlatExpression.h"
 #include "LogListener.h"
 #include "Logger.h"
 #include "Lookup.h"
+#include "MathLibrary.h"
+#include "NativeBinding.h"
+#include "Program.h"
+#include "Statistics.h"
 #include "StringVisitor.h"
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+#include "TranspileCache.h"
 #include "TranspileVisitor.h"
+#include "VirtualMachine.h"
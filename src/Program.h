@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Definitions.h"
+
+#include <deque>
+#include <functional>
+#include <string_view>
+
+namespace PExpr {
+namespace internal {
+class BytecodeCompiler;
+}
+
+/// A single register of the virtual machine.
+/// Vector types occupy two to four consecutive registers, one for each component.
+union Cell {
+    Number Num;
+    Integer Int;
+    bool Bool;
+    const std::string* Str;
+};
+static_assert(sizeof(Cell) == 8, "Expected a cell to be of the size of a double");
+
+// Integer arithmetic wraps around on overflow, i.e., is performed modulo 2^64 in two's complement like the unsigned arithmetic it is implemented with.
+
+/// Integer negation as performed by OpCode::NegInt. Negating the smallest integer wraps around to itself.
+inline Integer negateInteger(Integer a) { return (Integer)(uint64(0) - (uint64)a); }
+/// Integer addition as performed by OpCode::AddInt, wrapping around on overflow.
+inline Integer addInteger(Integer a, Integer b) { return (Integer)((uint64)a + (uint64)b); }
+/// Integer subtraction as performed by OpCode::SubInt, wrapping around on overflow.
+inline Integer subtractInteger(Integer a, Integer b) { return (Integer)((uint64)a - (uint64)b); }
+/// Integer multiplication as performed by OpCode::MulInt, wrapping around on overflow.
+inline Integer multiplyInteger(Integer a, Integer b) { return (Integer)((uint64)a * (uint64)b); }
+
+/// Integer power as performed by OpCode::PowInt. Computed exactly by squaring, wrapping around on overflow.
+/// A negative exponent gives the truncated result of 1/A^-B, which is zero unless A is 1 or -1. Zero to a negative exponent is zero, like a division by zero.
+inline Integer powerInteger(Integer a, Integer b)
+{
+    if (b < 0) {
+        if (a == 1)
+            return 1;
+        if (a == -1)
+            return (b & 1) ? -1 : 1;
+        return 0;
+    }
+
+    uint64 base   = (uint64)a;
+    uint64 result = 1;
+    for (uint64 exp = (uint64)b; exp != 0; exp >>= 1) {
+        if (exp & 1)
+            result *= base;
+        base *= base;
+    }
+    return (Integer)result;
+}
+
+/// Integer division as performed by OpCode::DivInt.
+/// Instead of trapping, a division by zero results in zero and the overflowing division of the smallest integer by -1 wraps around.
+inline Integer divideInteger(Integer a, Integer b)
+{
+    if (b == 0)
+        return 0;
+    if (b == -1)
+        return negateInteger(a);
+    return a / b;
+}
+
+/// Integer remainder as performed by OpCode::ModInt. The remainder of a division by zero is zero.
+inline Integer moduloInteger(Integer a, Integer b)
+{
+    if (b == 0 || b == -1)
+        return 0;
+    return a % b;
+}
+
+/// Native implementation of a function. All arguments are placed in consecutive registers in the order of the parameters.
+/// The result has to be written to the given cells, which are separate from the arguments.
+using NativeFunction = std::function<void(const Cell* args, Cell* result)>;
+
+/// Callback returning a native implementation for the given function definition or an empty function if none is available.
+using NativeResolver = std::function<NativeFunction(const FunctionDef& def)>;
+
+/// Operations of the virtual machine.
+/// Unless stated otherwise, Dst is the destination register, A and B are the operand registers and Lanes is the number of components.
+enum class OpCode : uint8 {
+    Move,            /// Copies Lanes registers from A
+    CastIntToNum,    /// Converts 'int' in A to 'num'
+    NegInt,          /// -A, see negateInteger()
+    NegNum,          /// -A
+    Not,             /// !A
+    AddInt,          /// A+B, see addInteger()
+    AddNum,          /// A+B
+    SubInt,          /// A-B, see subtractInteger()
+    SubNum,          /// A-B
+    MulInt,          /// A*B, see multiplyInteger()
+    MulNum,          /// A*B
+    DivInt,          /// A/B, see divideInteger()
+    DivNum,          /// A/B
+    ScaleNum,        /// A*B with a scalar B
+    DivScaleNum,     /// A/B with a scalar B
+    PowInt,          /// A^B, see powerInteger()
+    PowNum,          /// A^B with a scalar B
+    ModInt,          /// A%B, see moduloInteger()
+    And,             /// A&&B
+    Or,              /// A||B
+    LessInt,         /// A<B
+    LessNum,         /// A<B
+    GreaterInt,      /// A>B
+    GreaterNum,      /// A>B
+    LessEqualInt,    /// A<=B
+    LessEqualNum,    /// A<=B
+    GreaterEqualInt, /// A>=B
+    GreaterEqualNum, /// A>=B
+    EqualBool,       /// A==B
+    EqualInt,        /// A==B
+    EqualNum,        /// A==B for all Lanes
+    EqualString,     /// A==B
+    NotEqualBool,    /// A!=B
+    NotEqualInt,     /// A!=B
+    NotEqualNum,     /// A!=B for any of the Lanes
+    NotEqualString,  /// A!=B
+    Swizzle,         /// Lanes components from A, each selected by two bits of Extra
+    Call             /// Native function with index Extra, arguments starting at A and a result with Lanes components
+};
+
+/// A single instruction of a program.
+struct Instruction {
+    OpCode Op;
+    uint8 Lanes;
+    uint16 Extra;
+    uint32 Dst;
+    uint32 A;
+    uint32 B;
+};
+static_assert(sizeof(Instruction) == 16, "Expected an instruction to be of 16 bytes");
+
+/// A variable used by a program.
+struct ProgramVariable {
+    std::string Name;
+    ElementaryType Type;
+    uint32 Register;
+};
+
+/// Compact bytecode of a typed expression, which can be evaluated by the virtual machine.
+/// The register file starts with all constants, followed by all variables and the temporary registers.
+/// A program is immutable after compilation and can be shared by multiple virtual machines and threads.
+class Program {
+    friend internal::BytecodeCompiler;
+
+public:
+    /// Index returned for unknown variables.
+    static constexpr size_t InvalidIndex = ~size_t(0);
+
+    Program() = default;
+
+    /// All instructions in the order of execution.
+    inline const std::vector<Instruction>& instructions() const { return mInstructions; }
+    /// Initial values of the first registers.
+    inline const std::vector<Cell>& constants() const { return mConstants; }
+    /// All variables used by the program.
+    inline const std::vector<ProgramVariable>& variables() const { return mVariables; }
+    /// All native functions used by the program. Call instructions reference them by index.
+    inline const std::vector<NativeFunction>& natives() const { return mNatives; }
+    /// Signatures of all native functions used by the program.
+    inline const std::vector<FunctionDef>& functions() const { return mFunctions; }
+
+    /// Number of registers required to run the program.
+    inline size_t registerCount() const { return mRegisterCount; }
+    /// Register containing the result after running the program.
+    inline uint32 resultRegister() const { return mResultRegister; }
+    /// Type of the result.
+    inline ElementaryType resultType() const { return mResultType; }
+
+    /// Index of the variable with the given name or InvalidIndex if the program does not use it.
+    inline size_t variableIndex(std::string_view name) const
+    {
+        for (size_t i = 0; i < mVariables.size(); ++i) {
+            if (mVariables[i].Name == name)
+                return i;
+        }
+        return InvalidIndex;
+    }
+
+private:
+    std::vector<Instruction> mInstructions;
+    std::vector<Cell> mConstants;
+    std::vector<ProgramVariable> mVariables;
+    std::vector<NativeFunction> mNatives;
+    std::vector<FunctionDef> mFunctions;
+    std::deque<std::string> mStrings; // Constants point to the strings, which requires stable addresses
+    size_t mRegisterCount      = 0;
+    uint32 mResultRegister     = 0;
+    ElementaryType mResultType = ElementaryType::Unspecified;
+
+    PEXPR_CLASS_NON_COPYABLE(Program);
+};
+} // namespace PExpr
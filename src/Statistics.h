@@ -0,0 +1,20 @@
+#pragma once
+
+#include "PExpr_Config.h"
+
+namespace PExpr {
+/// Counters and timings accumulated by an Environment, see Environment::enableStatistics().
+/// Times are given in nanoseconds and summed over all threads, therefore they can exceed the wall clock time.
+struct EnvironmentStatistics {
+    uint64 LexNanoseconds       = 0; /// Time spent in the lexer.
+    uint64 ParseNanoseconds     = 0; /// Time spent in the parser, excluding the time spent in the lexer.
+    uint64 TypeCheckNanoseconds = 0; /// Time spent type checking.
+    uint64 TranspileNanoseconds = 0; /// Time spent transpiling, including the compilation to programs.
+    uint64 Tokens               = 0; /// Number of tokens produced by the lexer.
+    uint64 Nodes                = 0; /// Number of nodes allocated by the parser.
+    uint64 VariableLookups      = 0; /// Number of calls to registered variable lookup functions.
+    uint64 FunctionLookups      = 0; /// Number of calls to registered function lookup functions.
+    uint64 CacheHits            = 0; /// Number of resolutions served by the function cache and payloads served by a transpile cache.
+    uint64 Errors               = 0; /// Number of failed parse, type checking, deserialization and compile calls.
+};
+} // namespace PExpr
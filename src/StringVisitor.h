@@ -10,29 +10,29 @@ public:
     {
         switch (expr->type()) {
         case ExpressionType::Variable:
-            return dump(std::reinterpret_pointer_cast<VariableExpression>(expr));
+            return dump(static_cast<const VariableExpression*>(expr.get()));
         case ExpressionType::Literal:
-            return dump(std::reinterpret_pointer_cast<LiteralExpression>(expr));
+            return dump(static_cast<const LiteralExpression*>(expr.get()));
         case ExpressionType::Unary:
-            return dump(std::reinterpret_pointer_cast<UnaryExpression>(expr));
+            return dump(static_cast<const UnaryExpression*>(expr.get()));
         case ExpressionType::Binary:
-            return dump(std::reinterpret_pointer_cast<BinaryExpression>(expr));
+            return dump(static_cast<const BinaryExpression*>(expr.get()));
         case ExpressionType::Call:
-            return dump(std::reinterpret_pointer_cast<CallExpression>(expr));
+            return dump(static_cast<const CallExpression*>(expr.get()));
         case ExpressionType::Access:
-            return dump(std::reinterpret_pointer_cast<AccessExpression>(expr));
+            return dump(static_cast<const AccessExpression*>(expr.get()));
         default:
             return "ERROR";
         }
     };
 
 private:
-    static std::string dump(const Ptr<VariableExpression>& expr)
+    static std::string dump(const VariableExpression* expr)
     {
         return expr->name();
     }
 
-    static std::string dump(const Ptr<LiteralExpression>& expr)
+    static std::string dump(const LiteralExpression* expr)
     {
         if (expr->returnType() == ElementaryType::Boolean)
             return expr->getBool() ? "true" : "false";
@@ -45,18 +45,18 @@ private:
         return "UNKNOWN";
     }
 
-    static std::string dump(const Ptr<UnaryExpression>& expr)
+    static std::string dump(const UnaryExpression* expr)
     {
         return std::string(toString(expr->op())) + "(" + visit(expr->inner()) + ")";
     }
 
-    static std::string dump(const Ptr<BinaryExpression>& expr)
+    static std::string dump(const BinaryExpression* expr)
     {
         return "(" + visit(expr->left()) + ")"
                + std::string(toString(expr->op()))
                + "(" + visit(expr->right()) + ")";
     }
-    static std::string dump(const Ptr<CallExpression>& expr)
+    static std::string dump(const CallExpression* expr)
     {
         std::string str = expr->name() + "(";
         for (size_t i = 0; i < expr->parameters().size(); ++i) {
@@ -68,7 +68,7 @@ private:
         return str + ")";
     }
 
-    static std::string dump(const Ptr<AccessExpression>& expr)
+    static std::string dump(const AccessExpression* expr)
     {
         return "(" + visit(expr->inner()) + ")." + expr->swizzle();
     }
@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+
+namespace PExpr {
+ThreadPool::ThreadPool(size_t threadCount)
+    : mWorkers()
+    , mQueues()
+    , mGeneration(0)
+    , mStop(false)
+    , mFunction(nullptr)
+    , mRemaining(0)
+    , mException()
+{
+    if (threadCount == 0)
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    mQueues = std::make_unique<Queue[]>(threadCount);
+
+    mWorkers.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; ++i)
+        mWorkers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (auto& worker : mWorkers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunkSize, const RangeFunction& func)
+{
+    if (count == 0)
+        return;
+
+    chunkSize              = std::max<size_t>(1, chunkSize);
+    const size_t numChunks = (count + chunkSize - 1) / chunkSize;
+
+    // Not worth waking up any worker
+    if (numChunks == 1 || mWorkers.empty()) {
+        func(0, count, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(mCallMutex);
+
+    mFunction  = &func;
+    mException = nullptr;
+    mRemaining = numChunks;
+
+    // Give each thread a contiguous sequence of chunks. Stealing takes care of imbalances
+    const size_t threads = threadCount();
+    for (size_t t = 0; t < threads; ++t) {
+        const size_t start = t * numChunks / threads;
+        const size_t end   = (t + 1) * numChunks / threads;
+
+        std::lock_guard<std::mutex> lock(mQueues[t].Mutex);
+        for (size_t c = start; c < end; ++c)
+            mQueues[t].Chunks.push_back(Chunk{ c * chunkSize, std::min(count, (c + 1) * chunkSize) });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mGeneration;
+    }
+    mWakeCondition.notify_all();
+
+    runChunks(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [&]() { return mRemaining == 0; });
+    }
+
+    mFunction = nullptr;
+    if (mException)
+        std::rethrow_exception(mException);
+}
+
+void ThreadPool::workerLoop(size_t thread)
+{
+    size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [&]() { return mStop || mGeneration != generation; });
+            if (mStop)
+                return;
+            generation = mGeneration;
+        }
+
+        runChunks(thread);
+    }
+}
+
+void ThreadPool::runChunks(size_t thread)
+{
+    Chunk chunk;
+    while (popChunk(thread, chunk)) {
+        try {
+            (*mFunction)(chunk.Begin, chunk.End, thread);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mException)
+                mException = std::current_exception();
+        }
+
+        if (mRemaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mDoneCondition.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::popChunk(size_t thread, Chunk& chunk)
+{
+    // Own chunks are taken from the front to keep the order, others are stolen from the back
+    {
+        Queue& queue = mQueues[thread];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (!queue.Chunks.empty()) {
+            chunk = queue.Chunks.front();
+            queue.Chunks.pop_front();
+            return true;
+        }
+    }
+
+    const size_t threads = threadCount();
+    for (size_t i = 1; i < threads; ++i) {
+        Queue& queue = mQueues[(thread + i) % threads];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (!queue.Chunks.empty()) {
+            chunk = queue.Chunks.back();
+            queue.Chunks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+} // namespace PExpr
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "PExpr_Config.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace PExpr {
+/// Simple pool of worker threads with work stealing.
+/// Work is split into chunks which are distributed over per-thread queues. A thread running out of work steals chunks from the others,
+/// such that a few expensive chunks do not stall the rest.
+/// The pool can be shared between many calls, e.g., Environment::parseBatch, to prevent repeated thread creation.
+class ThreadPool {
+public:
+    /// Function called for the range [begin, end) by the thread with the given index in [0, threadCount()).
+    using RangeFunction = std::function<void(size_t begin, size_t end, size_t thread)>;
+
+    /// Creates a pool with the given number of threads, including the calling thread.
+    /// If threadCount is zero, the number of hardware threads is used.
+    explicit ThreadPool(size_t threadCount = 0);
+    /// Stops and joins all worker threads.
+    ~ThreadPool();
+
+    /// Number of threads participating in a call, including the calling thread.
+    inline size_t threadCount() const { return mWorkers.size() + 1; }
+
+    /// Calls func for all chunks of at most chunkSize elements in [0, count) and blocks until all chunks are done.
+    /// The calling thread participates with index 0. Calls from multiple threads are serialized.
+    /// The first exception thrown by func is rethrown after all chunks are done.
+    /// Do not call parallelFor recursively from inside func on the same pool.
+    void parallelFor(size_t count, size_t chunkSize, const RangeFunction& func);
+
+private:
+    struct Chunk {
+        size_t Begin;
+        size_t End;
+    };
+
+    // Each queue is placed on its own cache line to prevent false sharing
+    struct alignas(64) Queue {
+        std::mutex Mutex;
+        std::deque<Chunk> Chunks;
+    };
+
+    void workerLoop(size_t thread);
+    void runChunks(size_t thread);
+    bool popChunk(size_t thread, Chunk& chunk);
+
+    std::vector<std::thread> mWorkers;
+    std::unique_ptr<Queue[]> mQueues;
+
+    std::mutex mCallMutex;
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    size_t mGeneration;
+    bool mStop;
+
+    const RangeFunction* mFunction;
+    std::atomic<size_t> mRemaining;
+    std::exception_ptr mException;
+
+    PEXPR_CLASS_NON_COPYABLE(ThreadPool);
+};
+} // namespace PExpr
@@ -0,0 +1,126 @@
+#include "TraceRecorder.h"
+
+#include <fstream>
+#include <iomanip>
+
+namespace PExpr {
+TraceRecorder::TraceRecorder(uint32 processId)
+    : mProcessId(processId)
+    , mMutex()
+    , mEvents()
+    , mThreads()
+{
+}
+
+void TraceRecorder::record(const char* name, const Clock::time_point& start, const Clock::time_point& end, const void* id, size_t size, std::string_view detail)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const auto thread = mThreads.try_emplace(std::this_thread::get_id(), (uint32)mThreads.size() + 1).first->second;
+    mEvents.push_back(Event{ name, start, end, thread, id, size, std::string(detail) });
+}
+
+std::vector<TraceRecorder::Event> TraceRecorder::events() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEvents;
+}
+
+size_t TraceRecorder::eventCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEvents.size();
+}
+
+void TraceRecorder::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEvents.clear();
+}
+
+static void writeEscaped(std::ostream& stream, std::string_view str)
+{
+    static const char* hex = "0123456789abcdef";
+
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            stream << "\\\"";
+            break;
+        case '\\':
+            stream << "\\\\";
+            break;
+        default:
+            if ((unsigned char)c < 0x20)
+                stream << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+            else
+                stream << c;
+            break;
+        }
+    }
+}
+
+/// Microseconds with nanosecond precision as expected by the trace event format
+static void writeMicroseconds(std::ostream& stream, std::chrono::nanoseconds duration)
+{
+    const auto count = duration.count();
+    stream << count / 1000 << '.' << std::setw(3) << std::setfill('0') << (count < 0 ? -count : count) % 1000 << std::setfill(' ');
+}
+
+void TraceRecorder::write(std::ostream& stream) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Complete events ('X') contain begin and duration of a span
+    stream << "{\"traceEvents\":[";
+    for (size_t i = 0; i < mEvents.size(); ++i) {
+        const Event& event = mEvents[i];
+        stream << (i > 0 ? ",\n" : "\n") << "{\"name\":\"";
+        writeEscaped(stream, event.Name);
+        stream << "\",\"cat\":\"pexpr\",\"ph\":\"X\",\"ts\":";
+        writeMicroseconds(stream, event.Start.time_since_epoch());
+        stream << ",\"dur\":";
+        writeMicroseconds(stream, event.End - event.Start);
+        stream << ",\"pid\":" << mProcessId << ",\"tid\":" << event.Thread
+               << ",\"args\":{\"id\":\"0x" << std::hex << (uintptr_t)event.Id << std::dec
+               << "\",\"size\":" << event.Size;
+        if (!event.Detail.empty()) {
+            stream << ",\"detail\":\"";
+            writeEscaped(stream, event.Detail);
+            stream << "\"";
+        }
+        stream << "}}";
+    }
+    stream << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+
+bool TraceRecorder::writeToFile(const std::filesystem::path& path) const
+{
+    std::ofstream stream(path, std::ios::trunc);
+    write(stream);
+    return (bool)stream;
+}
+
+size_t TraceRecorder::nodeCount(const Expression* expr)
+{
+    if (!expr)
+        return 0;
+
+    switch (expr->type()) {
+    case ExpressionType::Unary:
+        return 1 + nodeCount(static_cast<const UnaryExpression*>(expr)->inner().get());
+    case ExpressionType::Binary:
+        return 1 + nodeCount(static_cast<const BinaryExpression*>(expr)->left().get()) + nodeCount(static_cast<const BinaryExpression*>(expr)->right().get());
+    case ExpressionType::Call: {
+        size_t count = 1;
+        for (const auto& param : static_cast<const CallExpression*>(expr)->parameters())
+            count += nodeCount(param.get());
+        return count;
+    }
+    case ExpressionType::Access:
+        return 1 + nodeCount(static_cast<const AccessExpression*>(expr)->inner().get());
+    default:
+        return 1;
+    }
+}
+} // namespace PExpr
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Expression.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace PExpr {
+/// Collects timed spans of the pipeline stages of an Environment, see Environment::setTraceRecorder().
+/// The spans can be written in the Chrome trace event format, which can be opened by Perfetto or chrome://tracing.
+/// Timestamps are based on std::chrono::steady_clock, which allows to merge the output with other traces of the same process using the same clock.
+/// Recording is threadsafe, each thread is assigned its own track.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Single finished span.
+    struct Event {
+        const char* Name;          /// Static name of the stage, e.g., 'parse'.
+        Clock::time_point Start;   /// Begin of the span.
+        Clock::time_point End;     /// End of the span.
+        uint32 Thread;             /// Sequential id of the recording thread, starting with 1.
+        const void* Id;            /// Address of the handled expression or nullptr. The expression might not be alive anymore.
+        size_t Size;               /// Number of handled nodes or, for lookups, the number of parameters.
+        std::string Detail;        /// Additional information, e.g., the name of a looked up function.
+    };
+
+    /// Create a recorder. The given process id is used for all events, e.g., to place them next to the tracks of a renderer.
+    explicit TraceRecorder(uint32 processId = 1);
+
+    /// Record a finished span of the calling thread.
+    void record(const char* name, const Clock::time_point& start, const Clock::time_point& end, const void* id, size_t size, std::string_view detail = {});
+
+    /// Copy of all recorded events in the order of recording.
+    std::vector<Event> events() const;
+    /// Number of recorded events.
+    size_t eventCount() const;
+    /// Remove all recorded events.
+    void clear();
+
+    /// Write all events as Chrome trace event JSON.
+    void write(std::ostream& stream) const;
+    /// Write all events as Chrome trace event JSON to the given file. Returns false if the file could not be written.
+    bool writeToFile(const std::filesystem::path& path) const;
+
+    /// Number of nodes of the given tree. Shared subtrees are counted every time.
+    static size_t nodeCount(const Expression* expr);
+
+private:
+    const uint32 mProcessId;
+    mutable std::mutex mMutex;
+    std::vector<Event> mEvents;
+    std::unordered_map<std::thread::id, uint32> mThreads;
+};
+} // namespace PExpr
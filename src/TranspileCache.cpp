@@ -0,0 +1,369 @@
+#include "TranspileCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#if defined(PEXPR_OS_LINUX) || defined(PEXPR_OS_APPLE)
+#define PEXPR_USE_FSYNC
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(PEXPR_OS_WINDOWS)
+#include <io.h>
+#endif
+
+namespace PExpr {
+namespace fs = std::filesystem;
+
+static constexpr char EntryMagic[4]         = { 'P', 'X', 'T', 'C' };
+static constexpr uint32 EntryVersion        = 1;
+static constexpr const char* EntryExtension = ".pxtc";
+static constexpr const char* TemporaryMarker = ".pxtc.tmp";
+
+static inline void writeUInt(std::string& out, uint64 value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        out += (char)((value >> (8 * i)) & 0xFF);
+}
+
+static inline bool readUInt(std::string_view& in, uint64& value, size_t bytes)
+{
+    if (in.size() < bytes)
+        return false;
+
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+        value |= (uint64)(uint8)in[i] << (8 * i);
+    in.remove_prefix(bytes);
+    return true;
+}
+
+/// Write the content and flush it to the disk, such that a following rename never exposes an incomplete file after a crash
+static bool writeDurable(const fs::path& path, std::string_view content)
+{
+#ifdef PEXPR_USE_FSYNC
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    const char* data = content.data();
+    size_t left      = content.size();
+    bool good        = true;
+    while (left > 0) {
+        const ssize_t written = ::write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            good = false;
+            break;
+        }
+        data += written;
+        left -= (size_t)written;
+    }
+
+    good = good && ::fsync(fd) == 0;
+    return ::close(fd) == 0 && good;
+#else
+    std::FILE* file = nullptr;
+#ifdef PEXPR_OS_WINDOWS
+    if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+        file = nullptr;
+#else
+    file = std::fopen(path.c_str(), "wb");
+#endif
+    if (!file)
+        return false;
+
+    bool good = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    good      = good && std::fflush(file) == 0;
+#ifdef PEXPR_OS_WINDOWS
+    good = good && _commit(_fileno(file)) == 0;
+#endif
+    return std::fclose(file) == 0 && good;
+#endif
+}
+
+/// Flush the directory itself, which makes a rename inside of it durable
+static void syncDirectory(const fs::path& directory)
+{
+#ifdef PEXPR_USE_FSYNC
+    const int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    PEXPR_UNUSED(directory);
+#endif
+}
+
+static inline bool isTemporary(const fs::path& path)
+{
+    return path.filename().string().find(TemporaryMarker) != std::string::npos;
+}
+
+/// Return the payload of the given entry if it is valid and belongs to the given key. The file name is only a hash of the key
+static std::optional<std::string_view> decodeEntry(std::string_view in, const Fingerprint& fingerprint, std::string_view backendKey)
+{
+    if (in.size() < sizeof(EntryMagic) || std::memcmp(in.data(), EntryMagic, sizeof(EntryMagic)) != 0)
+        return {};
+    in.remove_prefix(sizeof(EntryMagic));
+
+    uint64 version = 0;
+    if (!readUInt(in, version, 4) || version != EntryVersion)
+        return {};
+
+    Fingerprint stored;
+    if (!readUInt(in, stored.Low, 8) || !readUInt(in, stored.High, 8) || stored != fingerprint)
+        return {};
+
+    uint64 keySize = 0;
+    if (!readUInt(in, keySize, 4) || in.size() < keySize || in.substr(0, keySize) != backendKey)
+        return {};
+    in.remove_prefix(keySize);
+
+    uint64 dataSize = 0;
+    if (!readUInt(in, dataSize, 8) || in.size() != dataSize)
+        return {};
+
+    return in;
+}
+
+TranspileCache::TranspileCache(const fs::path& directory, size_t maxBytes)
+    : mDirectory(directory)
+    , mMaxBytes(maxBytes)
+    , mMutex()
+    , mSizeBytes(0)
+    , mHits(0)
+    , mMisses(0)
+    , mEvictions(0)
+    , mTemporaryCounter(0)
+    , mEvicting(false)
+    , mEvictAgain(false)
+{
+    std::error_code ec;
+    fs::create_directories(mDirectory, ec);
+
+    for (const auto& entry : fs::directory_iterator(mDirectory, ec)) {
+        if (entry.path().extension() == EntryExtension)
+            mSizeBytes += (size_t)entry.file_size(ec);
+    }
+
+    removeStaleTemporaries();
+}
+
+void TranspileCache::removeStaleTemporaries()
+{
+    // Temporaries of running writers are young, only old ones belong to crashed writers
+    const auto limit = fs::file_time_type::clock::now() - StaleTemporaryAge;
+
+    std::vector<fs::path> stale;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(mDirectory, ec)) {
+        if (!isTemporary(entry.path()))
+            continue;
+
+        const auto time = entry.last_write_time(ec);
+        if (!ec && time < limit)
+            stale.push_back(entry.path());
+    }
+
+    for (const auto& path : stale)
+        fs::remove(path, ec);
+}
+
+fs::path TranspileCache::entryPath(const Fingerprint& fingerprint, std::string_view backendKey) const
+{
+    return mDirectory / (fingerprint.combine(backendKey).toString() + EntryExtension);
+}
+
+std::optional<std::string> TranspileCache::load(const Fingerprint& fingerprint, std::string_view backendKey)
+{
+    const fs::path path = entryPath(fingerprint, backendKey);
+
+    std::string content;
+    {
+        std::ifstream stream(path, std::ios::binary);
+        if (stream)
+            content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    const auto data = decodeEntry(content, fingerprint, backendKey);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!data.has_value()) {
+        ++mMisses;
+        return {};
+    }
+
+    // Mark entry as recently used
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+    ++mHits;
+    return std::string(data.value());
+}
+
+bool TranspileCache::store(const Fingerprint& fingerprint, std::string_view backendKey, std::string_view data)
+{
+    std::string content;
+    content.reserve(sizeof(EntryMagic) + 4 + 16 + 4 + backendKey.size() + 8 + data.size());
+    content.append(EntryMagic, sizeof(EntryMagic));
+    writeUInt(content, EntryVersion, 4);
+    writeUInt(content, fingerprint.Low, 8);
+    writeUInt(content, fingerprint.High, 8);
+    writeUInt(content, backendKey.size(), 4);
+    content.append(backendKey);
+    writeUInt(content, data.size(), 8);
+    content.append(data);
+
+    const fs::path path = entryPath(fingerprint, backendKey);
+
+    // Other processes might write the same entry, make the temporary name unique
+    size_t counter;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        counter = mTemporaryCounter++;
+    }
+    const size_t unique = std::hash<std::thread::id>()(std::this_thread::get_id())
+                          ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    fs::path temporary = path;
+    temporary += ".tmp" + std::to_string(unique) + "_" + std::to_string(counter);
+
+    // Writing, flushing and renaming is done without the lock, so other threads are not blocked by slow disks
+    if (!writeDurable(temporary, content)) {
+        std::error_code ec;
+        fs::remove(temporary, ec);
+        return false;
+    }
+
+    std::error_code ec;
+    const auto previousSize = fs::file_size(path, ec);
+    const bool replaced     = !ec;
+
+    fs::rename(temporary, path, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    syncDirectory(mDirectory);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (replaced)
+            mSizeBytes -= std::min<size_t>(mSizeBytes, (size_t)previousSize);
+        mSizeBytes += content.size();
+
+        // Only a single thread rescans the directory, the others request another pass to be accounted for
+        if (mEvicting) {
+            mEvictAgain = true;
+            return true;
+        }
+        if (mSizeBytes <= mMaxBytes)
+            return true;
+        mEvicting = true;
+    }
+
+    evict();
+    return true;
+}
+
+// Called without the lock held, only the counters are updated under the lock
+void TranspileCache::evict()
+{
+    struct Entry {
+        fs::file_time_type Time;
+        size_t Size;
+        fs::path Path;
+    };
+
+    for (;;) {
+        // Rescan the directory, other processes might have changed it
+        std::vector<Entry> entries;
+        size_t total = 0;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(mDirectory, ec)) {
+            if (entry.path().extension() != EntryExtension)
+                continue;
+
+            const size_t size = (size_t)entry.file_size(ec);
+            if (ec)
+                continue;
+            const auto time = entry.last_write_time(ec);
+            if (ec)
+                continue;
+
+            entries.push_back(Entry{ time, size, entry.path() });
+            total += size;
+        }
+
+        removeStaleTemporaries();
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.Time < b.Time; });
+
+        size_t evicted = 0;
+        for (const auto& entry : entries) {
+            if (total <= mMaxBytes)
+                break;
+            if (fs::remove(entry.Path, ec)) {
+                total -= entry.Size;
+                ++evicted;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEvictions += evicted;
+        mSizeBytes = total;
+
+        // Entries stored during the scan might be missing from it, rescan to account for them
+        if (!mEvictAgain) {
+            mEvicting = false;
+            return;
+        }
+        mEvictAgain = false;
+    }
+}
+
+void TranspileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<fs::path> paths;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(mDirectory, ec)) {
+        if (entry.path().extension() == EntryExtension)
+            paths.push_back(entry.path());
+    }
+
+    for (const auto& path : paths)
+        fs::remove(path, ec);
+
+    mSizeBytes = 0;
+}
+
+size_t TranspileCache::sizeBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSizeBytes;
+}
+
+size_t TranspileCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+size_t TranspileCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMisses;
+}
+
+size_t TranspileCache::evictions() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEvictions;
+}
+} // namespace PExpr
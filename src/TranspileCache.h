@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Fingerprint.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace PExpr {
+/// Conversion of a transpile payload to and from bytes stored by TranspileCache.
+/// Specialize for custom payloads, a specialization for std::string is provided.
+template <typename Payload>
+struct TranspileCacheCodec;
+
+template <>
+struct TranspileCacheCodec<std::string> {
+    static inline std::string encode(const std::string& payload) { return payload; }
+    static inline std::optional<std::string> decode(std::string_view data) { return std::string(data); }
+};
+
+/// Persistent cache of transpiled payloads in a local directory, shared between processes and program runs.
+/// Entries are keyed by the fingerprint of the type checked expression and a user supplied key identifying the backend and its version.
+/// Each entry is a single file, written to a temporary file first, flushed to disk and renamed afterwards, therefore readers never observe partial entries.
+/// Temporary files left behind by crashed writers are removed once they are older than StaleTemporaryAge, when the cache is opened or entries are evicted.
+/// If the size of all entries exceeds the given limit, the least recently used entries are evicted. The access time is tracked via the file modification time.
+/// All operations are threadsafe. File system errors are not fatal, a failing cache behaves like an empty one.
+class TranspileCache {
+public:
+    static constexpr size_t DefaultMaxBytes = 64 * 1024 * 1024;
+    /// Age after which a temporary file is considered to be left behind by a crashed writer.
+    static constexpr std::chrono::minutes StaleTemporaryAge = std::chrono::minutes(10);
+
+    /// Opens the cache in the given directory, which is created if necessary.
+    explicit TranspileCache(const std::filesystem::path& directory, size_t maxBytes = DefaultMaxBytes);
+
+    /// Return the stored bytes for the given key or nothing if not available.
+    std::optional<std::string> load(const Fingerprint& fingerprint, std::string_view backendKey);
+    /// Store the given bytes for the given key, replacing a previous entry. Returns false if the entry could not be written.
+    bool store(const Fingerprint& fingerprint, std::string_view backendKey, std::string_view data);
+    /// Remove all entries.
+    void clear();
+
+    /// Directory the entries are stored in.
+    inline const std::filesystem::path& directory() const { return mDirectory; }
+    /// Maximum size of all entries in bytes.
+    inline size_t maxBytes() const { return mMaxBytes; }
+    /// Size of all entries in bytes as known to this instance.
+    size_t sizeBytes() const;
+
+    /// Number of successful loads.
+    size_t hits() const;
+    /// Number of loads without an entry.
+    size_t misses() const;
+    /// Number of entries removed to stay below the size limit.
+    size_t evictions() const;
+
+private:
+    std::filesystem::path entryPath(const Fingerprint& fingerprint, std::string_view backendKey) const;
+    void evict();
+    void removeStaleTemporaries();
+
+    const std::filesystem::path mDirectory;
+    const size_t mMaxBytes;
+
+    mutable std::mutex mMutex;
+    size_t mSizeBytes;
+    size_t mHits;
+    size_t mMisses;
+    size_t mEvictions;
+    size_t mTemporaryCounter;
+    bool mEvicting;
+    bool mEvictAgain;
+
+    PEXPR_CLASS_NON_COPYABLE(TranspileCache);
+};
+} // namespace PExpr
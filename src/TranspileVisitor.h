@@ -1,6 +1,6 @@
 #pragma once
 
-#include "PExpr_Config.h"
+#include "Definitions.h"
 
 namespace PExpr {
 /// Available relational operations.
@@ -19,6 +19,14 @@ public:
     /// Access to a variable.
     virtual Payload onVariable(const std::string& name, ElementaryType expectedType) = 0;
 
+    /// Access to a variable assigned to a slot by VariableLayout::assign.
+    /// Forwards to onVariable by default. Override it to fetch values from Bindings by slot instead of the name.
+    virtual Payload onSlotVariable(const VariableDef& def, uint32 slot)
+    {
+        PEXPR_UNUSED(slot);
+        return onVariable(def.name(), def.type());
+    }
+
     /// An 'int' literal.
     virtual Payload onInteger(Integer v) = 0;
 
@@ -61,7 +69,7 @@ public:
     /// a < b... Boolean operation. a & b are of the same type. Only called for scaler arithmetic types (int, num)
     virtual Payload onRelOp(RelationalOp op, ElementaryType scalarArithType, const Payload& a, const Payload& b) = 0;
 
-    /// a==b, a!=b. For vectorized types it should check that all equal componont wise. The negation a!=b should behave as !(a==b)
+    /// a==b, a!=b. a & b are of the same type, an 'int' compared to a 'num' is casted before. For vectorized types it should check that all equal componont wise. The negation a!=b should behave as !(a==b)
     virtual Payload onEqual(bool isNeg, ElementaryType type, const Payload& a, const Payload& b) = 0;
 
     /// name(...). Call to a function. Necessary casts are already handled.
@@ -70,6 +78,32 @@ public:
                                    const std::vector<Payload>& argumentPayloads)
         = 0;
 
+    /// name(...). Call to a resolved function definition. Necessary casts are already handled.
+    /// Forwards to onFunctionCall by default. Override it to dispatch bound natives via FunctionDef::nativeIndex() instead of the name.
+    virtual Payload onResolvedCall(const FunctionDef& def, const std::vector<Payload>& argumentPayloads)
+    {
+        return onFunctionCall(def.name(), def.returnType(), def.parameters(), argumentPayloads);
+    }
+
+    /// First occurrence of a subtree used multiple times, only called if common subexpression elimination is enabled.
+    /// The returned payload is passed to all later occurrences via onTemporaryRef, e.g., emit a local named by the id and return a reference to it.
+    /// Ids are dense and numbered in the order of the first occurrence. Returns the value itself by default.
+    virtual Payload onTemporary(uint32 id, ElementaryType type, const Payload& value)
+    {
+        PEXPR_UNUSED(id);
+        PEXPR_UNUSED(type);
+        return value;
+    }
+
+    /// Later occurrence of a subtree already handled by onTemporary. The value is the payload returned by onTemporary.
+    /// Returns the value itself by default.
+    virtual Payload onTemporaryRef(uint32 id, ElementaryType type, const Payload& value)
+    {
+        PEXPR_UNUSED(id);
+        PEXPR_UNUSED(type);
+        return value;
+    }
+
     /// a.xyz Access operator for vector types
     virtual Payload onAccess(const Payload& v, size_t inputSize, const std::vector<uint8>& outputPermutation) = 0;
 };
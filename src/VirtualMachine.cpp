@@ -0,0 +1,186 @@
+#include "VirtualMachine.h"
+
+namespace PExpr {
+VirtualMachine::VirtualMachine(const Ptr<const Program>& program)
+    : mProgram(program)
+    , mRegisters(program->registerCount(), Cell{ 0 })
+{
+    std::copy(program->constants().begin(), program->constants().end(), mRegisters.begin());
+}
+
+// All component wise operations compute into a local array first, as the destination is allowed to overlap the operands
+template <typename Func>
+static inline void unaryLanes(Cell* dst, const Cell* a, uint8 lanes, Func func)
+{
+    Number out[4];
+    for (uint8 i = 0; i < lanes; ++i)
+        out[i] = func(a[i].Num);
+    for (uint8 i = 0; i < lanes; ++i)
+        dst[i].Num = out[i];
+}
+
+template <typename Func>
+static inline void binaryLanes(Cell* dst, const Cell* a, const Cell* b, uint8 lanes, Func func)
+{
+    Number out[4];
+    for (uint8 i = 0; i < lanes; ++i)
+        out[i] = func(a[i].Num, b[i].Num);
+    for (uint8 i = 0; i < lanes; ++i)
+        dst[i].Num = out[i];
+}
+
+template <typename Func>
+static inline void scalarLanes(Cell* dst, const Cell* a, const Cell* b, uint8 lanes, Func func)
+{
+    const Number f = b[0].Num;
+    Number out[4];
+    for (uint8 i = 0; i < lanes; ++i)
+        out[i] = func(a[i].Num, f);
+    for (uint8 i = 0; i < lanes; ++i)
+        dst[i].Num = out[i];
+}
+
+static inline bool equalLanes(const Cell* a, const Cell* b, uint8 lanes)
+{
+    bool res = true;
+    for (uint8 i = 0; i < lanes; ++i)
+        res = res && a[i].Num == b[i].Num;
+    return res;
+}
+
+void VirtualMachine::execute(const Program& program, Cell* R)
+{
+    const NativeFunction* natives = program.natives().data();
+
+    for (const Instruction& ins : program.instructions()) {
+        Cell* dst     = R + ins.Dst;
+        const Cell* a = R + ins.A;
+        const Cell* b = R + ins.B;
+
+        switch (ins.Op) {
+        case OpCode::Move: {
+            Cell out[4];
+            std::copy(a, a + ins.Lanes, out);
+            std::copy(out, out + ins.Lanes, dst);
+        } break;
+        case OpCode::CastIntToNum:
+            dst->Num = Number(a->Int);
+            break;
+        case OpCode::NegInt:
+            dst->Int = negateInteger(a->Int);
+            break;
+        case OpCode::NegNum:
+            unaryLanes(dst, a, ins.Lanes, [](Number x) { return -x; });
+            break;
+        case OpCode::Not:
+            dst->Bool = !a->Bool;
+            break;
+        case OpCode::AddInt:
+            dst->Int = addInteger(a->Int, b->Int);
+            break;
+        case OpCode::AddNum:
+            binaryLanes(dst, a, b, ins.Lanes, [](Number x, Number y) { return x + y; });
+            break;
+        case OpCode::SubInt:
+            dst->Int = subtractInteger(a->Int, b->Int);
+            break;
+        case OpCode::SubNum:
+            binaryLanes(dst, a, b, ins.Lanes, [](Number x, Number y) { return x - y; });
+            break;
+        case OpCode::MulInt:
+            dst->Int = multiplyInteger(a->Int, b->Int);
+            break;
+        case OpCode::MulNum:
+            binaryLanes(dst, a, b, ins.Lanes, [](Number x, Number y) { return x * y; });
+            break;
+        case OpCode::DivInt:
+            dst->Int = divideInteger(a->Int, b->Int);
+            break;
+        case OpCode::DivNum:
+            binaryLanes(dst, a, b, ins.Lanes, [](Number x, Number y) { return x / y; });
+            break;
+        case OpCode::ScaleNum:
+            scalarLanes(dst, a, b, ins.Lanes, [](Number x, Number f) { return x * f; });
+            break;
+        case OpCode::DivScaleNum:
+            scalarLanes(dst, a, b, ins.Lanes, [](Number x, Number f) { return x / f; });
+            break;
+        case OpCode::PowInt:
+            dst->Int = powerInteger(a->Int, b->Int);
+            break;
+        case OpCode::PowNum:
+            scalarLanes(dst, a, b, ins.Lanes, [](Number x, Number f) { return std::pow(x, f); });
+            break;
+        case OpCode::ModInt:
+            dst->Int = moduloInteger(a->Int, b->Int);
+            break;
+        case OpCode::And:
+            dst->Bool = a->Bool && b->Bool;
+            break;
+        case OpCode::Or:
+            dst->Bool = a->Bool || b->Bool;
+            break;
+        case OpCode::LessInt:
+            dst->Bool = a->Int < b->Int;
+            break;
+        case OpCode::LessNum:
+            dst->Bool = a->Num < b->Num;
+            break;
+        case OpCode::GreaterInt:
+            dst->Bool = a->Int > b->Int;
+            break;
+        case OpCode::GreaterNum:
+            dst->Bool = a->Num > b->Num;
+            break;
+        case OpCode::LessEqualInt:
+            dst->Bool = a->Int <= b->Int;
+            break;
+        case OpCode::LessEqualNum:
+            dst->Bool = a->Num <= b->Num;
+            break;
+        case OpCode::GreaterEqualInt:
+            dst->Bool = a->Int >= b->Int;
+            break;
+        case OpCode::GreaterEqualNum:
+            dst->Bool = a->Num >= b->Num;
+            break;
+        case OpCode::EqualBool:
+            dst->Bool = a->Bool == b->Bool;
+            break;
+        case OpCode::EqualInt:
+            dst->Bool = a->Int == b->Int;
+            break;
+        case OpCode::EqualNum:
+            dst->Bool = equalLanes(a, b, ins.Lanes);
+            break;
+        case OpCode::EqualString:
+            dst->Bool = *a->Str == *b->Str;
+            break;
+        case OpCode::NotEqualBool:
+            dst->Bool = a->Bool != b->Bool;
+            break;
+        case OpCode::NotEqualInt:
+            dst->Bool = a->Int != b->Int;
+            break;
+        case OpCode::NotEqualNum:
+            dst->Bool = !equalLanes(a, b, ins.Lanes);
+            break;
+        case OpCode::NotEqualString:
+            dst->Bool = *a->Str != *b->Str;
+            break;
+        case OpCode::Swizzle: {
+            Number out[4];
+            for (uint8 i = 0; i < ins.Lanes; ++i)
+                out[i] = a[(ins.Extra >> (2 * i)) & 0x3].Num;
+            for (uint8 i = 0; i < ins.Lanes; ++i)
+                dst[i].Num = out[i];
+        } break;
+        case OpCode::Call: {
+            Cell out[4];
+            natives[ins.Extra](a, out);
+            std::copy(out, out + ins.Lanes, dst);
+        } break;
+        }
+    }
+}
+} // namespace PExpr
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Program.h"
+
+namespace PExpr {
+/// Interpreter for compiled programs.
+/// Each machine owns its own register file, which is allocated once. Running a program does not allocate any memory.
+/// A machine is not threadsafe, but multiple machines can share the same program.
+class VirtualMachine {
+public:
+    /// Creates a machine for the given program and initializes the constants.
+    explicit VirtualMachine(const Ptr<const Program>& program);
+
+    /// The program executed by the machine.
+    inline const Program& program() const { return *mProgram; }
+
+    /// Set the value of the variable with the given index, see Program::variableIndex.
+    inline void setBool(size_t variable, bool v) { this->variable(variable)[0].Bool = v; }
+    inline void setInteger(size_t variable, Integer v) { this->variable(variable)[0].Int = v; }
+    inline void setNumber(size_t variable, Number v) { this->variable(variable)[0].Num = v; }
+    inline void setVec2(size_t variable, const Vec2& v) { setLanes(variable, v.data(), 2); }
+    inline void setVec3(size_t variable, const Vec3& v) { setLanes(variable, v.data(), 3); }
+    inline void setVec4(size_t variable, const Vec4& v) { setLanes(variable, v.data(), 4); }
+    /// The string has to be valid while the program is running.
+    inline void setString(size_t variable, const std::string* v) { this->variable(variable)[0].Str = v; }
+
+    /// Registers of the variable with the given index.
+    inline Cell* variable(size_t variable)
+    {
+        PEXPR_ASSERT(variable < mProgram->variables().size(), "Invalid variable index");
+        return &mRegisters[mProgram->variables()[variable].Register];
+    }
+
+    /// Execute the program.
+    inline void run() { execute(*mProgram, mRegisters.data()); }
+
+    /// Registers of the result after running the program.
+    inline const Cell* result() const { return &mRegisters[mProgram->resultRegister()]; }
+
+    inline bool resultBool() const { return result()[0].Bool; }
+    inline Integer resultInteger() const { return result()[0].Int; }
+    inline Number resultNumber() const { return result()[0].Num; }
+    inline Vec2 resultVec2() const { return Vec2{ result()[0].Num, result()[1].Num }; }
+    inline Vec3 resultVec3() const { return Vec3{ result()[0].Num, result()[1].Num, result()[2].Num }; }
+    inline Vec4 resultVec4() const { return Vec4{ result()[0].Num, result()[1].Num, result()[2].Num, result()[3].Num }; }
+    inline const std::string& resultString() const { return *result()[0].Str; }
+
+    /// Execute the program on the given register file, which has to contain at least Program::registerCount() registers.
+    /// The constants and variables have to be initialized in advance.
+    static void execute(const Program& program, Cell* registers);
+
+private:
+    inline void setLanes(size_t variable, const Number* v, size_t lanes)
+    {
+        Cell* cells = this->variable(variable);
+        for (size_t i = 0; i < lanes; ++i)
+            cells[i].Num = v[i];
+    }
+
+    Ptr<const Program> mProgram;
+    std::vector<Cell> mRegisters;
+};
+} // namespace PExpr
@@ -0,0 +1,179 @@
+#include "CommonSubexpressions.h"
+
+namespace PExpr::internal {
+template <typename T>
+static inline void appendBytes(std::string& key, const T& value)
+{
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+CommonSubexpressions::CommonSubexpressions(const Ptr<Expression>& root)
+    : mCanonicalMap()
+    , mNodeMap()
+    , mUses()
+    , mWorthy()
+    , mImpure()
+    , mTrapping()
+    , mShared()
+    , mSharedCount(0)
+{
+    const uint32 rootId = canonicalize(root.get());
+    mUses[rootId] += 1;
+
+    std::unordered_map<const Expression*, uint8> visited;
+    excludeGuarded(root.get(), false, visited);
+
+    std::vector<uint32> sharedIndex(mUses.size(), InvalidIndex);
+    for (const auto& p : mNodeMap) {
+        const uint32 id = p.second;
+        if (!mWorthy[id] || mUses[id] < 2)
+            continue;
+
+        if (sharedIndex[id] == InvalidIndex)
+            sharedIndex[id] = (uint32)mSharedCount++;
+        mShared.emplace(p.first, sharedIndex[id]);
+    }
+
+    // Only needed while building
+    mCanonicalMap.clear();
+    mNodeMap.clear();
+}
+
+uint32 CommonSubexpressions::canonicalize(const Expression* expr)
+{
+    const auto it = mNodeMap.find(expr);
+    if (it != mNodeMap.end())
+        return it->second;
+
+    std::string key;
+    key += (char)expr->type();
+    key += (char)expr->returnType();
+
+    std::vector<uint32> children;
+    bool unique = false;
+    switch (expr->type()) {
+    case ExpressionType::Variable:
+        key += static_cast<const VariableExpression*>(expr)->name();
+        break;
+    case ExpressionType::Literal: {
+        const auto lit = static_cast<const LiteralExpression*>(expr);
+        switch (lit->returnType()) {
+        case ElementaryType::Boolean:
+            key += lit->getBool() ? '1' : '0';
+            break;
+        case ElementaryType::Integer:
+            appendBytes(key, lit->getInteger());
+            break;
+        case ElementaryType::Number:
+            appendBytes(key, lit->getNumber());
+            break;
+        case ElementaryType::String:
+            key += lit->getString();
+            break;
+        default:
+            unique = true;
+            break;
+        }
+        break;
+    }
+    case ExpressionType::Unary: {
+        const auto unary = static_cast<const UnaryExpression*>(expr);
+        key += (char)unary->op();
+        children.push_back(canonicalize(unary->inner().get()));
+        break;
+    }
+    case ExpressionType::Binary: {
+        const auto binary = static_cast<const BinaryExpression*>(expr);
+        key += (char)binary->op();
+        children.push_back(canonicalize(binary->left().get()));
+        children.push_back(canonicalize(binary->right().get()));
+        break;
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr);
+        key += call->name();
+        key += '\0';
+        for (const auto& param : call->parameters())
+            children.push_back(canonicalize(param.get()));
+        // Calls with side effects have to be evaluated for each occurrence
+        unique = !call->definition().has_value() || !call->definition().value().isPure();
+        break;
+    }
+    case ExpressionType::Access: {
+        const auto access = static_cast<const AccessExpression*>(expr);
+        key += access->swizzle();
+        key += '\0';
+        children.push_back(canonicalize(access->inner().get()));
+        break;
+    }
+    default:
+        unique = true;
+        break;
+    }
+
+    for (uint32 child : children)
+        appendBytes(key, child);
+    if (unique)
+        appendBytes(key, expr);
+
+    auto canonical = mCanonicalMap.find(key);
+    if (canonical == mCanonicalMap.end()) {
+        const uint32 id = (uint32)mUses.size();
+        canonical       = mCanonicalMap.emplace(std::move(key), id).first;
+        mUses.push_back(0);
+
+        // Only uses by distinct parents count, repeated parents are shared already
+        bool impure   = unique && expr->type() == ExpressionType::Call;
+        bool trapping = expr->type() == ExpressionType::Binary
+                        && expr->returnType() == ElementaryType::Integer
+                        && (static_cast<const BinaryExpression*>(expr)->op() == BinaryOperation::Div
+                            || static_cast<const BinaryExpression*>(expr)->op() == BinaryOperation::Mod);
+        for (uint32 child : children) {
+            mUses[child] += 1;
+            impure   = impure || mImpure[child];
+            trapping = trapping || mTrapping[child];
+        }
+        mImpure.push_back(impure);
+        mTrapping.push_back(trapping);
+        mWorthy.push_back(!impure && expr->type() != ExpressionType::Variable && expr->type() != ExpressionType::Literal);
+    }
+
+    mNodeMap.emplace(expr, canonical->second);
+    return canonical->second;
+}
+
+void CommonSubexpressions::excludeGuarded(const Expression* expr, bool guarded, std::unordered_map<const Expression*, uint8>& visited)
+{
+    // Each node is visited at most once per state, which keeps the walk linear for shared nodes
+    uint8& state     = visited[expr];
+    const uint8 mask = guarded ? 2 : 1;
+    if (state & mask)
+        return;
+    state |= mask;
+
+    const uint32 id = mNodeMap.at(expr);
+    if (guarded && mTrapping[id])
+        mWorthy[id] = false;
+
+    switch (expr->type()) {
+    case ExpressionType::Unary:
+        excludeGuarded(static_cast<const UnaryExpression*>(expr)->inner().get(), guarded, visited);
+        break;
+    case ExpressionType::Binary: {
+        const auto binary       = static_cast<const BinaryExpression*>(expr);
+        const bool shortCircuit = binary->op() == BinaryOperation::And || binary->op() == BinaryOperation::Or;
+        excludeGuarded(binary->left().get(), guarded, visited);
+        excludeGuarded(binary->right().get(), guarded || shortCircuit, visited);
+    } break;
+    case ExpressionType::Call:
+        for (const auto& param : static_cast<const CallExpression*>(expr)->parameters())
+            excludeGuarded(param.get(), guarded, visited);
+        break;
+    case ExpressionType::Access:
+        excludeGuarded(static_cast<const AccessExpression*>(expr)->inner().get(), guarded, visited);
+        break;
+    default:
+        break;
+    }
+}
+} // namespace PExpr::internal
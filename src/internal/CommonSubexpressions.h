@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../Expression.h"
+
+namespace PExpr::internal {
+/// Finds structurally identical subtrees of a type checked tree, which are used more than once.
+/// Each subtree is reduced to a canonical node identified by its operation, type and canonical children, similar to hash consing.
+/// Calls to functions not flagged pure and subtrees containing them are never merged, even if the node itself is shared in the tree.
+/// Variables and literals are not considered worth a temporary.
+/// Subtrees containing an integer division or remainder are not merged if they occur on the right side of '&&' or '||',
+/// as a temporary evaluated ahead of the expression would ignore the short-circuit guarding them, e.g., 'n != 0 && 10/n > 1'.
+class CommonSubexpressions {
+public:
+    /// Index returned for nodes which are not shared.
+    static constexpr uint32 InvalidIndex = ~0u;
+
+    explicit CommonSubexpressions(const Ptr<Expression>& root);
+
+    /// Dense index of the shared subtree the given node belongs to or InvalidIndex if the node is used only once.
+    inline uint32 find(const Expression* expr) const
+    {
+        const auto it = mShared.find(expr);
+        return it != mShared.end() ? it->second : InvalidIndex;
+    }
+
+    /// Number of shared subtrees.
+    inline size_t count() const { return mSharedCount; }
+
+private:
+    uint32 canonicalize(const Expression* expr);
+    void excludeGuarded(const Expression* expr, bool guarded, std::unordered_map<const Expression*, uint8>& visited);
+
+    std::unordered_map<std::string, uint32> mCanonicalMap;
+    std::unordered_map<const Expression*, uint32> mNodeMap; // Node to canonical id
+    std::vector<uint32> mUses;                              // Uses of each canonical id by distinct parents
+    std::vector<bool> mWorthy;                              // True if the canonical id is worth a temporary
+    std::vector<bool> mImpure;                              // True if the canonical id contains a call with side effects
+    std::vector<bool> mTrapping;                            // True if the canonical id contains an integer division or remainder
+    std::unordered_map<const Expression*, uint32> mShared;
+    size_t mSharedCount;
+};
+} // namespace PExpr::internal
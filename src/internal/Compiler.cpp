@@ -0,0 +1,350 @@
+#include "Compiler.h"
+
+#include <limits>
+
+namespace PExpr::internal {
+BytecodeCompiler::BytecodeCompiler(const DefContainer& definitions, const NativeResolver& resolver, DiagnosticSink* diagnostics)
+    : mDefinitions(definitions)
+    , mResolver(resolver)
+    , mReporter(diagnostics)
+    , mProgram(std::make_shared<Program>())
+    , mHasError(false)
+    , mPending()
+    , mConstantMap()
+    , mVariableMap()
+    , mNativeMap()
+    , mConstantCount(0)
+    , mVariableCount(0)
+    , mTop(0)
+    , mMaxTop(0)
+{
+}
+
+Ptr<Program> BytecodeCompiler::finish(const Operand& result)
+{
+    if (mHasError || result.Type == ElementaryType::Unspecified)
+        return nullptr;
+
+    auto& program = *mProgram;
+    program.mInstructions.reserve(mPending.size());
+    for (const auto& pending : mPending) {
+        Instruction ins = pending.Base;
+        ins.Dst         = relocate(pending.Dst);
+        ins.A           = relocate(pending.A);
+        ins.B           = relocate(pending.B);
+        program.mInstructions.push_back(ins);
+    }
+
+    for (auto& var : program.mVariables)
+        var.Register += mConstantCount;
+
+    program.mRegisterCount  = mConstantCount + mVariableCount + mMaxTop;
+    program.mResultRegister = relocate(result);
+    program.mResultType     = result.Type;
+
+    mPending.clear();
+    return mProgram;
+}
+
+uint32 BytecodeCompiler::relocate(const Operand& operand) const
+{
+    switch (operand.Kind) {
+    default:
+    case Operand::Constant:
+        return operand.Register;
+    case Operand::Variable:
+        return mConstantCount + operand.Register;
+    case Operand::Temporary:
+        return mConstantCount + mVariableCount + operand.Register;
+    }
+}
+
+Operand BytecodeCompiler::constant(const Cell& cell, ElementaryType type)
+{
+    // Constants are deduplicated by type and bit pattern
+    std::string key(1 + sizeof(Cell), (char)type);
+    std::memcpy(&key[1], &cell, sizeof(Cell));
+
+    auto it = mConstantMap.find(key);
+    if (it == mConstantMap.end()) {
+        it = mConstantMap.emplace(key, mConstantCount++).first;
+        mProgram->mConstants.push_back(cell);
+    }
+
+    return Operand{ it->second, Operand::Constant, type };
+}
+
+Operand BytecodeCompiler::allocate(ElementaryType type)
+{
+    Operand operand{ mTop, Operand::Temporary, type };
+    mTop += typeArraySize(type);
+    mMaxTop = std::max(mMaxTop, mTop);
+    return operand;
+}
+
+void BytecodeCompiler::release(const Operand& operand)
+{
+    // Operands are always the topmost temporaries, therefore releasing them in any order is sufficient
+    if (operand.Kind == Operand::Temporary)
+        mTop = std::min(mTop, operand.Register);
+}
+
+Operand BytecodeCompiler::emit(OpCode op, ElementaryType type, const Operand& a, const Operand& b)
+{
+    release(a);
+    release(b);
+    const Operand dst = allocate(type);
+
+    push(op, typeArraySize(a.Type == ElementaryType::Unspecified ? type : a.Type), 0, dst, a, b);
+    return dst;
+}
+
+void BytecodeCompiler::push(OpCode op, uint8 lanes, uint16 extra, const Operand& dst, const Operand& a, const Operand& b)
+{
+    Instruction ins;
+    ins.Op    = op;
+    ins.Lanes = lanes;
+    ins.Extra = extra;
+    ins.Dst   = 0;
+    ins.A     = 0;
+    ins.B     = 0;
+    mPending.push_back(PendingInstruction{ ins, dst, a, b });
+}
+
+Operand BytecodeCompiler::emitUnary(OpCode op, ElementaryType type, const Operand& a)
+{
+    return emit(op, type, a, Operand{});
+}
+
+Operand BytecodeCompiler::onVariable(const std::string& name, ElementaryType expectedType)
+{
+    auto it = mVariableMap.find(name);
+    if (it == mVariableMap.end()) {
+        it = mVariableMap.emplace(name, (uint32)mProgram->mVariables.size()).first;
+        mProgram->mVariables.push_back(ProgramVariable{ name, expectedType, mVariableCount });
+        mVariableCount += typeArraySize(expectedType);
+    }
+
+    const auto& var = mProgram->mVariables[it->second];
+    return Operand{ var.Register, Operand::Variable, var.Type };
+}
+
+Operand BytecodeCompiler::onInteger(Integer v)
+{
+    Cell cell;
+    cell.Int = v;
+    return constant(cell, ElementaryType::Integer);
+}
+
+Operand BytecodeCompiler::onNumber(Number v)
+{
+    Cell cell;
+    cell.Num = v;
+    return constant(cell, ElementaryType::Number);
+}
+
+Operand BytecodeCompiler::onBool(bool v)
+{
+    Cell cell;
+    cell.Int  = 0; // Make sure the bit pattern is deterministic
+    cell.Bool = v;
+    return constant(cell, ElementaryType::Boolean);
+}
+
+Operand BytecodeCompiler::onString(const std::string& v)
+{
+    auto it = std::find(mProgram->mStrings.begin(), mProgram->mStrings.end(), v);
+    if (it == mProgram->mStrings.end()) {
+        mProgram->mStrings.push_back(v);
+        it = mProgram->mStrings.end() - 1;
+    }
+
+    Cell cell;
+    cell.Str = &*it;
+    return constant(cell, ElementaryType::String);
+}
+
+Operand BytecodeCompiler::onCast(const Operand& v, ElementaryType, ElementaryType toType)
+{
+    // Casts of call arguments happen after all arguments are evaluated and have to keep their position
+    if (v.Kind == Operand::Temporary) {
+        const Operand dst{ v.Register, Operand::Temporary, toType };
+
+        push(OpCode::CastIntToNum, 1, 0, dst, v, Operand{});
+        return dst;
+    }
+
+    return emitUnary(OpCode::CastIntToNum, toType, v);
+}
+
+Operand BytecodeCompiler::onPosNeg(bool isNeg, ElementaryType arithType, const Operand& v)
+{
+    if (!isNeg)
+        return v;
+    return emitUnary(arithType == ElementaryType::Integer ? OpCode::NegInt : OpCode::NegNum, arithType, v);
+}
+
+Operand BytecodeCompiler::onNot(const Operand& v)
+{
+    return emitUnary(OpCode::Not, ElementaryType::Boolean, v);
+}
+
+Operand BytecodeCompiler::onAddSub(bool isSub, ElementaryType arithType, const Operand& a, const Operand& b)
+{
+    if (arithType == ElementaryType::Integer)
+        return emit(isSub ? OpCode::SubInt : OpCode::AddInt, arithType, a, b);
+    else
+        return emit(isSub ? OpCode::SubNum : OpCode::AddNum, arithType, a, b);
+}
+
+Operand BytecodeCompiler::onMulDiv(bool isDiv, ElementaryType arithType, const Operand& a, const Operand& b)
+{
+    if (arithType == ElementaryType::Integer)
+        return emit(isDiv ? OpCode::DivInt : OpCode::MulInt, arithType, a, b);
+    else
+        return emit(isDiv ? OpCode::DivNum : OpCode::MulNum, arithType, a, b);
+}
+
+Operand BytecodeCompiler::onScale(bool isDiv, ElementaryType aType, const Operand& a, const Operand& f)
+{
+    if (aType == ElementaryType::Integer)
+        return emit(isDiv ? OpCode::DivInt : OpCode::MulInt, aType, a, f);
+    else
+        return emit(isDiv ? OpCode::DivScaleNum : OpCode::ScaleNum, aType, a, f);
+}
+
+Operand BytecodeCompiler::onPow(ElementaryType aType, const Operand& a, const Operand& f)
+{
+    return emit(aType == ElementaryType::Integer ? OpCode::PowInt : OpCode::PowNum, aType, a, f);
+}
+
+Operand BytecodeCompiler::onMod(const Operand& a, const Operand& b)
+{
+    return emit(OpCode::ModInt, ElementaryType::Integer, a, b);
+}
+
+Operand BytecodeCompiler::onAndOr(bool isOr, const Operand& a, const Operand& b)
+{
+    return emit(isOr ? OpCode::Or : OpCode::And, ElementaryType::Boolean, a, b);
+}
+
+Operand BytecodeCompiler::onRelOp(RelationalOp op, ElementaryType scalarArithType, const Operand& a, const Operand& b)
+{
+    const bool isInt = scalarArithType == ElementaryType::Integer;
+    switch (op) {
+    default:
+    case RelationalOp::Less:
+        return emit(isInt ? OpCode::LessInt : OpCode::LessNum, ElementaryType::Boolean, a, b);
+    case RelationalOp::Greater:
+        return emit(isInt ? OpCode::GreaterInt : OpCode::GreaterNum, ElementaryType::Boolean, a, b);
+    case RelationalOp::LessEqual:
+        return emit(isInt ? OpCode::LessEqualInt : OpCode::LessEqualNum, ElementaryType::Boolean, a, b);
+    case RelationalOp::GreaterEqual:
+        return emit(isInt ? OpCode::GreaterEqualInt : OpCode::GreaterEqualNum, ElementaryType::Boolean, a, b);
+    }
+}
+
+Operand BytecodeCompiler::onEqual(bool isNeg, ElementaryType type, const Operand& a, const Operand& b)
+{
+    switch (type) {
+    case ElementaryType::Boolean:
+        return emit(isNeg ? OpCode::NotEqualBool : OpCode::EqualBool, ElementaryType::Boolean, a, b);
+    case ElementaryType::Integer:
+        return emit(isNeg ? OpCode::NotEqualInt : OpCode::EqualInt, ElementaryType::Boolean, a, b);
+    case ElementaryType::String:
+        return emit(isNeg ? OpCode::NotEqualString : OpCode::EqualString, ElementaryType::Boolean, a, b);
+    default:
+        return emit(isNeg ? OpCode::NotEqualNum : OpCode::EqualNum, ElementaryType::Boolean, a, b);
+    }
+}
+
+Operand BytecodeCompiler::onFunctionCall(const std::string& name,
+                                         ElementaryType returnType, const std::vector<ElementaryType>& argumentTypes,
+                                         const std::vector<Operand>& argumentPayloads)
+{
+    return onResolvedCall(FunctionDef(name, returnType, argumentTypes), argumentPayloads);
+}
+
+Operand BytecodeCompiler::onResolvedCall(const FunctionDef& def, const std::vector<Operand>& argumentPayloads)
+{
+    const ElementaryType returnType = def.returnType();
+
+    // Resolve each signature only once. Bound natives are keyed by their index instead
+    std::string key;
+    if (def.hasNative()) {
+        key = '\1' + std::to_string(def.nativeIndex());
+    } else {
+        key = def.name();
+        key += '\0';
+        for (const auto& type : def.parameters())
+            key += (char)type;
+    }
+
+    auto it = mNativeMap.find(key);
+    if (it == mNativeMap.end()) {
+        NativeFunction native;
+        if (def.hasNative())
+            native = mDefinitions.native(def.nativeIndex());
+        else if (mResolver)
+            native = mResolver(def);
+
+        if (!native) {
+            mReporter.error(Location(0)) << "No native implementation for function '" << def.name() << "' available";
+            mHasError = true;
+            return Operand{};
+        }
+
+        PEXPR_ASSERT(mProgram->mNatives.size() <= std::numeric_limits<uint16>::max(), "Too many native functions");
+        it = mNativeMap.emplace(key, (uint32)mProgram->mNatives.size()).first;
+        mProgram->mNatives.push_back(std::move(native));
+        mProgram->mFunctions.push_back(def);
+    }
+
+    // Arguments evaluated to temporaries are usually in consecutive order already, else move them into a new block
+    bool inPlace = true;
+    uint32 size  = 0;
+    for (const auto& arg : argumentPayloads) {
+        if (arg.Kind != Operand::Temporary || arg.Register != argumentPayloads.front().Register + size)
+            inPlace = false;
+        size += typeArraySize(arg.Type);
+    }
+
+    Operand block = argumentPayloads.empty() ? Operand{} : argumentPayloads.front();
+    if (!inPlace) {
+        block = Operand{ mTop, Operand::Temporary, ElementaryType::Unspecified };
+        for (const auto& arg : argumentPayloads) {
+            Operand dst{ mTop, Operand::Temporary, arg.Type };
+            mTop += typeArraySize(arg.Type);
+            mMaxTop = std::max(mMaxTop, mTop);
+
+            push(OpCode::Move, typeArraySize(arg.Type), 0, dst, arg, Operand{});
+        }
+    }
+
+    release(block);
+    for (const auto& arg : argumentPayloads)
+        release(arg);
+
+    const Operand dst = allocate(returnType);
+
+    push(OpCode::Call, typeArraySize(returnType), (uint16)it->second, dst, block, Operand{});
+    return dst;
+}
+
+Operand BytecodeCompiler::onAccess(const Operand& v, size_t, const std::vector<uint8>& outputPermutation)
+{
+    const ElementaryType type = outputPermutation.size() == 1 ? ElementaryType::Number
+                                                              : (outputPermutation.size() == 2 ? ElementaryType::Vec2
+                                                                                               : (outputPermutation.size() == 3 ? ElementaryType::Vec3 : ElementaryType::Vec4));
+
+    uint16 extra = 0;
+    for (size_t i = 0; i < outputPermutation.size(); ++i)
+        extra |= (uint16)(outputPermutation[i] << (2 * i));
+
+    release(v);
+    const Operand dst = allocate(type);
+
+    push(OpCode::Swizzle, (uint8)outputPermutation.size(), extra, dst, v, Operand{});
+    return dst;
+}
+} // namespace PExpr::internal
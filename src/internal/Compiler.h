@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../Program.h"
+#include "../TranspileVisitor.h"
+#include "DefContainer.h"
+#include "Reporter.h"
+
+namespace PExpr::internal {
+/// Register of an intermediate value while compiling.
+/// Registers are numbered per space and relocated to the final layout of the register file at the end.
+struct Operand {
+    enum Space : uint8 {
+        Constant,
+        Variable,
+        Temporary
+    };
+
+    uint32 Register     = 0;
+    Space Kind          = Constant;
+    ElementaryType Type = ElementaryType::Unspecified;
+};
+
+/// Compiles a typed expression to a program by transpiling it.
+/// Temporary registers are allocated like a stack, as the transpiler always handles operands before the operation using them.
+class BytecodeCompiler : public TranspileVisitor<Operand> {
+public:
+    BytecodeCompiler(const DefContainer& definitions, const NativeResolver& resolver, DiagnosticSink* diagnostics);
+
+    /// Finalize the program with the given result. Returns nullptr if an error occurred.
+    Ptr<Program> finish(const Operand& result);
+
+    Operand onVariable(const std::string& name, ElementaryType expectedType) override;
+    Operand onInteger(Integer v) override;
+    Operand onNumber(Number v) override;
+    Operand onBool(bool v) override;
+    Operand onString(const std::string& v) override;
+    Operand onCast(const Operand& v, ElementaryType fromType, ElementaryType toType) override;
+    Operand onPosNeg(bool isNeg, ElementaryType arithType, const Operand& v) override;
+    Operand onNot(const Operand& v) override;
+    Operand onAddSub(bool isSub, ElementaryType arithType, const Operand& a, const Operand& b) override;
+    Operand onMulDiv(bool isDiv, ElementaryType arithType, const Operand& a, const Operand& b) override;
+    Operand onScale(bool isDiv, ElementaryType aType, const Operand& a, const Operand& f) override;
+    Operand onPow(ElementaryType aType, const Operand& a, const Operand& f) override;
+    Operand onMod(const Operand& a, const Operand& b) override;
+    Operand onAndOr(bool isOr, const Operand& a, const Operand& b) override;
+    Operand onRelOp(RelationalOp op, ElementaryType scalarArithType, const Operand& a, const Operand& b) override;
+    Operand onEqual(bool isNeg, ElementaryType type, const Operand& a, const Operand& b) override;
+    Operand onFunctionCall(const std::string& name,
+                           ElementaryType returnType, const std::vector<ElementaryType>& argumentTypes,
+                           const std::vector<Operand>& argumentPayloads) override;
+    Operand onResolvedCall(const FunctionDef& def, const std::vector<Operand>& argumentPayloads) override;
+    Operand onAccess(const Operand& v, size_t inputSize, const std::vector<uint8>& outputPermutation) override;
+
+private:
+    Operand constant(const Cell& cell, ElementaryType type);
+    Operand allocate(ElementaryType type);
+    void release(const Operand& operand);
+    Operand emit(OpCode op, ElementaryType type, const Operand& a, const Operand& b);
+    void push(OpCode op, uint8 lanes, uint16 extra, const Operand& dst, const Operand& a, const Operand& b);
+    Operand emitUnary(OpCode op, ElementaryType type, const Operand& a);
+    uint32 relocate(const Operand& operand) const;
+
+    const DefContainer& mDefinitions;
+    const NativeResolver& mResolver;
+    Reporter mReporter;
+    Ptr<Program> mProgram;
+    bool mHasError;
+
+    // Instructions with registers not yet relocated
+    struct PendingInstruction {
+        Instruction Base;
+        Operand Dst;
+        Operand A;
+        Operand B;
+    };
+    std::vector<PendingInstruction> mPending;
+
+    std::unordered_map<std::string, uint32> mConstantMap;
+    std::unordered_map<std::string, uint32> mVariableMap;
+    std::unordered_map<std::string, uint32> mNativeMap;
+    uint32 mConstantCount;
+    uint32 mVariableCount;
+    uint32 mTop;
+    uint32 mMaxTop;
+};
+} // namespace PExpr::internal
@@ -1,11 +1,20 @@
 #pragma once
 
-#include "../Lookup.h"
 #include "../Logger.h"
+#include "../Lookup.h"
+#include "../Program.h"
+#include "FunctionCache.h"
+#include "StatisticsCollector.h"
+#include "TraceSpan.h"
 
 namespace PExpr::internal {
 class DefContainer {
 public:
+    inline void addVariable(const VariableDef& def)
+    {
+        mVarDefs.insert_or_assign(def.name(), def);
+    }
+
     inline void addVariableLookupFunction(const VariableLookupFunction& func)
     {
         mVars.emplace_back(func);
@@ -13,7 +22,15 @@ public:
 
     inline std::optional<VariableDef> lookupVariable(const Location& loc, const std::string& name) const
     {
+        TraceSpan span(traceRecorderForLookups(), "lookupVariable");
+        span.setDetail(name);
+
+        const auto it = mVarDefs.find(name);
+        if (it != mVarDefs.end())
+            return it->second;
+
         for (const auto& cb : mVars) {
+            mStatistics.increment(StatisticsCollector::VariableLookups);
             auto res = cb(VariableLookup(loc, name));
             if (res.has_value())
                 return res;
@@ -21,14 +38,88 @@ public:
         return {};
     }
 
+    inline void addFunction(const FunctionDef& def)
+    {
+        auto& buckets = mFuncDefs[def.name()];
+        if (buckets.size() <= def.parameters().size())
+            buckets.resize(def.parameters().size() + 1);
+
+        // Replace overloads with the same signature
+        auto& overloads = buckets[def.parameters().size()];
+        for (auto& overload : overloads) {
+            if (overload.parameters() == def.parameters()) {
+                overload = def;
+                mFuncCache.clear();
+                return;
+            }
+        }
+        overloads.push_back(def);
+        mFuncCache.clear();
+    }
+
     inline void addFunctionLookupFunction(const FunctionLookupFunction& func)
     {
         mFuncs.emplace_back(func);
+        mFuncCache.clear();
     }
 
     inline std::optional<FunctionDef> lookupFunction(const Location& loc, const std::string& name, const std::vector<ElementaryType>& params) const
+    {
+        TraceSpan span(traceRecorderForLookups(), "lookupFunction");
+        span.setExpression(nullptr, params.size());
+        span.setDetail(name);
+
+        const auto it = mFuncDefs.find(name);
+        if (it != mFuncDefs.end() && params.size() < it->second.size()) {
+            const FunctionDef* def = resolveOverload(it->second[params.size()], params);
+            if (def)
+                return *def;
+        }
+
+        if (mFuncCache.isEnabled()) {
+            bool resolved = false;
+            auto res      = mFuncCache.lookup(name, params, [&]() {
+                resolved = true;
+                return callFunctionLookupFunctions(loc, name, params);
+            });
+            if (!resolved)
+                mStatistics.increment(StatisticsCollector::CacheHits);
+            return res;
+        } else {
+            return callFunctionLookupFunctions(loc, name, params);
+        }
+    }
+
+    /// Add a native implementation and return its index.
+    inline size_t addNative(NativeFunction&& func)
+    {
+        mNatives.emplace_back(std::move(func));
+        return mNatives.size() - 1;
+    }
+
+    inline const NativeFunction& native(size_t index) const { return mNatives.at(index); }
+    inline size_t nativeCount() const { return mNatives.size(); }
+
+    inline FunctionCache& functionCache() { return mFuncCache; }
+    inline const FunctionCache& functionCache() const { return mFuncCache; }
+
+    inline StatisticsCollector& statistics() { return mStatistics; }
+    inline const StatisticsCollector& statistics() const { return mStatistics; }
+
+    inline void setTraceRecorder(const Ptr<TraceRecorder>& recorder, bool traceLookups)
+    {
+        mTraceRecorder = recorder;
+        mTraceLookups  = traceLookups;
+    }
+    inline const Ptr<TraceRecorder>& traceRecorder() const { return mTraceRecorder; }
+
+private:
+    inline TraceRecorder* traceRecorderForLookups() const { return mTraceLookups ? mTraceRecorder.get() : nullptr; }
+
+    inline std::optional<FunctionDef> callFunctionLookupFunctions(const Location& loc, const std::string& name, const std::vector<ElementaryType>& params) const
     {
         for (const auto& cb : mFuncs) {
+            mStatistics.increment(StatisticsCollector::FunctionLookups);
             auto res = cb(FunctionLookup(loc, name, params));
             if (res.has_value())
                 return res;
@@ -36,8 +127,37 @@ public:
         return {};
     }
 
-private:
+    /// Exact matches are preferred. If no exact match exists, a single overload reachable via implicit conversions is chosen.
+    /// Returns nullptr if no or multiple candidates via conversions exist.
+    static inline const FunctionDef* resolveOverload(const std::vector<FunctionDef>& overloads, const std::vector<ElementaryType>& params)
+    {
+        const FunctionDef* candidate = nullptr;
+        bool ambiguous               = false;
+        for (const auto& overload : overloads) {
+            if (overload.parameters() == params)
+                return &overload;
+
+            if (std::equal(params.begin(), params.end(), overload.parameters().begin(), isConvertible)) {
+                ambiguous = candidate != nullptr;
+                candidate = &overload;
+            }
+        }
+
+        return ambiguous ? nullptr : candidate;
+    }
+
+    std::unordered_map<std::string, VariableDef> mVarDefs;
+    std::unordered_map<std::string, std::vector<std::vector<FunctionDef>>> mFuncDefs; // Overloads bucketed by number of parameters
+
     std::vector<VariableLookupFunction> mVars;
     std::vector<FunctionLookupFunction> mFuncs;
+
+    std::vector<NativeFunction> mNatives; // Indexed by FunctionDef::nativeIndex()
+
+    FunctionCache mFuncCache;
+    StatisticsCollector mStatistics;
+
+    Ptr<TraceRecorder> mTraceRecorder;
+    bool mTraceLookups = false;
 };
-} // namespace PExpr::internal
\ No newline at end of file
+} // namespace PExpr::internal
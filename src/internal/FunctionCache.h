@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../Lookup.h"
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace PExpr::internal {
+/// Memoizes the result of function lookups by name and parameter types.
+/// Negative results are cached as well. Lookups are threadsafe.
+/// Entries are distributed over multiple shards with their own locks and counters to keep contention low if many threads share the cache.
+class FunctionCache {
+public:
+    FunctionCache() = default;
+
+    /// Copies only the state, but not the entries.
+    inline FunctionCache(const FunctionCache& other)
+        : mEnabled(other.isEnabled())
+    {
+    }
+
+    /// Copies only the state, but not the entries.
+    inline FunctionCache& operator=(const FunctionCache& other)
+    {
+        setEnabled(other.isEnabled());
+        clear();
+        return *this;
+    }
+
+    inline void setEnabled(bool b) { mEnabled = b; }
+    inline bool isEnabled() const { return mEnabled; }
+
+    /// Returns the cached definition or calls the resolve function and caches its result.
+    template <typename Func>
+    inline std::optional<FunctionDef> lookup(const std::string& name, const std::vector<ElementaryType>& params, const Func& resolve) const
+    {
+        // Small signatures fit into the small string optimization and need no allocation
+        std::string key;
+        key.reserve(name.size() + 1 + params.size());
+        key += name;
+        key += '\0';
+        for (const auto& type : params)
+            key += (char)type;
+
+        Shard& shard = mShards[std::hash<std::string>()(key) % ShardCount];
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+            const auto it = shard.Entries.find(key);
+            if (it != shard.Entries.end()) {
+                shard.Hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second;
+            }
+        }
+
+        shard.Misses.fetch_add(1, std::memory_order_relaxed);
+        auto res = resolve();
+
+        std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+        shard.Entries.emplace(std::move(key), res);
+        return res;
+    }
+
+    inline void clear()
+    {
+        for (auto& shard : mShards) {
+            std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+            shard.Entries.clear();
+        }
+    }
+
+    inline FunctionCacheStatistics statistics() const
+    {
+        FunctionCacheStatistics stats;
+        for (const auto& shard : mShards) {
+            std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+            stats.Hits += shard.Hits.load(std::memory_order_relaxed);
+            stats.Misses += shard.Misses.load(std::memory_order_relaxed);
+            stats.Entries += shard.Entries.size();
+        }
+        return stats;
+    }
+
+    inline void resetStatistics()
+    {
+        for (auto& shard : mShards) {
+            shard.Hits   = 0;
+            shard.Misses = 0;
+        }
+    }
+
+private:
+    static constexpr size_t ShardCount = 16;
+
+    // Each shard is placed on its own cache line to prevent false sharing
+    struct alignas(64) Shard {
+        mutable std::shared_mutex Mutex;
+        std::unordered_map<std::string, std::optional<FunctionDef>> Entries;
+        std::atomic<uint64> Hits   = 0;
+        std::atomic<uint64> Misses = 0;
+    };
+
+    std::atomic<bool> mEnabled = false;
+    mutable std::array<Shard, ShardCount> mShards;
+};
+} // namespace PExpr::internal
@@ -1,17 +1,52 @@
 #include "Lexer.h"
-#include "Logger.h"
+#include "StatisticsCollector.h"
 
 namespace PExpr::internal {
-Lexer::Lexer(std::istream& stream)
-    : mStream(stream)
+Lexer::Lexer(std::istream& stream, DiagnosticSink* diagnostics)
+    : mStream(&stream)
+    , mSource()
+    , mOffset(0)
+    , mEof(false)
     , mChar(0)
     , mLocation(0)
     , mTemp{}
+    , mReporter(diagnostics)
+    , mTokenCount(0)
+    , mTimed(false)
+    , mElapsedNanoseconds(0)
+{
+    eat();
+}
+
+Lexer::Lexer(std::string_view source, DiagnosticSink* diagnostics)
+    : mStream(nullptr)
+    , mSource(source)
+    , mOffset(0)
+    , mEof(false)
+    , mChar(0)
+    , mLocation(0)
+    , mTemp{}
+    , mReporter(diagnostics)
+    , mTokenCount(0)
+    , mTimed(false)
+    , mElapsedNanoseconds(0)
 {
     eat();
 }
 
 Token Lexer::next()
+{
+    ++mTokenCount;
+    if (!mTimed)
+        return scan();
+
+    const auto start = StatisticsCollector::Clock::now();
+    Token token      = scan();
+    mElapsedNanoseconds += StatisticsCollector::elapsedNanoseconds(start);
+    return token;
+}
+
+Token Lexer::scan()
 {
     while (true) {
         mTemp.clear();
@@ -88,21 +123,11 @@ Token Lexer::next()
         if (std::isdigit(peek()))
             return parseNumber();
 
-        if (std::isalpha(peek()) || peek() == '_') {
-            append();
-            while ((std::isalnum(peek()) || peek() == '_') && !eof())
-                append();
-
-            if (mTemp == "true")
-                return Token(mLocation - mTemp.size(), TokenType::Boolean).With(true);
-            if (mTemp == "false")
-                return Token(mLocation - mTemp.size(), TokenType::Boolean).With(false);
-
-            return Token(mLocation - mTemp.size(), TokenType::Identifier).With(mTemp);
-        }
+        if (std::isalpha(peek()) || peek() == '_')
+            return parseIdentifier();
 
         append();
-        PEXPR_LOG(LogLevel::Error) << mLocation << ": Unknown token '" << mTemp << "'" << std::endl;
+        mReporter.error(mLocation) << "Unknown token '" << mTemp << "'";
         return Token(mLocation, TokenType::Error);
     }
 }
@@ -110,7 +135,16 @@ Token Lexer::next()
 void Lexer::eat()
 {
     ++mLocation;
-    mChar = (uint8)mStream.get();
+    if (mStream) {
+        mChar = (uint8)mStream->get();
+    } else if (mOffset < mSource.size()) {
+        mChar = (uint8)mSource[mOffset++];
+    } else {
+        // Keep offset() pointing to the end of the buffer
+        mOffset = mSource.size() + 1;
+        mChar   = (uint8)std::char_traits<char>::eof();
+        mEof    = true;
+    }
 }
 
 void Lexer::eatSpaces()
@@ -132,6 +166,36 @@ void Lexer::eatComments()
     }
 }
 
+Token Lexer::parseIdentifier()
+{
+    const Location startLoc = mLocation;
+
+    std::string_view identifier;
+    if (isBuffered()) {
+        // Reference the identifier directly in the buffer
+        const size_t start = offset();
+        eat();
+        while ((std::isalnum(peek()) || peek() == '_') && !eof())
+            eat();
+        identifier = mSource.substr(start, offset() - start);
+    } else {
+        append();
+        while ((std::isalnum(peek()) || peek() == '_') && !eof())
+            append();
+        identifier = mTemp;
+    }
+
+    if (identifier == "true")
+        return Token(startLoc, TokenType::Boolean).With(true);
+    if (identifier == "false")
+        return Token(startLoc, TokenType::Boolean).With(false);
+
+    if (isBuffered())
+        return Token(startLoc, TokenType::Identifier).With(identifier);
+    else
+        return Token(startLoc, TokenType::Identifier).With(mTemp);
+}
+
 Token Lexer::parseNumber()
 {
     const Location startLoc = mLocation;
@@ -173,7 +237,7 @@ Token Lexer::parseNumber()
 
     // Check digits
     if (base < 10 && std::find_if(digit_ptr, last_ptr, invalid_digit) != last_ptr)
-        PEXPR_LOG(LogLevel::Error) << startLoc << ": Invalid literal '" << mTemp << "'" << std::endl;
+        mReporter.error(startLoc) << "Invalid literal '" << mTemp << "'";
 
     if (exp || fractional)
         return Token(startLoc, TokenType::Float).With(Number(std::strtod(digit_ptr, nullptr)));
@@ -184,13 +248,17 @@ Token Lexer::parseString(uint8_t mark)
 {
     const Location startLoc = mLocation;
 
+    std::string_view view;
+    if (isBuffered() && parseStringView(mark, view))
+        return Token(startLoc, TokenType::String).With(view);
+
     std::string str;
     while (true) {
         size_t pos = mTemp.size();
         while (!eof() && peek() != mark)
             appendChar();
         if (eof() || !accept(mark)) {
-            PEXPR_LOG(LogLevel::Error) << mLocation << ": Unterminated string literal" << std::endl;
+            mReporter.error(mLocation) << "Unterminated string literal";
             return Token(mLocation, TokenType::Error);
         }
         str += mTemp.substr(pos, mTemp.size() - (pos + 1));
@@ -201,6 +269,28 @@ Token Lexer::parseString(uint8_t mark)
     return Token(startLoc, TokenType::String).With(str);
 }
 
+bool Lexer::parseStringView(uint8_t mark, std::string_view& view)
+{
+    // Only simple strings without escape sequences and without concatenations can reference the buffer directly
+    const size_t start = offset();
+    const size_t end   = mSource.find_first_of(mark == '\"' ? "\"\\" : "\'\\", start);
+    if (end == std::string_view::npos || mSource[end] != (char)mark)
+        return false;
+
+    size_t after = end + 1;
+    while (after < mSource.size() && std::isspace((uint8)mSource[after]))
+        ++after;
+    if (after < mSource.size() && mSource[after] == (char)mark)
+        return false;
+
+    view = mSource.substr(start, end - start);
+
+    // Skip string and the terminating mark
+    for (size_t i = start; i <= end; ++i)
+        eat();
+    return true;
+}
+
 void Lexer::append()
 {
     mTemp += mChar;
@@ -262,7 +352,7 @@ void Lexer::appendChar()
             std::string uni_val;
             for (size_t i = 0; i < length; ++i) {
                 if (eof()) {
-                    PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Invalid use of Unicode escape sequence" << std::endl;
+                    mReporter.error(mLocation - 1) << "Invalid use of Unicode escape sequence";
                     break;
                 }
 
@@ -276,12 +366,12 @@ void Lexer::appendChar()
                 try {
                     uni = std::stoul(uni_val, &r, 16);
                 } catch (const std::exception&) {
-                    PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Given Unicode escape sequence is invalid" << std::endl;
+                    mReporter.error(mLocation - 1) << "Given Unicode escape sequence is invalid";
                     break;
                 }
 
                 if (r != length) {
-                    PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Given Unicode escape sequence is invalid" << std::endl;
+                    mReporter.error(mLocation - 1) << "Given Unicode escape sequence is invalid";
                 } else if (length != 2) {
                     if (uni <= 0x7F) {
                         mTemp += (char)uni;
@@ -301,17 +391,17 @@ void Lexer::appendChar()
                         mTemp += char(0x80 | ((d & 0xFC0) >> 6));
                         mTemp += char(0x80 | (d & 0x3F));
                     } else {
-                        PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Given Unicode range" << std::endl;
+                        mReporter.error(mLocation - 1) << "Given Unicode range";
                     }
                 } else { // Binary
                     mTemp += (char)uni;
                 }
             } else {
-                PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Invalid length of Unicode escape sequence" << std::endl;
+                mReporter.error(mLocation - 1) << "Invalid length of Unicode escape sequence";
             }
         } break;
         default:
-            PEXPR_LOG(LogLevel::Error) << mLocation - 1 << ": Invalid escape sequence '\\" << peek() << "'" << std::endl;
+            mReporter.error(mLocation - 1) << "Invalid escape sequence '\\" << peek() << "'";
             eat();
             break;
         }
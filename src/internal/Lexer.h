@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Location.h"
+#include "Reporter.h"
 #include "Token.h"
 
 #include <istream>
@@ -8,18 +9,35 @@
 namespace PExpr::internal {
 class Lexer {
 public:
-    Lexer(std::istream& stream);
+    /// Lexer pulling characters from the given stream.
+    /// Diagnostics are reported to the given sink or, if none is given, to the global logger.
+    Lexer(std::istream& stream, DiagnosticSink* diagnostics = nullptr);
+    /// Lexer working directly on the given buffer.
+    /// Identifier and string tokens might reference the buffer, therefore it has to outlive all produced tokens.
+    /// Diagnostics are reported to the given sink or, if none is given, to the global logger.
+    Lexer(std::string_view source, DiagnosticSink* diagnostics = nullptr);
 
     Token next();
 
     inline const Location& loc() const { return mLocation; }
 
+    /// Number of tokens returned by next() so far.
+    inline size_t tokenCount() const { return mTokenCount; }
+
+    /// If enabled, the time spent inside next() is accumulated. Disabled by default.
+    inline void setTimed(bool b) { mTimed = b; }
+    /// Time spent inside next() while timing was enabled.
+    inline uint64 elapsedNanoseconds() const { return mElapsedNanoseconds; }
+
 private:
+    Token scan();
     void eat();
     void eatSpaces();
     void eatComments();
+    Token parseIdentifier();
     Token parseNumber();
     Token parseString(uint8_t mark);
+    bool parseStringView(uint8_t mark, std::string_view& view);
 
     void appendDigits(int base);
 
@@ -28,11 +46,25 @@ private:
     bool accept(uint8_t c);
 
     inline uint8_t peek() const { return mChar; }
-    inline bool eof() const { return mStream.eof(); }
+    inline bool eof() const { return mStream ? mStream->eof() : mEof; }
+
+    /// True if the lexer works on a contiguous buffer instead of a stream.
+    inline bool isBuffered() const { return mStream == nullptr; }
+    /// Offset of the current character in the buffer. Only valid if isBuffered() is true.
+    inline size_t offset() const { return mOffset - 1; }
+
+    std::istream* mStream;
+    std::string_view mSource;
+    size_t mOffset;
+    bool mEof;
 
-    std::istream& mStream;
     uint8_t mChar;
     Location mLocation;
     std::string mTemp; // Contains identifiers etc
+    Reporter mReporter;
+
+    size_t mTokenCount;
+    bool mTimed;
+    uint64 mElapsedNanoseconds;
 };
-} // namespace PExpr
\ No newline at end of file
+} // namespace PExpr
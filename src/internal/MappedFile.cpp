@@ -0,0 +1,65 @@
+#include "MappedFile.h"
+
+#include <fstream>
+
+#if defined(PEXPR_OS_LINUX) || defined(PEXPR_OS_APPLE)
+#define PEXPR_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PExpr::internal {
+MappedFile::MappedFile(const std::filesystem::path& path)
+    : mData(nullptr)
+    , mSize(0)
+    , mValid(false)
+    , mMapped(false)
+    , mBuffer()
+{
+#ifdef PEXPR_USE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0) {
+        if (info.st_size == 0) {
+            mValid = true;
+        } else {
+            void* ptr = ::mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                mData   = static_cast<const char*>(ptr);
+                mSize   = (size_t)info.st_size;
+                mValid  = true;
+                mMapped = true;
+            }
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if (mValid)
+        return;
+#endif
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return;
+
+    mBuffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    mData  = mBuffer.data();
+    mSize  = mBuffer.size();
+    mValid = true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef PEXPR_USE_MMAP
+    if (mMapped)
+        ::munmap(const_cast<char*>(mData), mSize);
+#endif
+}
+} // namespace PExpr::internal
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../PExpr_Config.h"
+
+namespace PExpr::internal {
+/// Read only view of a whole file. The file is memory mapped if supported by the platform, else it is read into memory.
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    /// True if the file could be opened.
+    inline bool isValid() const { return mValid; }
+    /// Content of the file, valid as long as this object exists.
+    inline std::string_view data() const { return std::string_view(mData, mSize); }
+
+private:
+    const char* mData;
+    size_t mSize;
+    bool mValid;
+    bool mMapped;
+    std::string mBuffer;
+
+    PEXPR_CLASS_NON_COPYABLE(MappedFile);
+};
+} // namespace PExpr::internal
@@ -0,0 +1,313 @@
+// Cephes based implementations of the built-in math functions.
+// This file is included once per instruction set by MathLibrary.cpp, after the vector type V, its bit representation, the lane count Width and the basic operations are defined.
+// Only basic IEEE operations and no fused multiply-add are used, which results in bitwise identical results for all instruction sets.
+
+static constexpr double RoundMagic = 6755399441055744.0; // 1.5 * 2^52
+static constexpr double PIO2       = 1.57079632679489661923;
+static constexpr double PIO4       = 7.85398163397448309616E-1;
+static constexpr double FOPI       = 1.27323954473516268615; // 4/pi
+static constexpr double MoreBits   = 6.123233995736765886130E-17;
+static constexpr double TrigLimit  = 1.073741824e9; // Larger arguments lose too much precision in the argument reduction
+
+template <size_t N>
+static inline V polevl(V x, const double (&coeffs)[N])
+{
+    V res = set(coeffs[0]);
+    for (size_t i = 1; i < N; ++i)
+        res = add(mul(res, x), set(coeffs[i]));
+    return res;
+}
+
+// Same as polevl, but with an implicit leading coefficient of one
+template <size_t N>
+static inline V p1evl(V x, const double (&coeffs)[N])
+{
+    V res = add(x, set(coeffs[0]));
+    for (size_t i = 1; i < N; ++i)
+        res = add(mul(res, x), set(coeffs[i]));
+    return res;
+}
+
+static inline V allOnes() { return fromBits(setBits(-1)); }
+static inline V invert(V mask) { return bitXor(mask, allOnes()); }
+static inline V absolute(V x) { return bitAndNot(set(-0.0), x); }
+static inline V signOf(V x) { return bitAnd(set(-0.0), x); }
+
+// Only valid for |x| < 2^51
+static inline V floorSmall(V x)
+{
+    const V r = sub(add(x, set(RoundMagic)), set(RoundMagic));
+    return sub(r, bitAnd(greater(r, x), set(1.0)));
+}
+
+// 2^n for integral n in [-1022, 1023]
+static inline V pow2(V n)
+{
+    const auto bits = subBits(toBits(add(n, set(RoundMagic))), toBits(set(RoundMagic)));
+    return fromBits(shiftLeftBits(addBits(bits, setBits(1023)), 52));
+}
+
+// Replace the lanes selected by the mask with the result of the scalar function
+template <typename Func>
+static inline V fixup(V res, V x, V mask, Func func)
+{
+    if (!anyTrue(mask))
+        return res;
+
+    double xs[Width];
+    double rs[Width];
+    double ms[Width];
+    store(xs, x);
+    store(rs, res);
+    store(ms, mask);
+    for (size_t i = 0; i < Width; ++i) {
+        uint64 m;
+        std::memcpy(&m, &ms[i], sizeof(m));
+        if (m != 0)
+            rs[i] = func(xs[i]);
+    }
+    return load(rs);
+}
+
+// Returns the even octant y of |x| and the reduced argument z
+template <size_t N>
+static inline V reduceOctant(V a, V& z, const double (&dp)[N])
+{
+    V y = floorSmall(mul(a, set(FOPI)));
+    y   = add(y, sub(y, mul(set(2.0), floorSmall(mul(y, set(0.5)))))); // Round odd octants up
+
+    z = a;
+    for (size_t i = 0; i < N; ++i)
+        z = sub(z, mul(y, set(dp[i])));
+    return y;
+}
+
+static inline V sinCos(V x, bool isCos)
+{
+    static constexpr double DP[]   = { 7.85398125648498535156E-1, 3.77489470793079817668E-8, 2.69515142907905952645E-15 };
+    static constexpr double SinC[] = { 1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6, -1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1 };
+    static constexpr double CosC[] = { -1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7, 2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2 };
+
+    const V a = absolute(x);
+    V z;
+    const V y = reduceOctant(a, z, DP);
+
+    const V j     = sub(y, mul(set(8.0), floorSmall(mul(y, set(0.125))))); // 0, 2, 4 or 6
+    const V upper = greater(j, set(3.0));
+    const V odd   = equal(sub(j, bitAnd(upper, set(4.0))), set(2.0));
+
+    const V zz   = mul(z, z);
+    const V cosP = add(sub(set(1.0), mul(zz, set(0.5))), mul(mul(zz, zz), polevl(zz, CosC)));
+    const V sinP = add(z, mul(z, mul(zz, polevl(zz, SinC))));
+
+    V res;
+    if (isCos)
+        res = bitXor(select(odd, sinP, cosP), bitAnd(bitXor(upper, odd), set(-0.0)));
+    else
+        res = bitXor(select(odd, cosP, sinP), bitXor(signOf(x), bitAnd(upper, set(-0.0))));
+
+    const V outside = invert(lessEqual(a, set(TrigLimit)));
+    if (isCos)
+        return fixup(res, x, outside, [](double v) { return std::cos(v); });
+    else
+        return fixup(res, x, outside, [](double v) { return std::sin(v); });
+}
+
+static inline V sinKernel(V x) { return sinCos(x, false); }
+static inline V cosKernel(V x) { return sinCos(x, true); }
+
+static inline V tanKernel(V x)
+{
+    static constexpr double DP[] = { 7.853981554508209228515625E-1, 7.94662735614792836714E-9, 3.06161699786838294307E-17 };
+    static constexpr double P[]  = { -1.30936939181383777646E4, 1.15351664838587416140E6, -1.79565251976484877988E7 };
+    static constexpr double Q[]  = { 1.36812963470692954678E4, -1.32089234440210967447E6, 2.50083801823357915839E7, -5.38695755929454629881E7 };
+
+    const V a = absolute(x);
+    V z;
+    const V y = reduceOctant(a, z, DP);
+
+    const V cot = equal(sub(y, mul(set(4.0), floorSmall(mul(y, set(0.25))))), set(2.0));
+
+    const V zz = mul(z, z);
+    V res      = add(z, mul(z, div(mul(zz, polevl(zz, P)), p1evl(zz, Q))));
+    res        = select(cot, div(set(-1.0), res), res);
+    res        = bitXor(res, signOf(x));
+
+    const V outside = invert(lessEqual(a, set(TrigLimit)));
+    return fixup(res, x, outside, [](double v) { return std::tan(v); });
+}
+
+static inline V asinKernel(V x)
+{
+    static constexpr double R[] = { 2.967721961301243206100E-3, -5.634242780008963776856E-1, 6.968710824104713396794E0, -2.556901049652824852289E1, 2.853665548261061424989E1 };
+    static constexpr double S[] = { -2.194779531642920639778E1, 1.470656354026814941758E2, -3.838770957603691357202E2, 3.424398657913078477438E2 };
+    static constexpr double P[] = { 4.253011369004428248960E-3, -6.019598008014123785661E-1, 5.444622390564711410273E0, -1.626247967210700244449E1, 1.956261983317594739197E1, -8.198089802484824371615E0 };
+    static constexpr double Q[] = { -1.474091372988853791896E1, 7.049610280856842141659E1, -1.471791292232726029859E2, 1.395105614657485689735E2, -4.918853881490881290097E1 };
+
+    const V a   = absolute(x);
+    const V big = greater(a, set(0.625));
+
+    // arcsin(1-x) = pi/2 - sqrt(2x)(1+R(x)), yields NaN for |x| > 1
+    V zz    = sub(set(1.0), a);
+    const V p = div(mul(zz, polevl(zz, R)), p1evl(zz, S));
+    zz      = sqrt(add(zz, zz));
+    V zBig  = sub(set(PIO4), zz);
+    zz      = sub(mul(zz, p), set(MoreBits));
+    zBig    = add(sub(zBig, zz), set(PIO4));
+
+    const V aa = mul(a, a);
+    V zSmall   = div(mul(aa, polevl(aa, P)), p1evl(aa, Q));
+    zSmall     = add(mul(a, zSmall), a);
+
+    return bitXor(select(big, zBig, zSmall), signOf(x));
+}
+
+static inline V acosKernel(V x)
+{
+    const V big = greater(x, set(0.5));
+    const V r   = asinKernel(select(big, sqrt(sub(set(0.5), mul(set(0.5), x))), x));
+    return select(big, add(r, r), add(add(sub(set(PIO4), r), set(MoreBits)), set(PIO4)));
+}
+
+static inline V atanKernel(V x)
+{
+    static constexpr double T3P8 = 2.41421356237309504880; // tan(3pi/8)
+    static constexpr double P[]  = { -8.750608600031904122785E-1, -1.615753718733365076637E1, -7.500855792314704667340E1, -1.228866684490136173410E2, -6.485021904942025371773E1 };
+    static constexpr double Q[]  = { 2.485846490142306297962E1, 1.650270098316988542046E2, 4.328810604912902668951E2, 4.853903996359136964868E2, 1.945506571482613964425E2 };
+
+    const V a   = absolute(x);
+    const V big = greater(a, set(T3P8));
+    const V mid = bitAndNot(big, greater(a, set(0.66)));
+
+    const V xr = select(big, div(set(-1.0), a), select(mid, div(sub(a, set(1.0)), add(a, set(1.0))), a));
+    const V y  = select(big, set(PIO2), bitAnd(mid, set(PIO4)));
+
+    const V zz = mul(xr, xr);
+    V z        = div(mul(zz, polevl(zz, P)), p1evl(zz, Q));
+    z          = add(mul(xr, z), xr);
+    z          = add(z, select(big, set(MoreBits), bitAnd(mid, set(0.5 * MoreBits))));
+
+    return bitXor(add(y, z), signOf(x));
+}
+
+static inline V expKernel(V x)
+{
+    static constexpr double P[]    = { 1.26177193074810590878E-4, 3.02994407707441961300E-2, 9.99999999999999999910E-1 };
+    static constexpr double Q[]    = { 3.00198505138664455042E-6, 2.52448340349684104192E-3, 2.27265548208155028766E-1, 2.00000000000000000009E0 };
+    static constexpr double C1     = 6.93145751953125E-1;
+    static constexpr double C2     = 1.42860682030941723212E-6;
+    static constexpr double LOG2E  = 1.4426950408889634073599;
+    static constexpr double MAXLOG = 7.09782712893383996843E2;
+    static constexpr double MINLOG = -7.08396418532264106224E2;
+
+    // exp(x) = 2^n * exp(r) with |r| <= ln(2)/2
+    const V n = floorSmall(add(mul(set(LOG2E), x), set(0.5)));
+    V r       = sub(x, mul(n, set(C1)));
+    r         = sub(r, mul(n, set(C2)));
+
+    const V rr = mul(r, r);
+    const V p  = mul(r, polevl(rr, P));
+    r          = div(p, sub(polevl(rr, Q), p));
+    r          = add(set(1.0), mul(set(2.0), r));
+
+    // Scale in two steps, as 2^n might not be representable as a single double
+    const V n1 = floorSmall(mul(n, set(0.5)));
+    V res      = mul(mul(r, pow2(n1)), pow2(sub(n, n1)));
+
+    res = select(greater(x, set(MAXLOG)), set(std::numeric_limits<double>::infinity()), res);
+    return select(less(x, set(MINLOG)), set(0.0), res);
+}
+
+static inline V logKernel(V x)
+{
+    static constexpr double P[]   = { 1.01875663804580931796E-4, 4.97494994976747001425E-1, 4.70579119878881725854E0, 1.44989225341610930846E1, 1.79368678507819816313E1, 7.70838733755885391666E0 };
+    static constexpr double Q[]   = { 1.12873587189167450590E1, 4.52279145837532221105E1, 8.29875266912776603211E1, 7.11544750618563894466E1, 2.31251620126765340583E1 };
+    static constexpr double R[]   = { -7.89580278884799154124E-1, 1.63866645699558079767E1, -6.41409952958715622951E1 };
+    static constexpr double S[]   = { -3.56722798256324312549E1, 3.12093766372244180303E2, -7.69691943550460008604E2 };
+    static constexpr double SQRTH = 0.70710678118654752440;
+    static constexpr double L1    = 0.693359375;
+    static constexpr double L2    = 2.121944400546905827679e-4;
+
+    // Normalize denormals first
+    const V denormal = less(x, set(std::numeric_limits<double>::min()));
+    const V xs       = select(denormal, mul(x, set(18014398509481984.0 /* 2^54 */)), x);
+
+    // x = m * 2^e with m in [0.5, 1)
+    const auto bits = toBits(xs);
+    const auto eInt = andBits(shiftRightBits(bits, 52), setBits(0x7ff));
+    V e             = sub(fromBits(addBits(eInt, toBits(set(RoundMagic)))), set(RoundMagic));
+    e               = sub(sub(e, set(1022.0)), bitAnd(denormal, set(54.0)));
+    const V m       = fromBits(orBits(andBits(bits, setBits(0x000fffffffffffff)), setBits(0x3fe0000000000000)));
+
+    const V bigE = greater(absolute(e), set(2.0));
+    const V lowM = less(m, set(SQRTH));
+    e            = sub(e, bitAnd(lowM, set(1.0)));
+
+    // log(x) = z + z^3 R(z)/S(z) with z = 2(x-1)/(x+1)
+    const V zA  = select(lowM, sub(m, set(0.5)), sub(sub(m, set(0.5)), set(0.5)));
+    const V yA  = select(lowM, add(mul(set(0.5), zA), set(0.5)), add(mul(set(0.5), m), set(0.5)));
+    const V xA  = div(zA, yA);
+    const V zzA = mul(xA, xA);
+    V resA      = mul(xA, div(mul(zzA, polevl(zzA, R)), p1evl(zzA, S)));
+    resA        = add(add(sub(resA, mul(e, set(L2))), xA), mul(e, set(L1)));
+
+    // log(1+x) = x - 0.5x^2 + x^3 P(x)/Q(x)
+    const V xB  = select(lowM, sub(add(m, m), set(1.0)), sub(m, set(1.0)));
+    const V zzB = mul(xB, xB);
+    V yB        = mul(xB, div(mul(zzB, polevl(xB, P)), p1evl(xB, Q)));
+    yB          = sub(sub(yB, mul(e, set(L2))), mul(zzB, set(0.5)));
+    V resB      = add(add(xB, yB), mul(e, set(L1)));
+
+    V res = select(bigE, resA, resB);
+    res   = select(equal(x, set(std::numeric_limits<double>::infinity())), x, res);
+    res   = select(equal(x, set(0.0)), set(-std::numeric_limits<double>::infinity()), res);
+    res   = select(less(x, set(0.0)), set(std::numeric_limits<double>::quiet_NaN()), res);
+    return select(invert(equal(x, x)), x, res);
+}
+
+template <V (*Func)(V)>
+static inline void apply(const Number* in, Number* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + Width <= count; i += Width)
+        store(out + i, Func(load(in + i)));
+
+    // Handle the remainder with the same kernel to get the same results
+    if (i < count) {
+        double xs[Width] = {};
+        double rs[Width];
+        std::copy(in + i, in + count, xs);
+        store(rs, Func(load(xs)));
+        std::copy(rs, rs + (count - i), out + i);
+    }
+}
+
+static inline void evaluateArray(MathFunction func, const Number* in, Number* out, size_t count)
+{
+    switch (func) {
+    case MathFunction::Sin:
+        apply<sinKernel>(in, out, count);
+        break;
+    case MathFunction::Cos:
+        apply<cosKernel>(in, out, count);
+        break;
+    case MathFunction::Tan:
+        apply<tanKernel>(in, out, count);
+        break;
+    case MathFunction::ASin:
+        apply<asinKernel>(in, out, count);
+        break;
+    case MathFunction::ACos:
+        apply<acosKernel>(in, out, count);
+        break;
+    case MathFunction::ATan:
+        apply<atanKernel>(in, out, count);
+        break;
+    case MathFunction::Exp:
+        apply<expKernel>(in, out, count);
+        break;
+    case MathFunction::Log:
+        apply<logKernel>(in, out, count);
+        break;
+    }
+}
@@ -0,0 +1,339 @@
+#include "Optimizer.h"
+#include "../Diagnostics.h"
+#include "../VirtualMachine.h"
+#include "Compiler.h"
+#include "Transpiler.h"
+
+namespace PExpr::internal {
+static inline bool isScalar(ElementaryType type)
+{
+    return !isArray(type) && type != ElementaryType::Unspecified;
+}
+
+static inline const LiteralExpression* asLiteral(const Ptr<Expression>& expr)
+{
+    return expr->type() == ExpressionType::Literal ? static_cast<const LiteralExpression*>(expr.get()) : nullptr;
+}
+
+static inline bool isLiteralValue(const Ptr<Expression>& expr, Integer value)
+{
+    const auto lit = asLiteral(expr);
+    if (!lit)
+        return false;
+    if (lit->returnType() == ElementaryType::Integer)
+        return lit->getInteger() == value;
+    if (lit->returnType() == ElementaryType::Number)
+        return lit->getNumber() == (Number)value;
+    return false;
+}
+
+static inline bool isLiteralBool(const Ptr<Expression>& expr, bool value)
+{
+    const auto lit = asLiteral(expr);
+    return lit && lit->returnType() == ElementaryType::Boolean && lit->getBool() == value;
+}
+
+Optimizer::Optimizer(const DefContainer& defs, const NativeResolver& resolver, bool foldConstants, bool simplifyIdentities)
+    : mDefinitions(defs)
+    , mResolver(resolver)
+    , mFoldConstants(foldConstants)
+    , mSimplifyIdentities(simplifyIdentities)
+    , mRoot()
+{
+}
+
+Ptr<Expression> Optimizer::handle(const Ptr<Expression>& expr)
+{
+    mRoot = expr;
+    return own(materialize(visit(expr)));
+}
+
+Optimizer::Result Optimizer::visit(const Ptr<Expression>& expr)
+{
+    switch (expr->type()) {
+    case ExpressionType::Literal:
+        return Result{ expr, mFoldConstants };
+    case ExpressionType::Unary:
+        return visitUnary(expr);
+    case ExpressionType::Binary:
+        return visitBinary(expr);
+    case ExpressionType::Call:
+        return visitCall(expr);
+    case ExpressionType::Access:
+        return visitAccess(expr);
+    default:
+        return Result{ expr, false };
+    }
+}
+
+Optimizer::Result Optimizer::visitUnary(const Ptr<Expression>& expr)
+{
+    const auto unary = static_cast<const UnaryExpression*>(expr.get());
+    const auto inner = visit(unary->inner());
+
+    Ptr<Expression> node = expr;
+    if (inner.Expr != unary->inner()) {
+        node = std::make_shared<UnaryExpression>(expr->location(), unary->op(), own(inner.Expr));
+        node->setReturnType(expr->returnType());
+    }
+
+    if (inner.Constant)
+        return Result{ node, true };
+
+    return Result{ mSimplifyIdentities ? simplifyUnary(node) : node, false };
+}
+
+Optimizer::Result Optimizer::visitBinary(const Ptr<Expression>& expr)
+{
+    const auto binary = static_cast<const BinaryExpression*>(expr.get());
+    auto left         = visit(binary->left());
+    auto right        = visit(binary->right());
+
+    bool constant = left.Constant && right.Constant;
+
+    // Integer division by zero or overflowing divisions trap on most transpile targets, keep them for the target to handle.
+    // Other overflowing integer operations fold to the wrapped around result of the evaluators, see Program.h
+    if (constant && (binary->op() == BinaryOperation::Div || binary->op() == BinaryOperation::Mod)
+        && left.Expr->returnType() == ElementaryType::Integer && right.Expr->returnType() == ElementaryType::Integer) {
+        right.Expr  = materialize(right);
+        const auto lit = asLiteral(right.Expr);
+        constant       = lit && lit->getInteger() != 0 && lit->getInteger() != -1;
+        right.Constant = lit != nullptr;
+    }
+
+    if (!constant) {
+        left.Expr  = materialize(left);
+        right.Expr = materialize(right);
+    }
+
+    Ptr<Expression> node = expr;
+    if (left.Expr != binary->left() || right.Expr != binary->right()) {
+        node = std::make_shared<BinaryExpression>(expr->location(), binary->op(), own(left.Expr), own(right.Expr));
+        node->setReturnType(expr->returnType());
+    }
+
+    if (constant)
+        return Result{ node, true };
+
+    return Result{ mSimplifyIdentities ? simplifyBinary(node) : node, false };
+}
+
+Optimizer::Result Optimizer::visitCall(const Ptr<Expression>& expr)
+{
+    const auto call = static_cast<const CallExpression*>(expr.get());
+
+    std::vector<Result> args;
+    args.reserve(call->parameters().size());
+    bool constant = mFoldConstants && call->definition().has_value();
+    for (const auto& param : call->parameters()) {
+        args.push_back(visit(param));
+        constant = constant && args.back().Constant;
+    }
+
+    constant = constant && isFoldable(call->definition().value());
+
+    bool changed = false;
+    CallExpression::ParameterList params;
+    params.reserve(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+        params.push_back(own(constant ? args[i].Expr : materialize(args[i])));
+        changed = changed || params.back() != call->parameters()[i];
+    }
+
+    Ptr<Expression> node = expr;
+    if (changed) {
+        auto newCall         = std::make_shared<CallExpression>(expr->location(), call->name(), std::move(params));
+        newCall->mDefinition = call->definition();
+        newCall->setReturnType(expr->returnType());
+        node = newCall;
+    }
+
+    return Result{ node, constant };
+}
+
+Optimizer::Result Optimizer::visitAccess(const Ptr<Expression>& expr)
+{
+    const auto access = static_cast<const AccessExpression*>(expr.get());
+    const auto inner  = visit(access->inner());
+
+    // Swizzles of constant vectors are folded as a whole
+    const Ptr<Expression> innerExpr = inner.Constant ? inner.Expr : materialize(inner);
+
+    Ptr<Expression> node = expr;
+    if (innerExpr != access->inner()) {
+        node = std::make_shared<AccessExpression>(expr->location(), own(innerExpr), access->swizzle());
+        node->setReturnType(expr->returnType());
+    }
+
+    return Result{ node, inner.Constant };
+}
+
+Ptr<Expression> Optimizer::materialize(const Result& result)
+{
+    if (!result.Constant || result.Expr->type() == ExpressionType::Literal)
+        return result.Expr;
+
+    const ElementaryType type = result.Expr->returnType();
+    if (isScalar(type)) {
+        const auto value = evaluate(result.Expr);
+        if (value.has_value())
+            return std::make_shared<LiteralExpression>(result.Expr->location(), type, value.value());
+    }
+
+    // Constant vectors have no literal representation, fold the scalar parts only. All children of a constant node are constant as well
+    const Ptr<Expression>& expr = result.Expr;
+    switch (expr->type()) {
+    case ExpressionType::Unary: {
+        const auto unary = static_cast<const UnaryExpression*>(expr.get());
+        const auto inner = materialize(Result{ unary->inner(), true });
+        if (inner == unary->inner())
+            return expr;
+        auto node = std::make_shared<UnaryExpression>(expr->location(), unary->op(), own(inner));
+        node->setReturnType(type);
+        return node;
+    }
+    case ExpressionType::Binary: {
+        const auto binary = static_cast<const BinaryExpression*>(expr.get());
+        const auto left   = materialize(Result{ binary->left(), true });
+        const auto right  = materialize(Result{ binary->right(), true });
+        if (left == binary->left() && right == binary->right())
+            return expr;
+        auto node = std::make_shared<BinaryExpression>(expr->location(), binary->op(), own(left), own(right));
+        node->setReturnType(type);
+        return node;
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr.get());
+        bool changed    = false;
+        CallExpression::ParameterList params;
+        params.reserve(call->parameters().size());
+        for (const auto& param : call->parameters()) {
+            params.push_back(own(materialize(Result{ param, true })));
+            changed = changed || params.back() != param;
+        }
+        if (!changed)
+            return expr;
+        auto node         = std::make_shared<CallExpression>(expr->location(), call->name(), std::move(params));
+        node->mDefinition = call->definition();
+        node->setReturnType(type);
+        return node;
+    }
+    case ExpressionType::Access: {
+        const auto access = static_cast<const AccessExpression*>(expr.get());
+        const auto inner  = materialize(Result{ access->inner(), true });
+        if (inner == access->inner())
+            return expr;
+        auto node = std::make_shared<AccessExpression>(expr->location(), own(inner), access->swizzle());
+        node->setReturnType(type);
+        return node;
+    }
+    default:
+        return expr;
+    }
+}
+
+std::optional<ValueVariant> Optimizer::evaluate(const Ptr<Expression>& expr)
+{
+    // Errors only prevent folding and are not reported
+    DiagnosticList diagnostics;
+    BytecodeCompiler compiler(mDefinitions, mResolver, &diagnostics);
+    Transpiler<Operand> transpiler(mDefinitions, &compiler);
+    const auto program = compiler.finish(transpiler.handle(expr));
+    if (!program)
+        return {};
+
+    VirtualMachine vm(program);
+    vm.run();
+
+    switch (program->resultType()) {
+    case ElementaryType::Boolean:
+        return ValueVariant(vm.resultBool());
+    case ElementaryType::Integer:
+        return ValueVariant(vm.resultInteger());
+    case ElementaryType::Number:
+        return ValueVariant(vm.resultNumber());
+    case ElementaryType::String:
+        return ValueVariant(vm.resultString());
+    default:
+        return {};
+    }
+}
+
+bool Optimizer::isFoldable(const FunctionDef& def)
+{
+    if (!def.isPure())
+        return false;
+    if (def.hasNative())
+        return true;
+    return mResolver && mResolver(def);
+}
+
+Ptr<Expression> Optimizer::simplifyUnary(const Ptr<Expression>& expr)
+{
+    const auto unary = static_cast<const UnaryExpression*>(expr.get());
+    const auto inner = unary->inner();
+
+    switch (unary->op()) {
+    case UnaryOperation::Pos:
+        return inner;
+    case UnaryOperation::Neg:
+    case UnaryOperation::Not:
+        // --x and !!b
+        if (inner->type() == ExpressionType::Unary && static_cast<const UnaryExpression*>(inner.get())->op() == unary->op())
+            return static_cast<const UnaryExpression*>(inner.get())->inner();
+        return expr;
+    default:
+        return expr;
+    }
+}
+
+Ptr<Expression> Optimizer::simplifyBinary(const Ptr<Expression>& expr)
+{
+    const auto binary         = static_cast<const BinaryExpression*>(expr.get());
+    const auto& left          = binary->left();
+    const auto& right         = binary->right();
+    const ElementaryType type = expr->returnType();
+
+    // Only replace the node if no implicit conversion would get lost
+    const bool keepLeft  = left->returnType() == type;
+    const bool keepRight = right->returnType() == type;
+
+    switch (binary->op()) {
+    case BinaryOperation::Add:
+        if (keepLeft && isLiteralValue(right, 0))
+            return left;
+        if (keepRight && isLiteralValue(left, 0))
+            return right;
+        return expr;
+    case BinaryOperation::Sub:
+        if (keepLeft && isLiteralValue(right, 0))
+            return left;
+        return expr;
+    case BinaryOperation::Mul:
+        if (keepLeft && isLiteralValue(right, 1))
+            return left;
+        if (keepRight && isLiteralValue(left, 1))
+            return right;
+        return expr;
+    case BinaryOperation::Div:
+    case BinaryOperation::Pow:
+        if (keepLeft && isLiteralValue(right, 1))
+            return left;
+        return expr;
+    case BinaryOperation::And:
+        if (isLiteralBool(right, true))
+            return left;
+        if (isLiteralBool(left, true))
+            return right;
+        return expr;
+    case BinaryOperation::Or:
+        if (isLiteralBool(right, false))
+            return left;
+        if (isLiteralBool(left, false))
+            return right;
+        return expr;
+    default:
+        return expr;
+    }
+}
+} // namespace PExpr::internal
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Arena.h"
+#include "../Expression.h"
+#include "../Program.h"
+#include "DefContainer.h"
+
+namespace PExpr::internal {
+/// Constant folding and algebraic simplification of type checked trees.
+/// Constant subtrees are evaluated by compiling them and running them on the virtual machine, which guarantees the same semantics as the transpiler.
+class Optimizer {
+public:
+    Optimizer(const DefContainer& defs, const NativeResolver& resolver, bool foldConstants, bool simplifyIdentities);
+
+    Ptr<Expression> handle(const Ptr<Expression>& expr);
+
+private:
+    /// An optimized subtree. Constant subtrees are folded by the first non-constant parent.
+    struct Result {
+        Ptr<Expression> Expr;
+        bool Constant;
+    };
+
+    Result visit(const Ptr<Expression>& expr);
+    Result visitUnary(const Ptr<Expression>& expr);
+    Result visitBinary(const Ptr<Expression>& expr);
+    Result visitCall(const Ptr<Expression>& expr);
+    Result visitAccess(const Ptr<Expression>& expr);
+
+    /// Replace constant scalar subtrees by literals. Constant vectors are kept, but their scalar parts are folded.
+    Ptr<Expression> materialize(const Result& result);
+    std::optional<ValueVariant> evaluate(const Ptr<Expression>& expr);
+    bool isFoldable(const FunctionDef& def);
+
+    Ptr<Expression> simplifyUnary(const Ptr<Expression>& expr);
+    Ptr<Expression> simplifyBinary(const Ptr<Expression>& expr);
+
+    /// Subtrees of trees placed in an arena do not own their nodes. Reused in new nodes or returned, they share the ownership of the root
+    inline Ptr<Expression> own(const Ptr<Expression>& expr) const { return shareOwnership(mRoot, expr); }
+
+    const DefContainer& mDefinitions;
+    const NativeResolver& mResolver;
+    const bool mFoldConstants;
+    const bool mSimplifyIdentities;
+    Ptr<Expression> mRoot;
+};
+} // namespace PExpr::internal
@@ -1,18 +1,21 @@
 #include "Parser.h"
-#include "Logger.h"
 
 namespace PExpr::internal {
-Parser::Parser(Lexer& lexer)
+Parser::Parser(Lexer& lexer, const Ptr<ExpressionArena>& arena, DiagnosticSink* diagnostics)
     : mLexer(lexer)
+    , mArena(arena)
+    , mReporter(diagnostics)
     , mCurrentToken()
     , mHasError(false)
+    , mNodeCount(0)
 {
 }
 
 Ptr<Expression> parse_translation_unit(Parser& parser);
 Ptr<Expression> Parser::parse()
 {
-    mHasError = false;
+    mHasError  = false;
+    mNodeCount = 0;
     for (size_t i = 0; i < mCurrentToken.size(); ++i) {
         mCurrentToken[i] = mLexer.next();
         if (mCurrentToken[i].Type == TokenType::Error) {
@@ -21,7 +24,8 @@ Ptr<Expression> Parser::parse()
         }
     }
 
-    return parse_translation_unit(*this);
+    // The whole tree is owned via the control block of the arena
+    return shareOwnership(mArena, parse_translation_unit(*this));
 }
 
 bool Parser::expect(TokenType type)
@@ -29,9 +33,9 @@ bool Parser::expect(TokenType type)
     bool same = cur().Type == type;
     if (!same) {
         if (cur().Type == TokenType::Eof)
-            PEXPR_LOG(LogLevel::Error) << cur().Location << ": Expected '" << Token::toString(type) << "' but input terminated early" << std::endl;
+            mReporter.error(cur().Location) << "Expected '" << Token::toString(type) << "' but input terminated early";
         else
-            PEXPR_LOG(LogLevel::Error) << cur().Location << ": Expected '" << Token::toString(type) << "' but got '" << Token::toString(cur().Type) << "'" << std::endl;
+            mReporter.error(cur().Location) << "Expected '" << Token::toString(type) << "' but got '" << Token::toString(cur().Type) << "'";
         mHasError = true;
     }
 
@@ -52,9 +56,9 @@ void Parser::error(const std::array<TokenType, N>& types)
     }
 
     if (cur().Type == TokenType::Eof)
-        PEXPR_LOG(LogLevel::Error) << cur().Location << ": Expected {" << expectation << "} but input terminated early" << std::endl;
+        mReporter.error(cur().Location) << "Expected {" << expectation << "} but input terminated early";
     else
-        PEXPR_LOG(LogLevel::Error) << cur().Location << ": Expected {" << expectation << "} but got '" << Token::toString(cur().Type) << "'" << std::endl;
+        mReporter.error(cur().Location) << "Expected {" << expectation << "} but got '" << Token::toString(cur().Type) << "'";
 }
 
 void Parser::eat(TokenType type)
@@ -99,7 +103,7 @@ public:
     {
         auto expr = p_expression();
         if (!P.hasError() && P.cur().Type != TokenType::Eof)
-            PEXPR_LOG(LogLevel::Error) << "Parsing stopped before end of stream!" << std::endl;
+            P.mReporter.error(P.cur().Location) << "Parsing stopped before end of stream!";
 
         return expr;
     }
@@ -163,7 +167,7 @@ private:
             P.next();
 
             auto right = p_binary_expression(prec - 1);
-            left       = std::make_shared<BinaryExpression>(loc, op, left, right);
+            left       = P.create<BinaryExpression>(loc, op, left, right);
         }
 
         return left;
@@ -173,11 +177,11 @@ private:
     {
         const auto loc = P.cur().Location;
         if (P.accept(TokenType::Plus))
-            return std::make_shared<UnaryExpression>(loc, UnaryOperation::Pos, p_unary_expression());
+            return P.create<UnaryExpression>(loc, UnaryOperation::Pos, p_unary_expression());
         if (P.accept(TokenType::Minus))
-            return std::make_shared<UnaryExpression>(loc, UnaryOperation::Neg, p_unary_expression());
+            return P.create<UnaryExpression>(loc, UnaryOperation::Neg, p_unary_expression());
         if (P.accept(TokenType::ExclamationMark))
-            return std::make_shared<UnaryExpression>(loc, UnaryOperation::Not, p_unary_expression());
+            return P.create<UnaryExpression>(loc, UnaryOperation::Not, p_unary_expression());
 
         return p_postfix_expression();
     }
@@ -192,7 +196,7 @@ private:
             if (P.cur().Type == TokenType::Dot) {
                 const auto loc = P.cur().Location;
                 auto swizzle   = p_swizzle();
-                return std::make_shared<AccessExpression>(loc, call, swizzle);
+                return P.create<AccessExpression>(loc, call, swizzle);
             }
             return call;
         }
@@ -203,7 +207,7 @@ private:
     inline Ptr<Expression> p_call_expression()
     {
         const auto loc             = P.cur().Location;
-        const std::string funcName = std::get<std::string>(P.cur().Value);
+        const std::string funcName = std::string(P.cur().text());
 
         P.expect(TokenType::Identifier);
         P.expect(TokenType::OpenParanthese);
@@ -215,7 +219,7 @@ private:
             P.expect(TokenType::ClosedParanthese);
         }
 
-        return std::make_shared<CallExpression>(loc, funcName, std::move(parameters));
+        return P.create<CallExpression>(loc, funcName, std::move(parameters));
     }
 
     inline void p_parameter_list(std::vector<Ptr<Expression>>& list)
@@ -236,31 +240,31 @@ private:
             if (P.cur().Type == TokenType::Dot) {
                 const auto loc = P.cur().Location;
                 auto swizzle   = p_swizzle();
-                return std::make_shared<AccessExpression>(loc, expr, swizzle);
+                return P.create<AccessExpression>(loc, expr, swizzle);
             }
             return expr;
         }
 
         const auto value = P.cur();
         if (P.accept(TokenType::Boolean))
-            return std::make_shared<LiteralExpression>(value.Location, ElementaryType::Boolean, value.Value);
+            return P.create<LiteralExpression>(value.Location, ElementaryType::Boolean, value.literal());
 
         if (P.accept(TokenType::Float))
-            return std::make_shared<LiteralExpression>(value.Location, ElementaryType::Number, value.Value);
+            return P.create<LiteralExpression>(value.Location, ElementaryType::Number, value.literal());
 
         if (P.accept(TokenType::Integer))
-            return std::make_shared<LiteralExpression>(value.Location, ElementaryType::Integer, value.Value);
+            return P.create<LiteralExpression>(value.Location, ElementaryType::Integer, value.literal());
 
         if (P.accept(TokenType::String))
-            return std::make_shared<LiteralExpression>(value.Location, ElementaryType::String, value.Value);
+            return P.create<LiteralExpression>(value.Location, ElementaryType::String, value.literal());
 
         if (P.accept(TokenType::Identifier)) {
-            auto var = std::make_shared<VariableExpression>(value.Location, std::get<std::string>(value.Value));
+            auto var = P.create<VariableExpression>(value.Location, std::string(value.text()));
 
             if (P.cur().Type == TokenType::Dot) {
                 const auto loc = P.cur().Location;
                 auto swizzle   = p_swizzle();
-                return std::make_shared<AccessExpression>(loc, var, swizzle);
+                return P.create<AccessExpression>(loc, var, swizzle);
             }
             return var;
         }
@@ -268,7 +272,7 @@ private:
         // Only print error if error was not introduced by lexer
         if (P.cur().Type != TokenType::Error)
             P.error(std::array<TokenType, 5>{ TokenType::Boolean, TokenType::Float, TokenType::Integer, TokenType::String, TokenType::Identifier });
-        return std::make_shared<ErrorExpression>(value.Location);
+        return P.create<ErrorExpression>(value.Location);
     }
 
     std::string p_swizzle()
@@ -276,7 +280,7 @@ private:
         P.expect(TokenType::Dot);
         auto token = P.cur();
         if (P.expect(TokenType::Identifier))
-            return std::get<std::string>(token.Value);
+            return std::string(token.text());
         else
             return {};
     }
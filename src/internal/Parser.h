@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../Arena.h"
 #include "../Expression.h"
 #include "Lexer.h"
+#include "Reporter.h"
 #include <array>
 
 namespace PExpr::internal {
@@ -9,11 +11,15 @@ class Parser {
     friend class ParserGrammar;
 
 public:
-    Parser(Lexer& lexer);
+    /// Parser constructing its nodes on the heap or, if given, inside the arena.
+    /// Diagnostics are reported to the given sink or, if none is given, to the global logger.
+    Parser(Lexer& lexer, const Ptr<ExpressionArena>& arena = nullptr, DiagnosticSink* diagnostics = nullptr);
 
     Ptr<Expression> parse();
 
     inline bool hasError() const { return mHasError; }
+    /// Number of nodes created by the last call to parse().
+    inline size_t nodeCount() const { return mNodeCount; }
 
 protected:
     bool expect(TokenType type);
@@ -24,8 +30,21 @@ protected:
     void next();
     inline const Token& cur(size_t i = 0) const { return mCurrentToken[i]; }
 
+    template <typename T, typename... Args>
+    inline Ptr<T> create(Args&&... args)
+    {
+        ++mNodeCount;
+        if (mArena)
+            return mArena->createUnowned<T>(std::forward<Args>(args)...); // Owned by the arena, see parse()
+        else
+            return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
     Lexer& mLexer;
+    Ptr<ExpressionArena> mArena;
+    Reporter mReporter;
     std::array<Token, 2> mCurrentToken;
     bool mHasError;
+    size_t mNodeCount;
 };
 } // namespace PExpr::internal
\ No newline at end of file
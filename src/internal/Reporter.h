@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../Diagnostics.h"
+
+#include <sstream>
+
+namespace PExpr::internal {
+/// Forwards diagnostics to the given sink or, if no sink is given, to the global logger.
+class Reporter {
+public:
+    /// Collects a single message and reports it when going out of scope.
+    class Entry {
+    public:
+        inline Entry(Reporter& reporter, LogLevel level, const Location& loc)
+            : mReporter(reporter)
+            , mLevel(level)
+            , mLocation(loc)
+            , mStream()
+        {
+        }
+
+        inline ~Entry()
+        {
+            mReporter.report(mLevel, mLocation, mStream.str());
+        }
+
+        template <typename T>
+        inline Entry& operator<<(const T& value)
+        {
+            mStream << value;
+            return *this;
+        }
+
+    private:
+        Reporter& mReporter;
+        LogLevel mLevel;
+        Location mLocation;
+        std::stringstream mStream;
+
+        PEXPR_CLASS_NON_COPYABLE(Entry);
+    };
+
+    inline explicit Reporter(DiagnosticSink* sink = nullptr)
+        : mSink(sink)
+    {
+    }
+
+    /// Start a new error message at the given location.
+    inline Entry error(const Location& loc) { return Entry(*this, LogLevel::Error, loc); }
+
+    inline void report(LogLevel level, const Location& loc, const std::string& message)
+    {
+        if (mSink)
+            mSink->report(Diagnostic{ level, loc, message });
+        else
+            PEXPR_LOG(level) << loc << ": " << message << std::endl;
+    }
+
+    inline DiagnosticSink* sink() const { return mSink; }
+
+private:
+    DiagnosticSink* mSink;
+};
+} // namespace PExpr::internal
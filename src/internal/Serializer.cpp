@@ -0,0 +1,525 @@
+#include "Serializer.h"
+
+namespace PExpr::internal {
+static constexpr char Magic[4]  = { 'P', 'X', 'A', 'B' };
+static constexpr uint32 Version = 1;
+
+// Flags of variables and calls
+static constexpr uint8 HasDefinition = 0x1;
+static constexpr uint8 IsPure        = 0x2;
+
+static inline void writeUInt(std::string& out, uint64 value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        out += (char)((value >> (8 * i)) & 0xFF);
+}
+
+/// Bounds checked little endian reader. After the first failure all reads return zero
+class ByteReader {
+public:
+    inline explicit ByteReader(std::string_view data)
+        : mData(data)
+        , mFailed(false)
+    {
+    }
+
+    inline uint64 read(size_t bytes)
+    {
+        if (mFailed || mData.size() < bytes) {
+            mFailed = true;
+            return 0;
+        }
+
+        uint64 value = 0;
+        for (size_t i = 0; i < bytes; ++i)
+            value |= (uint64)(uint8)mData[i] << (8 * i);
+        mData.remove_prefix(bytes);
+        return value;
+    }
+
+    inline uint8 readU8() { return (uint8)read(1); }
+    inline uint32 readU32() { return (uint32)read(4); }
+    inline uint64 readU64() { return read(8); }
+
+    inline std::string_view readBytes(size_t size)
+    {
+        if (mFailed || mData.size() < size) {
+            mFailed = true;
+            return {};
+        }
+
+        const std::string_view bytes = mData.substr(0, size);
+        mData.remove_prefix(size);
+        return bytes;
+    }
+
+    inline size_t remaining() const { return mData.size(); }
+    inline bool failed() const { return mFailed; }
+
+private:
+    std::string_view mData;
+    bool mFailed;
+};
+
+Serializer::Serializer()
+    : mNodeMap()
+    , mStringMap()
+    , mStrings()
+    , mNodes()
+    , mNodeCount(0)
+    , mRoots()
+{
+}
+
+uint32 Serializer::add(const Ptr<Expression>& expr)
+{
+    const uint32 root = addNode(expr.get());
+    mRoots.push_back(root);
+    return root;
+}
+
+uint32 Serializer::addString(const std::string& str)
+{
+    const auto it = mStringMap.find(str);
+    if (it != mStringMap.end())
+        return it->second;
+
+    const uint32 index = (uint32)mStrings.size();
+    mStrings.push_back(mStringMap.emplace(str, index).first->first);
+    return index;
+}
+
+uint32 Serializer::addNode(const Expression* expr)
+{
+    const auto it = mNodeMap.find(expr);
+    if (it != mNodeMap.end())
+        return it->second;
+
+    PEXPR_ASSERT(expr->type() != ExpressionType::Error, "Only valid expressions can be serialized");
+
+    // Children have to be written first
+    std::vector<uint32> children;
+    switch (expr->type()) {
+    case ExpressionType::Unary:
+        children.push_back(addNode(static_cast<const UnaryExpression*>(expr)->inner().get()));
+        break;
+    case ExpressionType::Binary:
+        children.push_back(addNode(static_cast<const BinaryExpression*>(expr)->left().get()));
+        children.push_back(addNode(static_cast<const BinaryExpression*>(expr)->right().get()));
+        break;
+    case ExpressionType::Call:
+        for (const auto& param : static_cast<const CallExpression*>(expr)->parameters())
+            children.push_back(addNode(param.get()));
+        break;
+    case ExpressionType::Access:
+        children.push_back(addNode(static_cast<const AccessExpression*>(expr)->inner().get()));
+        break;
+    default:
+        break;
+    }
+
+    writeUInt(mNodes, (uint64)expr->type(), 1);
+    writeUInt(mNodes, (uint64)expr->returnType(), 1);
+    writeUInt(mNodes, (uint64)expr->location().position(), 4);
+
+    switch (expr->type()) {
+    case ExpressionType::Variable: {
+        const auto var = static_cast<const VariableExpression*>(expr);
+        writeUInt(mNodes, addString(var->name()), 4);
+        writeUInt(mNodes, var->definition().has_value() ? HasDefinition : 0, 1);
+        break;
+    }
+    case ExpressionType::Literal: {
+        const ValueVariant& value = static_cast<const LiteralExpression*>(expr)->value();
+        writeUInt(mNodes, (uint64)value.index(), 1);
+        std::visit([&](auto&& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, bool>) {
+                writeUInt(mNodes, v ? 1 : 0, 1);
+            } else if constexpr (std::is_same_v<T, Integer>) {
+                writeUInt(mNodes, (uint64)v, 8);
+            } else if constexpr (std::is_same_v<T, Number>) {
+                uint64 bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                writeUInt(mNodes, bits, 8);
+            } else {
+                writeUInt(mNodes, addString(v), 4);
+            }
+        },
+                   value);
+        break;
+    }
+    case ExpressionType::Unary:
+        writeUInt(mNodes, (uint64) static_cast<const UnaryExpression*>(expr)->op(), 1);
+        break;
+    case ExpressionType::Binary:
+        writeUInt(mNodes, (uint64) static_cast<const BinaryExpression*>(expr)->op(), 1);
+        break;
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr);
+        writeUInt(mNodes, addString(call->name()), 4);
+        if (call->definition().has_value()) {
+            const FunctionDef& def = call->definition().value();
+            writeUInt(mNodes, HasDefinition | (def.isPure() ? IsPure : 0), 1);
+            writeUInt(mNodes, (uint64)def.returnType(), 1);
+            writeUInt(mNodes, def.parameters().size(), 4);
+            for (const auto& type : def.parameters())
+                writeUInt(mNodes, (uint64)type, 1);
+        } else {
+            writeUInt(mNodes, 0, 1);
+        }
+        writeUInt(mNodes, children.size(), 4);
+        break;
+    }
+    case ExpressionType::Access:
+        writeUInt(mNodes, addString(static_cast<const AccessExpression*>(expr)->swizzle()), 4);
+        break;
+    default:
+        break;
+    }
+
+    for (uint32 child : children)
+        writeUInt(mNodes, child, 4);
+
+    const uint32 index = mNodeCount++;
+    mNodeMap.emplace(expr, index);
+    return index;
+}
+
+std::string Serializer::finish() const
+{
+    std::string out;
+    out.append(Magic, sizeof(Magic));
+    writeUInt(out, Version, 4);
+    writeUInt(out, mStrings.size(), 4);
+    writeUInt(out, mNodeCount, 4);
+    writeUInt(out, mRoots.size(), 4);
+
+    for (const auto& str : mStrings) {
+        writeUInt(out, str.size(), 4);
+        out.append(str);
+    }
+
+    out.append(mNodes);
+
+    for (uint32 root : mRoots)
+        writeUInt(out, root, 4);
+
+    return out;
+}
+
+Deserializer::Deserializer(const DefContainer& defs, const Ptr<ExpressionArena>& arena, bool resolve, DiagnosticSink* diagnostics)
+    : mDefinitions(defs)
+    , mArena(arena)
+    , mResolve(resolve)
+    , mReporter(diagnostics)
+    , mTypeChecker(defs, diagnostics)
+{
+}
+
+static inline bool isValidType(uint8 type) { return type <= (uint8)ElementaryType::String; }
+static inline bool isSpecifiedType(uint8 type) { return type != (uint8)ElementaryType::Unspecified && isValidType(type); }
+
+/// Swizzles have one to four components, the size of the inner vector is checked by the type rules
+static inline bool isValidSwizzle(const std::string& swizzle)
+{
+    return !swizzle.empty() && swizzle.size() <= 4 && swizzle.find_first_not_of("xyzwrgba") == std::string::npos;
+}
+
+/// Index of the value variant representing a literal of the given type
+static inline int literalIndex(ElementaryType type)
+{
+    switch (type) {
+    case ElementaryType::Boolean:
+        return 0;
+    case ElementaryType::Integer:
+        return 1;
+    case ElementaryType::Number:
+        return 2;
+    case ElementaryType::String:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+std::optional<std::vector<Ptr<Expression>>> Deserializer::handle(std::string_view data)
+{
+    const Location start(0);
+    ByteReader in(data);
+
+    if (in.readBytes(sizeof(Magic)) != std::string_view(Magic, sizeof(Magic))) {
+        mReporter.error(start) << "Invalid binary expression data";
+        return {};
+    }
+
+    const uint32 version = in.readU32();
+    if (version != Version) {
+        mReporter.error(start) << "Unsupported binary expression version " << version << ", expected " << Version;
+        return {};
+    }
+
+    const uint32 stringCount = in.readU32();
+    const uint32 nodeCount   = in.readU32();
+    const uint32 rootCount   = in.readU32();
+
+    // Each entry needs at least four bytes, reject corrupted counts before allocating
+    if (in.failed() || (uint64)stringCount + nodeCount + rootCount > in.remaining() / 4) {
+        mReporter.error(start) << "Truncated binary expression data";
+        return {};
+    }
+
+    std::vector<std::string_view> strings;
+    strings.reserve(stringCount);
+    for (uint32 i = 0; i < stringCount; ++i)
+        strings.push_back(in.readBytes(in.readU32()));
+
+    const auto getString = [&](uint32 index) -> std::optional<std::string> {
+        if (index >= strings.size())
+            return {};
+        return std::string(strings[index]);
+    };
+
+    std::vector<Ptr<Expression>> nodes;
+    nodes.reserve(nodeCount);
+
+    const auto getChild = [&]() -> Ptr<Expression> {
+        const uint32 index = in.readU32();
+        return index < nodes.size() ? nodes[index] : nullptr;
+    };
+
+    for (uint32 i = 0; i < nodeCount && !in.failed(); ++i) {
+        const uint8 kind       = in.readU8();
+        const uint8 returnType = in.readU8();
+        const Location loc(in.readU32());
+
+        if (!isValidType(returnType))
+            break;
+
+        Ptr<Expression> node;
+        switch ((ExpressionType)kind) {
+        case ExpressionType::Variable: {
+            const auto name  = getString(in.readU32());
+            const uint8 flag = in.readU8();
+            if (!name.has_value())
+                break;
+
+            auto var = create<VariableExpression>(loc, name.value());
+            if (flag & HasDefinition) {
+                if (!isSpecifiedType(returnType))
+                    break;
+
+                if (mResolve) {
+                    var->mDefinition = mDefinitions.lookupVariable(loc, name.value());
+                    if (!var->mDefinition.has_value() || var->mDefinition->type() != (ElementaryType)returnType) {
+                        mReporter.error(loc) << "Unknown variable '" << name.value() << "' of type '" << toString((ElementaryType)returnType) << "'";
+                        return {};
+                    }
+                } else {
+                    var->mDefinition = VariableDef(name.value(), (ElementaryType)returnType);
+                }
+            }
+            node = var;
+            break;
+        }
+        case ExpressionType::Literal: {
+            const uint8 index = in.readU8();
+            if (index != literalIndex((ElementaryType)returnType))
+                break;
+
+            switch (index) {
+            case 0:
+                node = create<LiteralExpression>(loc, (ElementaryType)returnType, ValueVariant(in.readU8() != 0));
+                break;
+            case 1:
+                node = create<LiteralExpression>(loc, (ElementaryType)returnType, ValueVariant((Integer)in.readU64()));
+                break;
+            case 2: {
+                const uint64 bits = in.readU64();
+                Number value;
+                std::memcpy(&value, &bits, sizeof(value));
+                node = create<LiteralExpression>(loc, (ElementaryType)returnType, ValueVariant(value));
+                break;
+            }
+            case 3: {
+                const auto str = getString(in.readU32());
+                if (str.has_value())
+                    node = create<LiteralExpression>(loc, (ElementaryType)returnType, ValueVariant(str.value()));
+                break;
+            }
+            default:
+                break;
+            }
+            break;
+        }
+        case ExpressionType::Unary: {
+            const uint8 op   = in.readU8();
+            const auto inner = getChild();
+            if (op <= (uint8)UnaryOperation::Not && inner)
+                node = create<UnaryExpression>(loc, (UnaryOperation)op, inner);
+            break;
+        }
+        case ExpressionType::Binary: {
+            const uint8 op   = in.readU8();
+            const auto left  = getChild();
+            const auto right = getChild();
+            if (op <= (uint8)BinaryOperation::NotEqual && left && right)
+                node = create<BinaryExpression>(loc, (BinaryOperation)op, left, right);
+            break;
+        }
+        case ExpressionType::Call: {
+            const auto name  = getString(in.readU32());
+            const uint8 flag = in.readU8();
+
+            std::optional<FunctionDef> def;
+            if (flag & HasDefinition) {
+                const uint8 defReturnType = in.readU8();
+                const uint32 paramCount   = in.readU32();
+                if (paramCount > in.remaining() || !isSpecifiedType(defReturnType) || !isSpecifiedType(returnType))
+                    break;
+
+                std::vector<ElementaryType> params(paramCount);
+                bool validParams = true;
+                for (auto& type : params) {
+                    const uint8 value = in.readU8();
+                    validParams       = validParams && isSpecifiedType(value);
+                    type              = (ElementaryType)value;
+                }
+                if (!validParams || !name.has_value())
+                    break;
+
+                if (mResolve) {
+                    def = mDefinitions.lookupFunction(loc, name.value(), params);
+                    if (!def.has_value() || def->returnType() != (ElementaryType)defReturnType || def->parameters() != params) {
+                        mReporter.error(loc) << "Unknown function '" << name.value() << "' with " << paramCount << " parameters and return type '" << toString((ElementaryType)defReturnType) << "'";
+                        return {};
+                    }
+                } else {
+                    def = FunctionDef(name.value(), (ElementaryType)defReturnType, params, FunctionDef::NoNative, (flag & IsPure) != 0);
+                }
+            }
+
+            const uint32 argCount = in.readU32();
+            if (argCount > in.remaining() / 4 || !name.has_value())
+                break;
+
+            CallExpression::ParameterList args;
+            args.reserve(argCount);
+            for (uint32 k = 0; k < argCount; ++k)
+                args.push_back(getChild());
+            if (std::any_of(args.begin(), args.end(), [](const Ptr<Expression>& arg) { return arg == nullptr; }))
+                break;
+
+            auto call         = create<CallExpression>(loc, name.value(), std::move(args));
+            call->mDefinition = def;
+            node              = call;
+            break;
+        }
+        case ExpressionType::Access: {
+            const auto swizzle = getString(in.readU32());
+            const auto inner   = getChild();
+            if (swizzle.has_value() && !isValidSwizzle(swizzle.value())) {
+                mReporter.error(loc) << "Invalid access components '" << swizzle.value() << "' given";
+                return {};
+            }
+            if (swizzle.has_value() && inner)
+                node = create<AccessExpression>(loc, inner, swizzle.value());
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (!node || in.failed())
+            break;
+
+        // Children are validated already, therefore checking the node against the types of its direct children is sufficient
+        if ((ElementaryType)returnType != ElementaryType::Unspecified) {
+            const ElementaryType deduced = deduceType(node.get());
+            if (deduced != (ElementaryType)returnType) {
+                mReporter.error(loc) << "Stored type '" << toString((ElementaryType)returnType) << "' does not match the type rules, expected '" << toString(deduced) << "'";
+                return {};
+            }
+        }
+
+        node->setReturnType((ElementaryType)returnType);
+        nodes.push_back(node);
+    }
+
+    if (nodes.size() != nodeCount) {
+        mReporter.error(start) << "Corrupted binary expression data at node " << nodes.size();
+        return {};
+    }
+
+    std::vector<Ptr<Expression>> roots;
+    roots.reserve(rootCount);
+    for (uint32 i = 0; i < rootCount; ++i)
+        roots.push_back(shareOwnership(mArena, getChild()));
+
+    if (in.failed() || in.remaining() != 0 || std::any_of(roots.begin(), roots.end(), [](const Ptr<Expression>& root) { return root == nullptr; })) {
+        mReporter.error(start) << "Corrupted binary expression data";
+        return {};
+    }
+
+    return roots;
+}
+
+/// Type of the given node according to the type rules and the stored types of its children
+ElementaryType Deserializer::deduceType(const Expression* expr)
+{
+    const Location& loc = expr->location();
+
+    switch (expr->type()) {
+    case ExpressionType::Variable: {
+        const auto& def = static_cast<const VariableExpression*>(expr)->definition();
+        return def.has_value() ? def->type() : ElementaryType::Unspecified;
+    }
+    case ExpressionType::Literal:
+        return expr->returnType();
+    case ExpressionType::Unary: {
+        const auto unary               = static_cast<const UnaryExpression*>(expr);
+        const ElementaryType innerType = unary->inner()->returnType();
+        if (innerType == ElementaryType::Unspecified)
+            return ElementaryType::Unspecified;
+        return mTypeChecker.checkUnary(loc, unary->op(), innerType);
+    }
+    case ExpressionType::Binary: {
+        const auto binary              = static_cast<const BinaryExpression*>(expr);
+        const ElementaryType leftType  = binary->left()->returnType();
+        const ElementaryType rightType = binary->right()->returnType();
+        if (leftType == ElementaryType::Unspecified || rightType == ElementaryType::Unspecified)
+            return ElementaryType::Unspecified;
+        return mTypeChecker.checkBinary(loc, binary->op(), leftType, rightType);
+    }
+    case ExpressionType::Call: {
+        const auto call = static_cast<const CallExpression*>(expr);
+        if (!call->definition().has_value())
+            return ElementaryType::Unspecified;
+
+        const FunctionDef& def = call->definition().value();
+        if (call->parameters().size() != def.parameters().size()) {
+            mReporter.error(loc) << "Function '" << call->name() << "' expects " << def.parameters().size() << " arguments but got " << call->parameters().size();
+            return ElementaryType::Unspecified;
+        }
+
+        for (size_t i = 0; i < def.parameters().size(); ++i) {
+            const ElementaryType argType = call->parameters()[i]->returnType();
+            if (!isConvertible(argType, def.parameters()[i])) {
+                mReporter.error(loc) << "Argument " << (i + 1) << " of function '" << call->name() << "' has type '" << toString(argType) << "' but expected '" << toString(def.parameters()[i]) << "'";
+                return ElementaryType::Unspecified;
+            }
+        }
+        return def.returnType();
+    }
+    case ExpressionType::Access: {
+        const auto access              = static_cast<const AccessExpression*>(expr);
+        const ElementaryType innerType = access->inner()->returnType();
+        if (innerType == ElementaryType::Unspecified)
+            return ElementaryType::Unspecified;
+        return mTypeChecker.checkAccess(loc, innerType, access->swizzle());
+    }
+    default:
+        return ElementaryType::Unspecified;
+    }
+}
+} // namespace PExpr::internal
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../Arena.h"
+#include "../Expression.h"
+#include "DefContainer.h"
+#include "Reporter.h"
+#include "TypeChecker.h"
+
+namespace PExpr::internal {
+/// Binary representation of type checked expression trees.
+/// All values are stored little endian, independent of the platform. The layout is:
+///   header:  magic 'PXAB', u32 version, u32 string count, u32 node count, u32 root count
+///   strings: u32 size followed by the bytes, referenced by index
+///   nodes:   u8 kind, u8 return type, u32 location, payload depending on kind; children are referenced by the index of a previous node
+///   roots:   u32 node index for each expression
+/// Nodes shared between or within the given trees are written once.
+class Serializer {
+public:
+    Serializer();
+
+    /// Add a type checked tree and return the root index.
+    uint32 add(const Ptr<Expression>& expr);
+    /// Return the binary representation of all added trees.
+    std::string finish() const;
+
+private:
+    uint32 addNode(const Expression* expr);
+    uint32 addString(const std::string& str);
+
+    std::unordered_map<const Expression*, uint32> mNodeMap;
+    std::unordered_map<std::string, uint32> mStringMap;
+    std::vector<std::string_view> mStrings;
+    std::string mNodes;
+    uint32 mNodeCount;
+    std::vector<uint32> mRoots;
+};
+
+/// Reconstructs trees written by Serializer without lexing or parsing them again.
+/// As children are stored before their parents, the stored types are validated node by node against the type rules in linear time, also if subtrees are shared.
+/// Nodes without a type stem from trees which were not type checked and are only accepted if all their parents are untyped as well.
+class Deserializer {
+public:
+    /// If resolve is true, variables and functions are resolved against the given definitions, else the stored definitions are used.
+    Deserializer(const DefContainer& defs, const Ptr<ExpressionArena>& arena, bool resolve, DiagnosticSink* diagnostics = nullptr);
+
+    /// Return all stored trees or nothing if the data is invalid.
+    std::optional<std::vector<Ptr<Expression>>> handle(std::string_view data);
+
+private:
+    ElementaryType deduceType(const Expression* expr);
+
+    template <typename T, typename... Args>
+    inline Ptr<T> create(Args&&... args)
+    {
+        if (mArena)
+            return mArena->createUnowned<T>(std::forward<Args>(args)...);
+        else
+            return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
+    const DefContainer& mDefinitions;
+    const Ptr<ExpressionArena> mArena;
+    const bool mResolve;
+    Reporter mReporter;
+    TypeChecker mTypeChecker;
+};
+} // namespace PExpr::internal
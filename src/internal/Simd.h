@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../PExpr_Config.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PEXPR_ARCH_X64
+#include <immintrin.h>
+#ifdef PEXPR_CC_MSC
+#include <intrin.h>
+#endif
+#endif
+
+// Functions using AVX2 intrinsics have to be marked for GCC and Clang, as the rest of the library is compiled for the baseline instruction set
+#if defined(PEXPR_ARCH_X64) && (defined(PEXPR_CC_GNU) || defined(PEXPR_CC_CLANG))
+#define PEXPR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define PEXPR_TARGET_AVX2
+#endif
+
+namespace PExpr::internal {
+/// True if AVX2 and FMA are supported by the cpu and the operating system.
+inline bool cpuSupportsAVX2()
+{
+#if defined(PEXPR_ARCH_X64) && (defined(PEXPR_CC_GNU) || defined(PEXPR_CC_CLANG))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(PEXPR_ARCH_X64) && defined(PEXPR_CC_MSC)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma     = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+} // namespace PExpr::internal
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../Statistics.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace PExpr::internal {
+/// Threadsafe accumulation of the counters given by EnvironmentStatistics.
+/// Nothing is recorded while disabled, which keeps the overhead at a single relaxed load per call.
+class StatisticsCollector {
+public:
+    enum Counter {
+        LexTime = 0,
+        ParseTime,
+        TypeCheckTime,
+        TranspileTime,
+        Tokens,
+        Nodes,
+        VariableLookups,
+        FunctionLookups,
+        CacheHits,
+        Errors,
+        CounterCount
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    /// Adds the time elapsed between construction and destruction to the given counter, if the collector was enabled at construction.
+    class ScopedTimer {
+    public:
+        inline ScopedTimer(const StatisticsCollector& collector, Counter counter)
+            : mCollector(collector.isEnabled() ? &collector : nullptr)
+            , mCounter(counter)
+            , mStart(mCollector ? Clock::now() : Clock::time_point())
+        {
+        }
+
+        inline ~ScopedTimer()
+        {
+            if (mCollector)
+                mCollector->add(mCounter, elapsedNanoseconds(mStart));
+        }
+
+    private:
+        const StatisticsCollector* mCollector;
+        const Counter mCounter;
+        const Clock::time_point mStart;
+
+        PEXPR_CLASS_NON_COPYABLE(ScopedTimer);
+    };
+
+    StatisticsCollector() = default;
+
+    /// Copies only the state, but not the counters.
+    inline StatisticsCollector(const StatisticsCollector& other)
+        : mEnabled(other.isEnabled())
+    {
+    }
+
+    /// Copies only the state, but not the counters.
+    inline StatisticsCollector& operator=(const StatisticsCollector& other)
+    {
+        setEnabled(other.isEnabled());
+        reset();
+        return *this;
+    }
+
+    inline void setEnabled(bool b) { mEnabled.store(b, std::memory_order_relaxed); }
+    inline bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    inline void add(Counter counter, uint64 value) const
+    {
+        if (isEnabled())
+            mCounters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    inline void increment(Counter counter) const { add(counter, 1); }
+
+    /// The counters are read one after another. Calls finishing concurrently might be contained only partially.
+    inline EnvironmentStatistics snapshot() const
+    {
+        EnvironmentStatistics stats;
+        stats.LexNanoseconds       = get(LexTime);
+        stats.ParseNanoseconds     = get(ParseTime);
+        stats.TypeCheckNanoseconds = get(TypeCheckTime);
+        stats.TranspileNanoseconds = get(TranspileTime);
+        stats.Tokens               = get(Tokens);
+        stats.Nodes                = get(Nodes);
+        stats.VariableLookups      = get(VariableLookups);
+        stats.FunctionLookups      = get(FunctionLookups);
+        stats.CacheHits            = get(CacheHits);
+        stats.Errors               = get(Errors);
+        return stats;
+    }
+
+    inline void reset()
+    {
+        for (auto& counter : mCounters)
+            counter.store(0, std::memory_order_relaxed);
+    }
+
+    static inline uint64 elapsedNanoseconds(const Clock::time_point& start)
+    {
+        return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+private:
+    inline uint64 get(Counter counter) const { return mCounters[counter].load(std::memory_order_relaxed); }
+
+    std::atomic<bool> mEnabled = false;
+    mutable std::array<std::atomic<uint64>, CounterCount> mCounters = {};
+};
+} // namespace PExpr::internal
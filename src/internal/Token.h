@@ -2,6 +2,8 @@
 
 #include "../Location.h"
 
+#include <string_view>
+
 namespace PExpr::internal {
 enum class TokenType {
     Error,
@@ -32,6 +34,9 @@ enum class TokenType {
     NotEqual,         // !=
 };
 
+/// Values a token can hold. Identifiers and strings produced from a buffer reference the buffer directly.
+using TokenValue = std::variant<bool, Integer, Number, std::string, std::string_view>;
+
 class Token {
 public:
     inline Token()
@@ -72,9 +77,37 @@ public:
         return *this;
     }
 
+    Token& With(std::string_view str)
+    {
+        Value = str;
+        return *this;
+    }
+
+    /// The text of an identifier or string token, regardless if it is owned or references the source.
+    inline std::string_view text() const
+    {
+        if (std::holds_alternative<std::string_view>(Value))
+            return std::get<std::string_view>(Value);
+        return std::get<std::string>(Value);
+    }
+
+    /// The value as owning variant usable by literals.
+    inline ValueVariant literal() const
+    {
+        return std::visit(
+            [](auto&& arg) -> ValueVariant {
+                using T = std::decay_t<decltype(arg)>;
+                if constexpr (std::is_same_v<T, std::string_view>)
+                    return std::string(arg);
+                else
+                    return arg;
+            },
+            Value);
+    }
+
     PExpr::Location Location;
     TokenType Type;
-    ValueVariant Value;
+    TokenValue Value;
 
     static std::string_view toString(TokenType type);
 };
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../TraceRecorder.h"
+
+namespace PExpr::internal {
+/// Records the time between construction and destruction in the given recorder. Does nothing if no recorder is given.
+class TraceSpan {
+public:
+    inline TraceSpan(TraceRecorder* recorder, const char* name)
+        : mRecorder(recorder)
+        , mName(name)
+        , mStart(recorder ? TraceRecorder::Clock::now() : TraceRecorder::Clock::time_point())
+        , mId(nullptr)
+        , mExpression(nullptr)
+        , mSize(0)
+        , mDetail()
+    {
+    }
+
+    inline ~TraceSpan()
+    {
+        if (mRecorder)
+            mRecorder->record(mName, mStart, TraceRecorder::Clock::now(), mId, mExpression ? TraceRecorder::nodeCount(mExpression) : mSize, mDetail);
+    }
+
+    /// The nodes of the given tree are only counted if the span is recorded.
+    inline void setExpression(const Expression* expr)
+    {
+        mId         = expr;
+        mExpression = expr;
+    }
+
+    inline void setExpression(const void* id, size_t size)
+    {
+        mId         = id;
+        mExpression = nullptr;
+        mSize       = size;
+    }
+
+    /// The given string has to outlive the span.
+    inline void setDetail(std::string_view detail) { mDetail = detail; }
+
+private:
+    TraceRecorder* const mRecorder;
+    const char* const mName;
+    const TraceRecorder::Clock::time_point mStart;
+    const void* mId;
+    const Expression* mExpression;
+    size_t mSize;
+    std::string_view mDetail;
+
+    PEXPR_CLASS_NON_COPYABLE(TraceSpan);
+};
+} // namespace PExpr::internal
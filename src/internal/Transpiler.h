@@ -1,6 +1,8 @@
 #pragma once
 
+#include "../FlatExpression.h"
 #include "../TranspileVisitor.h"
+#include "CommonSubexpressions.h"
 #include "DefContainer.h"
 
 namespace PExpr::internal {
@@ -9,35 +11,108 @@ class Transpiler {
 public:
     using Visitor = TranspileVisitor<Payload>;
 
-    inline explicit Transpiler(const DefContainer& defs, Visitor* visitor)
+    /// If common subexpressions are given, each shared subtree is transpiled only once and reused via temporaries.
+    inline explicit Transpiler(const DefContainer& defs, Visitor* visitor, const CommonSubexpressions* subexpressions = nullptr)
         : mDefinitions(defs)
         , mVisitor(visitor)
+        , mSubexpressions(subexpressions)
+        , mTemporaries(subexpressions ? subexpressions->count() : 0)
+        , mTemporaryCount(0)
     {
         PEXPR_ASSERT(visitor != nullptr, "Expected a valid pointer to a visitor");
     }
 
     Payload handle(const Ptr<Expression>& expr)
+    {
+        if (!mSubexpressions)
+            return handleExpression(expr);
+
+        const uint32 shared = mSubexpressions->find(expr.get());
+        if (shared == CommonSubexpressions::InvalidIndex)
+            return handleExpression(expr);
+
+        auto& temporary = mTemporaries[shared];
+        if (temporary.has_value())
+            return mVisitor->onTemporaryRef(temporary->first, expr->returnType(), temporary->second);
+
+        // Temporaries are numbered in the order they are emitted
+        const uint32 id     = mTemporaryCount++;
+        const Payload value = mVisitor->onTemporary(id, expr->returnType(), handleExpression(expr));
+        temporary           = std::make_pair(id, value);
+        return value;
+    }
+
+    /// Sequential transpilation of a flat expression.
+    Payload handle(const FlatExpression& expr)
+    {
+        std::vector<Payload> values(expr.size());
+        std::vector<ElementaryType> types;
+        std::vector<Payload> args;
+
+        // Nodes are in post-order, therefore all operands are available before the node itself.
+        // Each node is used exactly once as an operand, which allows moving the payload out of the array
+        const auto& nodes = expr.nodes();
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const auto& node = nodes[i];
+            switch (node.Type) {
+            case ExpressionType::Variable:
+                values[i] = handleVariable(node.Location, expr.name(node.Data), expr.variableDefinition(node), expr.variableSlot(node));
+                break;
+            case ExpressionType::Literal:
+                values[i] = handleLiteral(node.ReturnType, expr.literal(node.Data));
+                break;
+            case ExpressionType::Unary:
+                values[i] = handleUnary((UnaryOperation)node.Operation,
+                                        std::move(values[node.Operands[0]]), nodes[node.Operands[0]].ReturnType);
+                break;
+            case ExpressionType::Binary:
+                values[i] = handleBinary((BinaryOperation)node.Operation,
+                                         std::move(values[node.Operands[0]]), nodes[node.Operands[0]].ReturnType,
+                                         std::move(values[node.Operands[1]]), nodes[node.Operands[1]].ReturnType);
+                break;
+            case ExpressionType::Call: {
+                types.clear();
+                args.clear();
+                for (uint32 arg : expr.arguments(node)) {
+                    types.push_back(nodes[arg].ReturnType);
+                    args.push_back(std::move(values[arg]));
+                }
+                values[i] = handleCall(node.Location, expr.name(node.Data), types, args, expr.functionDefinition(node));
+            } break;
+            case ExpressionType::Access:
+                values[i] = handleAccess(std::move(values[node.Operands[0]]), nodes[node.Operands[0]].ReturnType, expr.name(node.Data));
+                break;
+            default:
+                PEXPR_ASSERT(false, "Unreachable code reached!");
+                break;
+            }
+        }
+
+        return values.empty() ? Payload{} : std::move(values.back());
+    }
+
+private:
+    Payload handleExpression(const Ptr<Expression>& expr)
     {
         switch (expr->type()) {
         case ExpressionType::Variable:
-            return handleNode(std::reinterpret_pointer_cast<VariableExpression>(expr));
+            return handleNode(static_cast<const VariableExpression*>(expr.get()));
         case ExpressionType::Literal:
-            return handleNode(std::reinterpret_pointer_cast<LiteralExpression>(expr));
+            return handleNode(static_cast<const LiteralExpression*>(expr.get()));
         case ExpressionType::Unary:
-            return handleNode(std::reinterpret_pointer_cast<UnaryExpression>(expr));
+            return handleNode(static_cast<const UnaryExpression*>(expr.get()));
         case ExpressionType::Binary:
-            return handleNode(std::reinterpret_pointer_cast<BinaryExpression>(expr));
+            return handleNode(static_cast<const BinaryExpression*>(expr.get()));
         case ExpressionType::Call:
-            return handleNode(std::reinterpret_pointer_cast<CallExpression>(expr));
+            return handleNode(static_cast<const CallExpression*>(expr.get()));
         case ExpressionType::Access:
-            return handleNode(std::reinterpret_pointer_cast<AccessExpression>(expr));
+            return handleNode(static_cast<const AccessExpression*>(expr.get()));
         default:
             PEXPR_ASSERT(false, "Unreachable code reached!");
             return Payload{};
         }
     }
 
-private:
     Payload handleCast(const Payload& a, ElementaryType from, ElementaryType to)
     {
         if (from == to) {
@@ -48,9 +123,20 @@ private:
         }
     }
 
-    Payload handleNode(const Ptr<VariableExpression>& expr)
+    Payload handleNode(const VariableExpression* expr)
+    {
+        return handleVariable(expr->location(), expr->name(), expr->definition().has_value() ? &expr->definition().value() : nullptr, expr->slot());
+    }
+
+    /// Use the definition resolved while type checking, if available, instead of looking it up again
+    Payload handleVariable(const Location& loc, const std::string& name, const VariableDef* resolved, uint32 slot)
     {
-        auto p = mDefinitions.lookupVariable(expr->location(), expr->name());
+        if (resolved && slot != VariableExpression::InvalidSlot)
+            return mVisitor->onSlotVariable(*resolved, slot);
+        if (resolved)
+            return mVisitor->onVariable(resolved->name(), resolved->type());
+
+        auto p = mDefinitions.lookupVariable(loc, name);
 
         if (p.has_value())
             return mVisitor->onVariable(p.value().name(), p.value().type());
@@ -59,31 +145,40 @@ private:
         return Payload{};
     }
 
-    Payload handleNode(const Ptr<LiteralExpression>& expr)
+    Payload handleNode(const LiteralExpression* expr)
     {
-        switch (expr->returnType()) {
+        return handleLiteral(expr->returnType(), expr->value());
+    }
+
+    Payload handleLiteral(ElementaryType type, const ValueVariant& value)
+    {
+        switch (type) {
         case ElementaryType::Boolean:
-            return mVisitor->onBool(expr->getBool());
+            return mVisitor->onBool(std::get<bool>(value));
         case ElementaryType::Integer:
-            return mVisitor->onInteger(expr->getInteger());
+            return mVisitor->onInteger(std::get<Integer>(value));
         case ElementaryType::Number:
-            return mVisitor->onNumber(expr->getNumber());
+            return mVisitor->onNumber(std::get<Number>(value));
         case ElementaryType::String:
-            return mVisitor->onString(expr->getString());
+            return mVisitor->onString(std::get<std::string>(value));
         default:
             PEXPR_ASSERT(false, "Should have been caught by the typechecker!");
             return Payload{};
         }
     }
 
-    Payload handleNode(const Ptr<UnaryExpression>& expr)
+    Payload handleNode(const UnaryExpression* expr)
+    {
+        return handleUnary(expr->op(), handle(expr->inner()), expr->inner()->returnType());
+    }
+
+    Payload handleUnary(UnaryOperation op, const Payload& A, ElementaryType AType)
     {
-        const auto A = handle(expr->inner());
-        switch (expr->op()) {
+        switch (op) {
         case UnaryOperation::Pos:
         case UnaryOperation::Neg: {
-            bool isNeg = expr->op() == UnaryOperation::Neg;
-            return mVisitor->onPosNeg(isNeg, expr->inner()->returnType(), A);
+            bool isNeg = op == UnaryOperation::Neg;
+            return mVisitor->onPosNeg(isNeg, AType, A);
         } break;
         case UnaryOperation::Not:
             return mVisitor->onNot(A);
@@ -160,17 +255,34 @@ private:
         }
     }
 
-    Payload handleNode(const Ptr<BinaryExpression>& expr)
+    Payload handleEqual(bool isNeg, const Payload& a, ElementaryType atype, const Payload& b, ElementaryType btype)
     {
-        const auto A     = handle(expr->left());
-        const auto AType = expr->left()->returnType();
-        const auto B     = handle(expr->right());
-        const auto BType = expr->right()->returnType();
+        if (atype != btype) {
+            if (atype == ElementaryType::Integer && btype == ElementaryType::Number)
+                return handleEqual(isNeg, handleCast(a, atype, ElementaryType::Number), ElementaryType::Number, b, btype);
+            else if (atype == ElementaryType::Number && btype == ElementaryType::Integer)
+                return handleEqual(isNeg, a, atype, handleCast(b, btype, ElementaryType::Number), ElementaryType::Number);
+
+            PEXPR_ASSERT(false, "Should have been caught by the typechecker!");
+            return Payload{};
+        } else {
+            return mVisitor->onEqual(isNeg, atype, a, b);
+        }
+    }
+
+    Payload handleNode(const BinaryExpression* expr)
+    {
+        const auto A = handle(expr->left());
+        const auto B = handle(expr->right());
+        return handleBinary(expr->op(), A, expr->left()->returnType(), B, expr->right()->returnType());
+    }
 
-        switch (expr->op()) {
+    Payload handleBinary(BinaryOperation op, const Payload& A, ElementaryType AType, const Payload& B, ElementaryType BType)
+    {
+        switch (op) {
         case BinaryOperation::Add:
         case BinaryOperation::Sub:
-            return handleAddSub(expr->op() == BinaryOperation::Sub, A, AType, B, BType);
+            return handleAddSub(op == BinaryOperation::Sub, A, AType, B, BType);
         case BinaryOperation::Mul:
             if (isConvertible(BType, ElementaryType::Number) && isArray(AType))
                 return handleScale(false, A, AType, B, BType);
@@ -200,19 +312,17 @@ private:
         case BinaryOperation::GreaterEqual:
             return handleRelOp(RelationalOp::GreaterEqual, A, AType, B, BType);
         case BinaryOperation::Equal:
-            return mVisitor->onEqual(false, AType, A, B);
+            return handleEqual(false, A, AType, B, BType);
         case BinaryOperation::NotEqual:
-            return mVisitor->onEqual(true, AType, A, B);
+            return handleEqual(true, A, AType, B, BType);
         }
 
         PEXPR_ASSERT(false, "Unreachable code reached!");
         return Payload{};
     }
 
-    Payload handleNode(const Ptr<CallExpression>& expr)
+    Payload handleNode(const CallExpression* expr)
     {
-        const std::string& funcName = expr->name();
-
         std::vector<ElementaryType> types;
         std::vector<Payload> args;
         types.reserve(expr->parameters().size());
@@ -223,27 +333,41 @@ private:
             args.push_back(handle(e));
         }
 
-        auto def = mDefinitions.lookupFunction(expr->location(), funcName, types);
+        return handleCall(expr->location(), expr->name(), types, args, expr->definition().has_value() ? &expr->definition().value() : nullptr);
+    }
 
-        if (!def.has_value()) {
-            PEXPR_ASSERT(false, "Should have been caught by the typechecker!");
-            return Payload{};
+    /// Use the definition resolved while type checking, if available, instead of looking it up again
+    Payload handleCall(const Location& loc, const std::string& funcName, const std::vector<ElementaryType>& types, std::vector<Payload>& args, const FunctionDef* resolved)
+    {
+        std::optional<FunctionDef> lookup;
+        if (!resolved) {
+            lookup = mDefinitions.lookupFunction(loc, funcName, types);
+
+            if (!lookup.has_value()) {
+                PEXPR_ASSERT(false, "Should have been caught by the typechecker!");
+                return Payload{};
+            }
+            resolved = &lookup.value();
         }
 
         // Handle implicit casts
         for (size_t i = 0; i < args.size(); ++i) {
             ElementaryType fromType = types[i];
-            ElementaryType toType   = def.value().parameters().at(i);
+            ElementaryType toType   = resolved->parameters().at(i);
 
             args[i] = handleCast(args[i], fromType, toType);
         }
 
-        return mVisitor->onFunctionCall(funcName, def.value().returnType(), def.value().parameters(), args);
+        return mVisitor->onResolvedCall(*resolved, args);
     }
 
-    Payload handleNode(const Ptr<AccessExpression>& expr)
+    Payload handleNode(const AccessExpression* expr)
+    {
+        return handleAccess(handle(expr->inner()), expr->inner()->returnType(), expr->swizzle());
+    }
+
+    Payload handleAccess(const Payload& A, ElementaryType innerType, const std::string& swizzle)
     {
-        const auto A = handle(expr->inner());
 
         const auto charC = [](char c) -> uint8 {
             if (c == 'x' || c == 'r')
@@ -256,7 +380,6 @@ private:
                 return 3;
         };
 
-        const std::string& swizzle = expr->swizzle();
         std::vector<uint8> outputPermutation;
         if (swizzle.size() == 1) {
             outputPermutation = { charC(swizzle[0]) };
@@ -274,7 +397,7 @@ private:
                                   charC(swizzle[3]) };
         }
 
-        const auto inputSize = typeArraySize(expr->inner()->returnType());
+        const auto inputSize = typeArraySize(innerType);
         PEXPR_ASSERT(inputSize > 1, "Access operator can only be used with vector types");
 
         return mVisitor->onAccess(A, inputSize, outputPermutation);
@@ -282,6 +405,10 @@ private:
 
     const DefContainer& mDefinitions;
     Visitor* mVisitor;
+
+    const CommonSubexpressions* mSubexpressions;
+    std::vector<std::optional<std::pair<uint32, Payload>>> mTemporaries; // Id and payload of each emitted shared subtree
+    uint32 mTemporaryCount;
 };
 
 } // namespace PExpr::internal
\ No newline at end of file
@@ -1,23 +1,23 @@
 #include "TypeChecker.h"
-#include "Logger.h"
 
 #include <algorithm>
 
 namespace PExpr::internal {
-inline void typeError(const Ptr<UnaryExpression>& expr, ElementaryType type)
+inline void typeError(Reporter& reporter, const Location& loc, UnaryOperation op, ElementaryType type)
 {
-    PEXPR_LOG(LogLevel::Error) << expr->location() << ": Can not use operator '" << toString(expr->op())
-                               << "' with type '" << toString(type) << "'" << std::endl;
+    reporter.error(loc) << "Can not use operator '" << toString(op)
+                        << "' with type '" << toString(type) << "'";
 }
 
-inline void typeError(const Ptr<BinaryExpression>& expr, ElementaryType left, ElementaryType right)
+inline void typeError(Reporter& reporter, const Location& loc, BinaryOperation op, ElementaryType left, ElementaryType right)
 {
-    PEXPR_LOG(LogLevel::Error) << expr->location() << ": Can not use operator '" << toString(expr->op())
-                               << "' with types '" << toString(left) << "' and '" << toString(right) << "'" << std::endl;
+    reporter.error(loc) << "Can not use operator '" << toString(op)
+                        << "' with types '" << toString(left) << "' and '" << toString(right) << "'";
 }
 
-TypeChecker::TypeChecker(const DefContainer& defs)
+TypeChecker::TypeChecker(const DefContainer& defs, DiagnosticSink* diagnostics)
     : mDefinitions(defs)
+    , mReporter(diagnostics)
 {
 }
 
@@ -25,144 +25,253 @@ ElementaryType TypeChecker::handle(const Ptr<Expression>& expr)
 {
     switch (expr->type()) {
     case ExpressionType::Variable:
-        return handleNode(std::reinterpret_pointer_cast<VariableExpression>(expr));
+        return handleNode(static_cast<VariableExpression*>(expr.get()));
     case ExpressionType::Literal:
-        return handleNode(std::reinterpret_pointer_cast<LiteralExpression>(expr));
+        return handleNode(static_cast<LiteralExpression*>(expr.get()));
     case ExpressionType::Unary:
-        return handleNode(std::reinterpret_pointer_cast<UnaryExpression>(expr));
+        return handleNode(static_cast<UnaryExpression*>(expr.get()));
     case ExpressionType::Binary:
-        return handleNode(std::reinterpret_pointer_cast<BinaryExpression>(expr));
+        return handleNode(static_cast<BinaryExpression*>(expr.get()));
     case ExpressionType::Call:
-        return handleNode(std::reinterpret_pointer_cast<CallExpression>(expr));
+        return handleNode(static_cast<CallExpression*>(expr.get()));
     case ExpressionType::Access:
-        return handleNode(std::reinterpret_pointer_cast<AccessExpression>(expr));
+        return handleNode(static_cast<AccessExpression*>(expr.get()));
     default:
         return ElementaryType::Unspecified;
     }
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<VariableExpression>& expr)
+ElementaryType TypeChecker::handle(FlatExpression& expr)
 {
-    auto def = mDefinitions.lookupVariable(expr->location(), expr->name());
-    if (def.has_value()) {
-        expr->setReturnType(def.value().type());
-        return def.value().type();
-    } else {
-        PEXPR_LOG(LogLevel::Error) << expr->location() << ": Unknown identifier '" << expr->name() << "' found" << std::endl;
-        return ElementaryType::Unspecified;
+    std::vector<ElementaryType> fromArgs;
+
+    // Nodes are in post-order, therefore all operands are handled before the node itself
+    for (auto& node : expr.mNodes) {
+        const auto operandType = [&](size_t i) { return expr.mNodes[node.Operands[i]].ReturnType; };
+
+        switch (node.Type) {
+        case ExpressionType::Variable: {
+            const auto def = checkVariable(node.Location, expr.name(node.Data));
+            if (def.has_value()) {
+                node.ReturnType = def.value().type();
+                expr.setDefinition(node, def.value());
+            } else {
+                node.ReturnType = ElementaryType::Unspecified;
+            }
+        } break;
+        case ExpressionType::Literal:
+            break;
+        case ExpressionType::Unary:
+            if (operandType(0) == ElementaryType::Unspecified)
+                node.ReturnType = ElementaryType::Unspecified; // Error was caught somewhere else
+            else
+                node.ReturnType = checkUnary(node.Location, (UnaryOperation)node.Operation, operandType(0));
+            break;
+        case ExpressionType::Binary:
+            if (operandType(0) == ElementaryType::Unspecified || operandType(1) == ElementaryType::Unspecified)
+                node.ReturnType = ElementaryType::Unspecified; // Error was caught somewhere else
+            else
+                node.ReturnType = checkBinary(node.Location, (BinaryOperation)node.Operation, operandType(0), operandType(1));
+            break;
+        case ExpressionType::Call: {
+            const auto arguments = expr.arguments(node);
+
+            fromArgs.clear();
+            for (uint32 arg : arguments) {
+                const auto type = expr.mNodes[arg].ReturnType;
+                if (type == ElementaryType::Unspecified)
+                    break; // Error was caught somewhere else
+                fromArgs.push_back(type);
+            }
+
+            node.ReturnType = ElementaryType::Unspecified;
+            if (fromArgs.size() == arguments.size()) {
+                const auto def = checkCall(node.Location, expr.name(node.Data), fromArgs);
+                if (def.has_value()) {
+                    node.ReturnType = def.value().returnType();
+                    expr.setDefinition(node, def.value());
+                }
+            }
+        } break;
+        case ExpressionType::Access:
+            if (operandType(0) == ElementaryType::Unspecified)
+                node.ReturnType = ElementaryType::Unspecified; // Error was caught somewhere else
+            else
+                node.ReturnType = checkAccess(node.Location, operandType(0), expr.name(node.Data));
+            break;
+        default:
+            node.ReturnType = ElementaryType::Unspecified;
+            break;
+        }
     }
+
+    return expr.returnType();
+}
+
+ElementaryType TypeChecker::handleNode(VariableExpression* expr)
+{
+    expr->mDefinition = checkVariable(expr->location(), expr->name());
+    expr->setReturnType(expr->mDefinition.has_value() ? expr->mDefinition.value().type() : ElementaryType::Unspecified);
+    return expr->returnType();
+}
+
+ElementaryType TypeChecker::handleNode(LiteralExpression* expr)
+{
+    return expr->returnType();
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<LiteralExpression>& expr)
+ElementaryType TypeChecker::handleNode(UnaryExpression* expr)
 {
+    auto innerType = handle(expr->inner());
+    if (innerType == ElementaryType::Unspecified)
+        return innerType; // Error was caught somewhere else
+
+    expr->setReturnType(checkUnary(expr->location(), expr->op(), innerType));
+    return expr->returnType();
+}
+
+ElementaryType TypeChecker::handleNode(BinaryExpression* expr)
+{
+    auto leftType  = handle(expr->left());
+    auto rightType = handle(expr->right());
+    if (leftType == ElementaryType::Unspecified || rightType == ElementaryType::Unspecified)
+        return ElementaryType::Unspecified; // Error was caught somewhere else
+
+    expr->setReturnType(checkBinary(expr->location(), expr->op(), leftType, rightType));
+    return expr->returnType();
+}
+
+ElementaryType TypeChecker::handleNode(CallExpression* expr)
+{
+    std::vector<ElementaryType> fromArgs;
+    fromArgs.reserve(expr->parameters().size());
+
+    for (size_t i = 0; i < expr->parameters().size(); ++i) {
+        auto type = handle(expr->parameters().at(i));
+        if (type == ElementaryType::Unspecified)
+            return ElementaryType::Unspecified; // Error was caught somewhere else
+        fromArgs.push_back(type);
+    }
+
+    expr->mDefinition = checkCall(expr->location(), expr->name(), fromArgs);
+    expr->setReturnType(expr->mDefinition.has_value() ? expr->mDefinition.value().returnType() : ElementaryType::Unspecified);
     return expr->returnType();
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<UnaryExpression>& expr)
+ElementaryType TypeChecker::handleNode(AccessExpression* expr)
 {
     auto innerType = handle(expr->inner());
     if (innerType == ElementaryType::Unspecified)
         return innerType; // Error was caught somewhere else
 
-    expr->setReturnType(ElementaryType::Unspecified);
+    expr->setReturnType(checkAccess(expr->location(), innerType, expr->swizzle()));
+    return expr->returnType();
+}
+
+std::optional<VariableDef> TypeChecker::checkVariable(const Location& loc, const std::string& name)
+{
+    auto def = mDefinitions.lookupVariable(loc, name);
+    if (!def.has_value())
+        mReporter.error(loc) << "Unknown identifier '" << name << "' found";
+    return def;
+}
 
-    switch (expr->op()) {
+ElementaryType TypeChecker::checkUnary(const Location& loc, UnaryOperation op, ElementaryType innerType)
+{
+    ElementaryType returnType = ElementaryType::Unspecified;
+
+    switch (op) {
     case UnaryOperation::Pos:
     case UnaryOperation::Neg:
         if (isArithmetic(innerType))
-            expr->setReturnType(innerType);
+            returnType = innerType;
         break;
     case UnaryOperation::Not:
         if (isConvertible(innerType, ElementaryType::Boolean))
-            expr->setReturnType(ElementaryType::Boolean);
+            returnType = ElementaryType::Boolean;
         break;
     default:
         break;
     }
 
-    if (expr->isUnspecified())
-        typeError(expr, innerType);
+    if (returnType == ElementaryType::Unspecified)
+        typeError(mReporter, loc, op, innerType);
 
-    return expr->returnType();
+    return returnType;
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<BinaryExpression>& expr)
+ElementaryType TypeChecker::checkBinary(const Location& loc, BinaryOperation op, ElementaryType leftType, ElementaryType rightType)
 {
-    auto leftType  = handle(expr->left());
-    auto rightType = handle(expr->right());
-    if (leftType == ElementaryType::Unspecified || rightType == ElementaryType::Unspecified)
-        return rightType; // Error was caught somewhere else
+    ElementaryType returnType = ElementaryType::Unspecified;
 
-    expr->setReturnType(ElementaryType::Unspecified);
-
-    switch (expr->op()) {
+    switch (op) {
     case BinaryOperation::Add:
     case BinaryOperation::Sub:
         if (isArithmetic(leftType) && isArithmetic(rightType)) {
             if (leftType == rightType)
-                expr->setReturnType(leftType);
+                returnType = leftType;
             else if (isConvertible(leftType, rightType))
-                expr->setReturnType(rightType);
+                returnType = rightType;
             else if (isConvertible(rightType, leftType))
-                expr->setReturnType(leftType);
+                returnType = leftType;
         }
         break;
     case BinaryOperation::Mul:
     case BinaryOperation::Div:
         if (isArithmetic(leftType) && isArithmetic(rightType)) {
             if (leftType == rightType)
-                expr->setReturnType(leftType);
+                returnType = leftType;
             else if (isConvertible(leftType, rightType))
-                expr->setReturnType(rightType);
+                returnType = rightType;
             else if (isConvertible(rightType, leftType))
-                expr->setReturnType(leftType);
+                returnType = leftType;
             else if (isArray(leftType) && isConvertible(rightType, ElementaryType::Number))
-                expr->setReturnType(leftType); // vec * f, vec / f
-            else if (expr->op() != BinaryOperation::Div && isArray(rightType) && isConvertible(leftType, ElementaryType::Number))
-                expr->setReturnType(rightType); // f * vec
+                returnType = leftType; // vec * f, vec / f
+            else if (op != BinaryOperation::Div && isArray(rightType) && isConvertible(leftType, ElementaryType::Number))
+                returnType = rightType; // f * vec
         }
         break;
     case BinaryOperation::Pow:
         if (isArithmetic(leftType) && isArithmetic(rightType)) {
             if (leftType == rightType && leftType == ElementaryType::Integer)
-                expr->setReturnType(leftType); // i ^ i
+                returnType = leftType; // i ^ i
             else if (isConvertible(leftType, ElementaryType::Number) && isConvertible(rightType, ElementaryType::Number))
-                expr->setReturnType(ElementaryType::Number); // f ^ f
+                returnType = ElementaryType::Number; // f ^ f
             else if (isArray(leftType) && isConvertible(rightType, ElementaryType::Number))
-                expr->setReturnType(leftType); // vec ^ f
+                returnType = leftType; // vec ^ f
         }
         break;
     case BinaryOperation::Mod:
         if (isConvertible(leftType, ElementaryType::Integer) && isConvertible(rightType, ElementaryType::Integer))
-            expr->setReturnType(ElementaryType::Integer); // i % i
+            returnType = ElementaryType::Integer; // i % i
         break;
     case BinaryOperation::And:
     case BinaryOperation::Or:
         if (isConvertible(leftType, ElementaryType::Boolean) && isConvertible(rightType, ElementaryType::Boolean))
-            expr->setReturnType(ElementaryType::Boolean);
+            returnType = ElementaryType::Boolean;
         break;
     case BinaryOperation::Less:
     case BinaryOperation::Greater:
     case BinaryOperation::LessEqual:
     case BinaryOperation::GreaterEqual:
         if (isConvertible(leftType, ElementaryType::Boolean) && isConvertible(rightType, ElementaryType::Boolean))
-            expr->setReturnType(ElementaryType::Boolean);
+            returnType = ElementaryType::Boolean;
         else if (isConvertible(leftType, ElementaryType::Number) && isConvertible(rightType, ElementaryType::Number))
-            expr->setReturnType(ElementaryType::Boolean);
+            returnType = ElementaryType::Boolean;
         break;
     case BinaryOperation::Equal:
     case BinaryOperation::NotEqual:
         if (isConvertible(leftType, rightType) || isConvertible(rightType, leftType))
-            expr->setReturnType(ElementaryType::Boolean);
+            returnType = ElementaryType::Boolean;
         break;
     default:
         break;
     }
 
-    if (expr->isUnspecified())
-        typeError(expr, leftType, rightType);
+    if (returnType == ElementaryType::Unspecified)
+        typeError(mReporter, loc, op, leftType, rightType);
 
-    return expr->returnType();
+    return returnType;
 }
 
 inline std::string printArgs(const std::vector<ElementaryType>& args)
@@ -178,84 +287,57 @@ inline std::string printArgs(const std::vector<ElementaryType>& args)
     return stream.str();
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<CallExpression>& expr)
+std::optional<FunctionDef> TypeChecker::checkCall(const Location& loc, const std::string& name, const std::vector<ElementaryType>& fromArgs)
 {
-    std::vector<ElementaryType> fromArgs;
-    fromArgs.reserve(expr->parameters().size());
-
-    for (size_t i = 0; i < expr->parameters().size(); ++i) {
-        auto type = handle(expr->parameters().at(i));
-        if (type == ElementaryType::Unspecified)
-            return ElementaryType::Unspecified; // Error was caught somewhere else
-        fromArgs.push_back(type);
-    }
-
-    expr->setReturnType(ElementaryType::Unspecified);
-
-    auto def = mDefinitions.lookupFunction(expr->location(), expr->name(), fromArgs);
-    if (def.has_value())
-        expr->setReturnType(def.value().returnType());
-    else
-        PEXPR_LOG(LogLevel::Error) << expr->location() << ": Function '" << expr->name() << "(" << printArgs(fromArgs) << ")' is unknown or ambigous" << std::endl;
-
-    return expr->returnType();
+    auto def = mDefinitions.lookupFunction(loc, name, fromArgs);
+    if (!def.has_value())
+        mReporter.error(loc) << "Function '" << name << "(" << printArgs(fromArgs) << ")' is unknown or ambigous";
+    return def;
 }
 
-ElementaryType TypeChecker::handleNode(const Ptr<AccessExpression>& expr)
+ElementaryType TypeChecker::checkAccess(const Location& loc, ElementaryType innerType, const std::string& swizzle)
 {
-    auto innerType = handle(expr->inner());
-    if (innerType == ElementaryType::Unspecified)
-        return innerType; // Error was caught somewhere else
-
-    expr->setReturnType(ElementaryType::Unspecified);
-
     // The access operator also allows expanding e.g., vec2.xyxy -> vec4 operations
-    if (isArray(innerType)) {
-        const auto& swizzle = expr->swizzle();
-
-        size_t vec_size = 2;
-        if (innerType == ElementaryType::Vec3)
-            vec_size = 3;
-        if (innerType == ElementaryType::Vec4)
-            vec_size = 4;
-
-        bool isValid = true;
-        for (char c : swizzle) {
-            isValid = (c == 'x' || c == 'r'
-                       || c == 'y' || c == 'g'
-                       || (vec_size > 2 && c == 'z') || (vec_size > 2 && c == 'b')
-                       || (vec_size > 3 && c == 'w') || (vec_size > 3 && c == 'a'));
-
-            if (!isValid)
-                break;
-        }
+    if (!isArray(innerType)) {
+        mReporter.error(loc) << "Access operator is only defined for vector types";
+        return ElementaryType::Unspecified;
+    }
 
-        PEXPR_ASSERT(swizzle.size() > 0, "Expected at least a single component");
-        if (!isValid) {
-            PEXPR_LOG(LogLevel::Error) << expr->location() << ": Invalid access components '" << swizzle << "' given" << std::endl;
-        } else {
-            switch (swizzle.size()) {
-            case 1:
-                expr->setReturnType(ElementaryType::Number);
-                break;
-            case 2:
-                expr->setReturnType(ElementaryType::Vec2);
-                break;
-            case 3:
-                expr->setReturnType(ElementaryType::Vec3);
-                break;
-            case 4:
-                expr->setReturnType(ElementaryType::Vec4);
-                break;
-            default:
-                PEXPR_LOG(LogLevel::Error) << expr->location() << ": Expected a maximum of 4 components but got " << swizzle.size() << std::endl;
-                break;
-            }
-        }
-    } else {
-        PEXPR_LOG(LogLevel::Error) << expr->location() << ": Access operator is only defined for vector types" << std::endl;
+    size_t vec_size = 2;
+    if (innerType == ElementaryType::Vec3)
+        vec_size = 3;
+    if (innerType == ElementaryType::Vec4)
+        vec_size = 4;
+
+    bool isValid = true;
+    for (char c : swizzle) {
+        isValid = (c == 'x' || c == 'r'
+                   || c == 'y' || c == 'g'
+                   || (vec_size > 2 && c == 'z') || (vec_size > 2 && c == 'b')
+                   || (vec_size > 3 && c == 'w') || (vec_size > 3 && c == 'a'));
+
+        if (!isValid)
+            break;
     }
 
-    return expr->returnType();
+    PEXPR_ASSERT(swizzle.size() > 0, "Expected at least a single component");
+    if (!isValid) {
+        mReporter.error(loc) << "Invalid access components '" << swizzle << "' given";
+        return ElementaryType::Unspecified;
+    }
+
+    switch (swizzle.size()) {
+    case 1:
+        return ElementaryType::Number;
+    case 2:
+        return ElementaryType::Vec2;
+    case 3:
+        return ElementaryType::Vec3;
+    case 4:
+        return ElementaryType::Vec4;
+    default:
+        mReporter.error(loc) << "Expected a maximum of 4 components but got " << swizzle.size();
+        return ElementaryType::Unspecified;
+    }
 }
-} // namespace PExpr::internal
\ No newline at end of file
+} // namespace PExpr::internal
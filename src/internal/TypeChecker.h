@@ -1,23 +1,39 @@
 #pragma once
 
-#include "DefContainer.h"
 #include "../Expression.h"
+#include "../FlatExpression.h"
+#include "DefContainer.h"
+#include "Reporter.h"
 
 namespace PExpr::internal {
 class TypeChecker {
 public:
-    explicit TypeChecker(const DefContainer& defs);
+    /// Type checker reporting diagnostics to the given sink or, if none is given, to the global logger.
+    explicit TypeChecker(const DefContainer& defs, DiagnosticSink* diagnostics = nullptr);
 
     ElementaryType handle(const Ptr<Expression>& expr);
 
+    /// Sequential type checking of a flat expression. Returns the type of the root node.
+    ElementaryType handle(FlatExpression& expr);
+
+    // Rules shared by the tree, the flat representation and the deserializer. Errors are reported and result in an unspecified type
+    ElementaryType checkUnary(const Location& loc, UnaryOperation op, ElementaryType innerType);
+    ElementaryType checkBinary(const Location& loc, BinaryOperation op, ElementaryType leftType, ElementaryType rightType);
+    ElementaryType checkAccess(const Location& loc, ElementaryType innerType, const std::string& swizzle);
+
 private:
-    ElementaryType handleNode(const Ptr<VariableExpression>& expr);
-    ElementaryType handleNode(const Ptr<LiteralExpression>& expr);
-    ElementaryType handleNode(const Ptr<UnaryExpression>& expr);
-    ElementaryType handleNode(const Ptr<BinaryExpression>& expr);
-    ElementaryType handleNode(const Ptr<CallExpression>& expr);
-    ElementaryType handleNode(const Ptr<AccessExpression>& expr);
+    ElementaryType handleNode(VariableExpression* expr);
+    ElementaryType handleNode(LiteralExpression* expr);
+    ElementaryType handleNode(UnaryExpression* expr);
+    ElementaryType handleNode(BinaryExpression* expr);
+    ElementaryType handleNode(CallExpression* expr);
+    ElementaryType handleNode(AccessExpression* expr);
+
+    // Lookups shared by the tree and the flat representation
+    std::optional<VariableDef> checkVariable(const Location& loc, const std::string& name);
+    std::optional<FunctionDef> checkCall(const Location& loc, const std::string& name, const std::vector<ElementaryType>& fromArgs);
 
     const DefContainer& mDefinitions;
+    Reporter mReporter;
 };
-} // namespace PExpr
\ No newline at end of file
+} // namespace PExpr
@@ -0,0 +1,75 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+int main(int, char**)
+{
+    Environment env;
+    auto arena = std::make_shared<ExpressionArena>();
+
+    const std::string src = "abc(231*22.231*2.42e-3).xyz*Pi-123*(K.x+sin(22^4, 1-2%2, --1))";
+
+    auto ast1 = env.parse(src, arena, true);
+    auto ast2 = env.parse(src, arena, true);
+    if (!ast1 || !ast2)
+        return EXIT_FAILURE;
+
+    // Both trees should fit into the same block
+    if (arena->blockCount() != 1 || arena->usedBytes() == 0)
+        return EXIT_FAILURE;
+
+    auto heapAst = env.parse(src, true);
+    if (!heapAst)
+        return EXIT_FAILURE;
+
+    // The arena has to stay alive as long as an expression references it
+    std::weak_ptr<ExpressionArena> weakArena = arena;
+    arena.reset();
+    if (weakArena.expired())
+        return EXIT_FAILURE;
+
+    const std::string str1 = StringVisitor::visit(ast1);
+    if (str1 != StringVisitor::visit(heapAst))
+        return EXIT_FAILURE;
+
+    // Nodes have no control block of their own, the trees share the one of the arena
+    const auto& left = static_cast<const BinaryExpression*>(ast1.get())->left();
+    if (left.use_count() != 0 || ast1.use_count() != weakArena.use_count())
+        return EXIT_FAILURE;
+
+    // Optimized trees reuse subtrees and keep the arena alive as well
+    auto typedArena = std::make_shared<ExpressionArena>();
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    auto optimized = env.optimize(env.parse("x * 1 + (x + 2) * 3", typedArena));
+    std::weak_ptr<ExpressionArena> weakTypedArena = typedArena;
+    typedArena.reset();
+    if (!optimized || weakTypedArena.expired() || StringVisitor::visit(optimized) != "(x)+(((x)+(2))*(3))")
+        return EXIT_FAILURE;
+    optimized.reset();
+    if (!weakTypedArena.expired())
+        return EXIT_FAILURE;
+
+    ast1.reset();
+    ast2.reset();
+    if (!weakArena.expired())
+        return EXIT_FAILURE;
+
+    // Objects are destroyed together with the arena in a single step
+    struct Counted {
+        explicit Counted(size_t& counter)
+            : Counter(counter)
+        {
+        }
+        ~Counted() { ++Counter; }
+        size_t& Counter;
+    };
+
+    size_t destroyed = 0;
+    {
+        ExpressionArena objects;
+        for (int i = 0; i < 100; ++i)
+            objects.create<Counted>(destroyed);
+        if (destroyed != 0)
+            return EXIT_FAILURE;
+    }
+    return destroyed == 100 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,59 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("Pi", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerFunction(FunctionDef("sin", ElementaryType::Number, { ElementaryType::Number }));
+
+    // Mix of small, large and invalid sources
+    std::string large = "Pi";
+    for (int i = 0; i < 2000; ++i)
+        large = "sin(" + large + ") + " + std::to_string(i);
+
+    std::vector<std::string> storage;
+    for (int i = 0; i < 200; ++i) {
+        if (i % 50 == 0)
+            storage.push_back(large);
+        else if (i % 7 == 0)
+            storage.push_back("sin(uv) + " + std::to_string(i));
+        else
+            storage.push_back("uv.yx * (" + std::to_string(i) + " + sin(Pi))");
+    }
+    std::vector<std::string_view> sources(storage.begin(), storage.end());
+
+    ThreadPool pool(4);
+    BatchParseOptions options;
+    options.Pool = &pool;
+
+    for (int run = 0; run < 2; ++run) {
+        const auto results = env.parseBatch(sources, options);
+        if (results.size() != sources.size())
+            return EXIT_FAILURE;
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const auto& result = results[i];
+            const bool invalid = i % 50 != 0 && i % 7 == 0;
+            if ((result.Expression == nullptr) != invalid || result.Diagnostics.hasError() != invalid)
+                return EXIT_FAILURE;
+
+            if (!invalid && StringVisitor::visit(result.Expression) != StringVisitor::visit(env.parse(sources[i])))
+                return EXIT_FAILURE;
+        }
+    }
+
+    // Each range is handled exactly once
+    std::vector<int> counter(1000, 0);
+    pool.parallelFor(counter.size(), 3, [&](size_t begin, size_t end, size_t thread) {
+        if (thread >= pool.threadCount())
+            return;
+        for (size_t i = begin; i < end; ++i)
+            ++counter[i];
+    });
+    if (std::any_of(counter.begin(), counter.end(), [](int c) { return c != 1; }))
+        return EXIT_FAILURE;
+
+    return env.parseBatch(nullptr, 0).empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
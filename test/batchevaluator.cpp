@@ -0,0 +1,188 @@
+#include "PExpr.h"
+
+#include <random>
+
+using namespace PExpr;
+
+static NativeFunction resolveNative(const FunctionDef& def)
+{
+    if (def.name() == "sin")
+        return [](const Cell* args, Cell* result) { result[0].Num = std::sin(args[0].Num); };
+    if (def.name() == "vec3")
+        return [](const Cell* args, Cell* result) {
+            for (int i = 0; i < 3; ++i)
+                result[i].Num = args[i].Num;
+        };
+    return {};
+}
+
+static BatchNativeFunction resolveBatchNative(const FunctionDef& def)
+{
+    if (def.name() == "sin")
+        return [](const Cell* args, Cell* result, size_t count, size_t) {
+            for (size_t i = 0; i < count; ++i)
+                result[i].Num = std::sin(args[i].Num);
+        };
+    return {};
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("n", ElementaryType::Integer));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerVariable(VariableDef("s", ElementaryType::String));
+    env.registerFunction(FunctionDef("sin", ElementaryType::Number, { ElementaryType::Number }));
+    env.registerFunction(FunctionDef("vec3", ElementaryType::Vec3, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }));
+
+    constexpr size_t Count = 1000;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<Number> dist(-4, 4);
+
+    std::vector<Number> x(Count), u(Count), v(Count);
+    std::vector<Integer> n(Count);
+    for (size_t i = 0; i < Count; ++i) {
+        x[i] = dist(rng);
+        u[i] = dist(rng);
+        v[i] = dist(rng);
+        n[i] = (Integer)i % 7 - 3;
+    }
+
+    const std::vector<std::string> sources = {
+        "(vec3(x, uv.y, sin(x)) * 2 - vec3(1, 2, n)).zxy / -x",
+        "x * uv + uv.yx ^ 2",
+        "sin(x) * (uv / (n + 4)).x + n",
+        "(uv * x).yx == uv.yx * x || x > 1",
+    };
+
+    ThreadPool pool(4);
+    for (const auto& source : sources) {
+        auto expr = env.parse(source);
+        if (!expr)
+            return EXIT_FAILURE;
+
+        Ptr<const Program> program = env.compile(expr, resolveNative);
+        if (!program)
+            return EXIT_FAILURE;
+
+        const size_t xi     = program->variableIndex("x");
+        const size_t ni     = program->variableIndex("n");
+        const size_t uvi    = program->variableIndex("uv");
+        const size_t lanes  = typeArraySize(program->resultType());
+        const bool isNumber = program->resultType() != ElementaryType::Boolean;
+
+        // Reference computed record by record
+        VirtualMachine vm(program);
+        std::vector<Number> expected(Count * lanes);
+        std::vector<bool> expectedBool(Count);
+        for (size_t i = 0; i < Count; ++i) {
+            if (xi != Program::InvalidIndex)
+                vm.setNumber(xi, x[i]);
+            if (ni != Program::InvalidIndex)
+                vm.setInteger(ni, n[i]);
+            if (uvi != Program::InvalidIndex)
+                vm.setVec2(uvi, Vec2{ u[i], v[i] });
+            vm.run();
+            for (size_t l = 0; l < lanes; ++l)
+                expected[l * Count + i] = vm.result()[l].Num;
+            expectedBool[i] = vm.result()[0].Bool;
+        }
+
+        for (auto level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            for (bool useBatchNatives : { false, true }) {
+                BatchEvaluator evaluator(program, useBatchNatives ? BatchNativeResolver(resolveBatchNative) : BatchNativeResolver(), level);
+                if (xi != Program::InvalidIndex)
+                    evaluator.bindInput(xi, 0, x.data());
+                if (ni != Program::InvalidIndex)
+                    evaluator.bindInput(ni, n.data());
+                if (uvi != Program::InvalidIndex) {
+                    evaluator.bindInput(uvi, 0, u.data());
+                    evaluator.bindInput(uvi, 1, v.data());
+                }
+
+                std::vector<Number> output(Count * lanes, 0);
+                std::unique_ptr<bool[]> outputBool(new bool[Count]);
+                if (isNumber) {
+                    for (size_t l = 0; l < lanes; ++l)
+                        evaluator.bindOutput(l, output.data() + l * Count);
+                } else {
+                    evaluator.bindOutput(outputBool.get());
+                }
+
+                const auto check = [&]() {
+                    for (size_t i = 0; i < Count; ++i) {
+                        if (!isNumber && outputBool[i] != expectedBool[i])
+                            return false;
+                        for (size_t l = 0; isNumber && l < lanes; ++l) {
+                            if (output[l * Count + i] != expected[l * Count + i])
+                                return false;
+                        }
+                    }
+                    return true;
+                };
+
+                // Evaluate in two uneven parts
+                evaluator.evaluate(0, 100);
+                evaluator.evaluate(100, Count - 100);
+                if (!check())
+                    return EXIT_FAILURE;
+
+                // Evaluate in parallel with chunks not aligned to the block size
+                std::fill(output.begin(), output.end(), 0);
+                std::fill_n(outputBool.get(), Count, false);
+                evaluator.evaluateParallel(Count, pool, 100);
+                if (!check())
+                    return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // Integer overflow wraps around exactly like in the virtual machine
+    {
+        const std::vector<Integer> big = { std::numeric_limits<Integer>::max(), std::numeric_limits<Integer>::min(), 3037000500, -3, 0, 1, 7, 100 };
+        for (const char* source : { "-n * n + n - 1", "(n + 2) ^ (n % 70)", "3 ^ n + 1" }) {
+            Ptr<const Program> program = env.compile(env.parse(source), resolveNative);
+            if (!program)
+                return EXIT_FAILURE;
+
+            BatchEvaluator evaluator(program);
+            std::vector<Integer> output(big.size());
+            evaluator.bindInput(program->variableIndex("n"), big.data());
+            evaluator.bindOutput(output.data());
+            evaluator.evaluate(big.size());
+
+            VirtualMachine vm(program);
+            for (size_t i = 0; i < big.size(); ++i) {
+                vm.setInteger(program->variableIndex("n"), big[i]);
+                vm.run();
+                if (output[i] != vm.resultInteger()) {
+                    std::cout << source << " differs from the virtual machine for n = " << big[i] << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    // String columns are referenced by the registers
+    {
+        const std::vector<std::string> s = { "a", "b", "abc", "", "abc" };
+        Ptr<const Program> program = env.compile(env.parse("s == 'abc' || s != s"), resolveNative);
+        if (!program)
+            return EXIT_FAILURE;
+
+        BatchEvaluator evaluator(program);
+        std::unique_ptr<bool[]> output(new bool[s.size()]);
+        evaluator.bindInput(program->variableIndex("s"), s.data());
+        evaluator.bindOutput(output.get());
+        evaluator.evaluate(s.size());
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (output[i] != (s[i] == "abc")) {
+                std::cout << "String comparison failed for '" << s[i] << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
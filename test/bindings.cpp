@@ -0,0 +1,103 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+/// Evaluates scalar expressions with all variables fetched by slot
+class SlotVisitor : public TranspileVisitor<Number> {
+public:
+    explicit SlotVisitor(const Bindings& bindings)
+        : mBindings(bindings)
+    {
+    }
+
+    Number onVariable(const std::string&, ElementaryType) override
+    {
+        mFailed = true;
+        return 0;
+    }
+
+    Number onSlotVariable(const VariableDef& def, uint32 slot) override
+    {
+        if (def.type() == ElementaryType::Integer)
+            return (Number)mBindings.getInteger(slot);
+        return mBindings.getNumber(slot);
+    }
+
+    Number onInteger(Integer v) override { return (Number)v; }
+    Number onNumber(Number v) override { return v; }
+    Number onBool(bool v) override { return v ? 1 : 0; }
+    Number onString(const std::string&) override { return 0; }
+    Number onCast(const Number& v, ElementaryType, ElementaryType) override { return v; }
+    Number onPosNeg(bool isNeg, ElementaryType, const Number& v) override { return isNeg ? -v : v; }
+    Number onNot(const Number& v) override { return v == 0 ? 1 : 0; }
+    Number onAddSub(bool isSub, ElementaryType, const Number& a, const Number& b) override { return isSub ? a - b : a + b; }
+    Number onMulDiv(bool isDiv, ElementaryType, const Number& a, const Number& b) override { return isDiv ? a / b : a * b; }
+    Number onScale(bool isDiv, ElementaryType, const Number& a, const Number& f) override { return isDiv ? a / f : a * f; }
+    Number onPow(ElementaryType, const Number& a, const Number& f) override { return std::pow(a, f); }
+    Number onMod(const Number& a, const Number& b) override { return std::fmod(a, b); }
+    Number onAndOr(bool, const Number&, const Number&) override { return 0; }
+    Number onRelOp(RelationalOp, ElementaryType, const Number&, const Number&) override { return 0; }
+    Number onEqual(bool, ElementaryType, const Number&, const Number&) override { return 0; }
+    Number onFunctionCall(const std::string&, ElementaryType, const std::vector<ElementaryType>&, const std::vector<Number>&) override { return 0; }
+    Number onAccess(const Number& v, size_t, const std::vector<uint8>&) override { return v; }
+
+    bool mFailed = false;
+
+private:
+    const Bindings& mBindings;
+};
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("t", ElementaryType::Number));
+    env.registerVariable(VariableDef("n", ElementaryType::Integer));
+    env.registerVariable(VariableDef("v", ElementaryType::Vec3));
+
+    auto layout = std::make_shared<VariableLayout>();
+
+    // Variables are shared between expressions
+    auto expr1 = env.parse("t * 2 + n");
+    auto expr2 = env.parse("n - t / 4");
+    if (!layout->assign(expr1) || !layout->assign(expr2))
+        return EXIT_FAILURE;
+
+    if (layout->size() != 2 || layout->slot("t") != 0 || layout->slot("n") != 1 || layout->slot("v") != VariableLayout::InvalidSlot)
+        return EXIT_FAILURE;
+
+    // Vector types occupy multiple cells
+    const uint32 vSlot = layout->add(VariableDef("v", ElementaryType::Vec3));
+    if (vSlot != 2 || layout->cellOffset(vSlot) != 2 || layout->cellCount() != 5)
+        return EXIT_FAILURE;
+
+    // Conflicting types are rejected
+    if (layout->add(VariableDef("t", ElementaryType::Integer)) != VariableLayout::InvalidSlot)
+        return EXIT_FAILURE;
+
+    // Not type checked expressions can not be assigned
+    if (layout->assign(env.parse("t", true)))
+        return EXIT_FAILURE;
+
+    FlatExpression flat(env.parse("(t + 1) * n"));
+    if (!layout->assign(flat) || flat.variableSlot(flat.nodes()[0]) != layout->slot("t"))
+        return EXIT_FAILURE;
+
+    Bindings bindings(layout);
+    bindings.setVec3(vSlot, Vec3{ 1, 2, 3 });
+    if (bindings.getVec3(vSlot) != Vec3{ 1, 2, 3 })
+        return EXIT_FAILURE;
+
+    SlotVisitor visitor(bindings);
+    for (int frame = 0; frame < 10; ++frame) {
+        const Number t = frame * 0.25;
+        bindings.setNumber(layout->slot("t"), t);
+        bindings.setInteger(layout->slot("n"), frame);
+
+        if (env.transpile(expr1, &visitor) != t * 2 + frame
+            || env.transpile(expr2, &visitor) != frame - t / 4
+            || env.transpile(flat, &visitor) != (t + 1) * frame)
+            return EXIT_FAILURE;
+    }
+
+    return visitor.mFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
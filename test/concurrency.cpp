@@ -0,0 +1,73 @@
+#include "PExpr.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace PExpr;
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("Pi", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerFunction(FunctionDef("sin", ElementaryType::Number, { ElementaryType::Number }));
+    env.registerFunctionLookupFunction([](const FunctionLookup& lkp) -> std::optional<FunctionDef> {
+        if (lkp.name() == "noise" && lkp.matchParameter({ ElementaryType::Vec2 }))
+            return FunctionDef(lkp.name(), ElementaryType::Number, { ElementaryType::Vec2 });
+        return {};
+    });
+    env.enableFunctionCache();
+
+    const std::vector<std::string> sources = {
+        "sin(Pi) * noise(uv)",
+        "noise(uv * 2) + noise(uv.yx)",
+        "sin(unknown)",
+        "uv + ",
+        "noise(Pi)",
+        "\"abc\" \"def\"",
+    };
+
+    // Serial reference
+    std::vector<std::string> expected;
+    std::vector<size_t> expectedDiagnostics;
+    for (const auto& src : sources) {
+        DiagnosticList diagnostics;
+        ParseOptions options;
+        options.Diagnostics = &diagnostics;
+
+        auto expr = env.parse(src, options);
+        expected.push_back(expr ? StringVisitor::visit(expr) : std::string());
+        expectedDiagnostics.push_back(diagnostics.entries().size());
+
+        if ((bool)expr == diagnostics.hasError())
+            return EXIT_FAILURE;
+    }
+
+    constexpr size_t ThreadCount = 4;
+    constexpr size_t Iterations  = 50;
+
+    std::atomic<size_t> failures = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < ThreadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < Iterations; ++i) {
+                const size_t k = (i + t) % sources.size();
+
+                DiagnosticList diagnostics;
+                ParseOptions options;
+                options.Diagnostics = &diagnostics;
+                if (i % 2 == 0)
+                    options.Arena = std::make_shared<ExpressionArena>();
+
+                auto expr = env.parse(sources[k], options);
+                if ((expr ? StringVisitor::visit(expr) : std::string()) != expected[k]
+                    || diagnostics.entries().size() != expectedDiagnostics[k])
+                    ++failures;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+/// Emits each temporary as a local and references it by name afterwards
+class LocalVisitor : public TranspileVisitor<std::string> {
+public:
+    std::string onVariable(const std::string& name, ElementaryType) override { return name; }
+    std::string onInteger(Integer v) override { return std::to_string(v); }
+    std::string onNumber(Number v) override { return std::to_string(v); }
+    std::string onBool(bool v) override { return v ? "true" : "false"; }
+    std::string onString(const std::string& v) override { return "'" + v + "'"; }
+    std::string onCast(const std::string& v, ElementaryType, ElementaryType) override { return "num(" + v + ")"; }
+    std::string onPosNeg(bool isNeg, ElementaryType, const std::string& v) override { return isNeg ? "-" + v : v; }
+    std::string onNot(const std::string& v) override { return "!" + v; }
+    std::string onAddSub(bool isSub, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + (isSub ? "-" : "+") + b + ")"; }
+    std::string onMulDiv(bool isDiv, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + (isDiv ? "/" : "*") + b + ")"; }
+    std::string onScale(bool isDiv, ElementaryType, const std::string& a, const std::string& f) override { return "(" + a + (isDiv ? "/" : "*") + f + ")"; }
+    std::string onPow(ElementaryType, const std::string& a, const std::string& f) override { return "pow(" + a + "," + f + ")"; }
+    std::string onMod(const std::string& a, const std::string& b) override { return "(" + a + "%" + b + ")"; }
+    std::string onAndOr(bool isOr, const std::string& a, const std::string& b) override { return "(" + a + (isOr ? "||" : "&&") + b + ")"; }
+    std::string onRelOp(RelationalOp, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + "<" + b + ")"; }
+    std::string onEqual(bool, ElementaryType, const std::string& a, const std::string& b) override { return "(" + a + "==" + b + ")"; }
+
+    std::string onFunctionCall(const std::string& name, ElementaryType, const std::vector<ElementaryType>&, const std::vector<std::string>& args) override
+    {
+        std::string str = name + "(";
+        for (size_t i = 0; i < args.size(); ++i)
+            str += (i > 0 ? "," : "") + args[i];
+        return str + ")";
+    }
+
+    std::string onAccess(const std::string& v, size_t, const std::vector<uint8>& permutation) override
+    {
+        std::string str = v + ".";
+        for (uint8 c : permutation)
+            str += "xyzw"[c];
+        return str;
+    }
+
+    std::string onTemporary(uint32 id, ElementaryType, const std::string& value) override
+    {
+        const std::string name = "t" + std::to_string(id);
+        Locals += name + "=" + value + ";";
+        return name;
+    }
+
+    std::string Locals;
+};
+
+static bool check(const Environment& env, const std::string& src, const std::string& expectedLocals, const std::string& expected)
+{
+    LocalVisitor visitor;
+    TranspileOptions options;
+    options.EliminateCommonSubexpressions = true;
+
+    const std::string result = env.transpile(env.parse(src), &visitor, options);
+    if (visitor.Locals != expectedLocals || result != expected) {
+        std::cout << src << " transpiled to " << visitor.Locals << " " << result << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("n", ElementaryType::Integer));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerNative("mix", [](Number a, Number b, Number t) { return a + (b - a) * t; }, true);
+    env.registerNative("noise", [](Number v) { return v; });
+
+    if (!check(env, "sin(uv.x*10) + sin(uv.x*10) * sin(uv.x * 10)",
+               "t0=sin((uv.x*num(10)));",
+               "(t0+(t0*t0))"))
+        return EXIT_FAILURE;
+
+    // Nested subtrees only get their own temporary if used outside of the shared parent as well
+    if (!check(env, "mix(x*2, x*2, sin(x*2) + sin(x*2))",
+               "t0=(x*num(2));t1=sin(t0);",
+               "mix(t0,t0,(t1+t1))"))
+        return EXIT_FAILURE;
+
+    // Impure calls are evaluated for each occurrence, but their pure arguments are still shared
+    if (!check(env, "noise(x+1) + noise(x+1)",
+               "t0=(x+num(1));",
+               "(noise(t0)+noise(t0))"))
+        return EXIT_FAILURE;
+
+    // Variables and literals are not worth a temporary
+    if (!check(env, "x*x + 1 - 1", "", "(((x*x)+num(1))-num(1))"))
+        return EXIT_FAILURE;
+
+    // Integer divisions guarded by a short-circuit are evaluated in place, unguarded ones are still shared
+    if (!check(env, "n != 0 && 10/n > 1 || 10/n < 5", "", "(((n==0)&&((10/n)<1))||((10/n)<5))")
+        || !check(env, "10/n + 10/n > 1 && x > 0", "t0=(10/n);", "(((t0+t0)<1)&&(x<num(0)))")
+        || !check(env, "x > 0 && (x/2 > 1 || x/2 < 5)", "t0=(x/num(2));", "((x<num(0))&&((t0<num(1))||(t0<num(5))))"))
+        return EXIT_FAILURE;
+
+    // Evaluating the guarded expression with n = 0 does not trap
+    const auto program = env.compile(env.parse("n != 0 && 10/n > 1 || 10/n < 5"), NativeResolver());
+    if (!program)
+        return EXIT_FAILURE;
+    VirtualMachine vm(program);
+    vm.setInteger(program->variableIndex("n"), 0);
+    vm.run();
+    if (!vm.resultBool())
+        return EXIT_FAILURE;
+
+    // Disabled by default
+    LocalVisitor visitor;
+    if (env.transpile(env.parse("sin(x) + sin(x)"), &visitor) != "(sin(x)+sin(x))" || !visitor.Locals.empty())
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
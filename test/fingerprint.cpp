@@ -0,0 +1,65 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+static bool checkEqual(const Environment& env, const std::string& a, const std::string& b, bool expected)
+{
+    const bool equal = fingerprint(env.parse(a)) == fingerprint(env.parse(b));
+    if (equal != expected) {
+        std::cout << a << (expected ? " and " : " and not ") << b << " expected to be equal" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("y", ElementaryType::Number));
+    env.registerVariable(VariableDef("i", ElementaryType::Integer));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerNative("sin", [](Integer v) { return std::sin((Number)v); }, true);
+
+    if (!checkEqual(env, "sin(x*2)+uv.x", "  sin( x * 2 ) /* comment */ + uv.x", true))
+        return EXIT_FAILURE;
+    if (!checkEqual(env, "x+y", "y+x", false))
+        return EXIT_FAILURE;
+    if (!checkEqual(env, "x-y", "x+y", false))
+        return EXIT_FAILURE;
+    if (!checkEqual(env, "uv.x", "uv.y", false))
+        return EXIT_FAILURE;
+    if (!checkEqual(env, "x*2", "x*2.0", false))
+        return EXIT_FAILURE;
+    if (!checkEqual(env, "'ab'", "'ba'", false))
+        return EXIT_FAILURE;
+    // Same structure but different overload and types
+    if (!checkEqual(env, "sin(x)", "sin(i)", false))
+        return EXIT_FAILURE;
+
+    // Interned trees result in the same fingerprint as plain ones
+    ParseOptions options;
+    options.Interner = std::make_shared<ExpressionInterner>();
+    const auto plain    = env.parse("sin(x*2) + sin(x*2)");
+    const auto interned = env.parse("sin(x*2) + sin(x*2)", options);
+    Fingerprinter fingerprinter;
+    if (fingerprinter.fingerprint(plain) != fingerprinter.fingerprint(interned)) {
+        std::cout << "Interned tree has a different fingerprint" << std::endl;
+        return EXIT_FAILURE;
+    }
+    // The plain tree has nine nodes, the interned one shares both calls and consists of five nodes only
+    if (fingerprinter.size() != 9 + 5) {
+        std::cout << "Unexpected number of remembered nodes " << fingerprinter.size() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Fingerprints are persisted and therefore have to stay stable
+    const std::string str = fingerprint(env.parse("sin(x*2) + uv.x")).toString();
+    if (str != "4892863b0714ca09d96af4da81ac898c") {
+        std::cout << "Fingerprint changed to " << str << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+// Simple visitor producing a prefix notation of the transpiled operations
+class DumpVisitor : public TranspileVisitor<std::string> {
+public:
+    std::string onVariable(const std::string& name, ElementaryType) override { return name; }
+    std::string onInteger(Integer v) override { return std::to_string(v); }
+    std::string onNumber(Number v) override { return std::to_string(v); }
+    std::string onBool(bool v) override { return v ? "true" : "false"; }
+    std::string onString(const std::string& v) override { return "'" + v + "'"; }
+    std::string onCast(const std::string& v, ElementaryType, ElementaryType) override { return "cast(" + v + ")"; }
+    std::string onPosNeg(bool isNeg, ElementaryType, const std::string& v) override { return (isNeg ? "neg(" : "pos(") + v + ")"; }
+    std::string onNot(const std::string& v) override { return "not(" + v + ")"; }
+    std::string onAddSub(bool isSub, ElementaryType, const std::string& a, const std::string& b) override { return (isSub ? "sub(" : "add(") + a + "," + b + ")"; }
+    std::string onMulDiv(bool isDiv, ElementaryType, const std::string& a, const std::string& b) override { return (isDiv ? "div(" : "mul(") + a + "," + b + ")"; }
+    std::string onScale(bool isDiv, ElementaryType, const std::string& a, const std::string& f) override { return (isDiv ? "sdiv(" : "smul(") + a + "," + f + ")"; }
+    std::string onPow(ElementaryType, const std::string& a, const std::string& f) override { return "pow(" + a + "," + f + ")"; }
+    std::string onMod(const std::string& a, const std::string& b) override { return "mod(" + a + "," + b + ")"; }
+    std::string onAndOr(bool isOr, const std::string& a, const std::string& b) override { return (isOr ? "or(" : "and(") + a + "," + b + ")"; }
+    std::string onRelOp(RelationalOp op, ElementaryType, const std::string& a, const std::string& b) override { return "rel" + std::to_string((int)op) + "(" + a + "," + b + ")"; }
+    std::string onEqual(bool isNeg, ElementaryType, const std::string& a, const std::string& b) override { return (isNeg ? "neq(" : "eq(") + a + "," + b + ")"; }
+    std::string onFunctionCall(const std::string& name, ElementaryType, const std::vector<ElementaryType>&, const std::vector<std::string>& args) override
+    {
+        std::string str = name + "(";
+        for (const auto& arg : args)
+            str += arg + ";";
+        return str + ")";
+    }
+    std::string onAccess(const std::string& v, size_t, const std::vector<uint8>& perm) override
+    {
+        std::string str = v + ".";
+        for (auto p : perm)
+            str += std::to_string(p);
+        return str;
+    }
+};
+
+static size_t sLookups = 0;
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariableLookupFunction([](const VariableLookup& lkp) -> std::optional<VariableDef> {
+        ++sLookups;
+        if (lkp.name() == "Pi")
+            return VariableDef(lkp.name(), ElementaryType::Number);
+        if (lkp.name() == "K")
+            return VariableDef(lkp.name(), ElementaryType::Vec3);
+        return {};
+    });
+    env.registerFunctionLookupFunction([](const FunctionLookup& lkp) -> std::optional<FunctionDef> {
+        ++sLookups;
+        if (lkp.name() == "abc" && lkp.matchParameter({ ElementaryType::Number }))
+            return FunctionDef(lkp.name(), ElementaryType::Vec4, { ElementaryType::Number });
+        if (lkp.name() == "sin" && lkp.matchParameter({ ElementaryType::Integer, ElementaryType::Number, ElementaryType::Integer }))
+            return FunctionDef(lkp.name(), ElementaryType::Number, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Integer });
+        return {};
+    });
+
+    const std::string src = "abc(231*22.231*2.42e-3).xyz*Pi-K*(K.x+sin(22^4, 1-2.0%2, --1)) == K.zyx";
+
+    auto ast = env.parse(src, true);
+    if (!ast)
+        return EXIT_FAILURE;
+
+    FlatExpression flat(ast);
+    if (flat.root().Type != ExpressionType::Binary || flat.returnType() != ElementaryType::Unspecified)
+        return EXIT_FAILURE;
+
+    // Invalid due to modulo with num
+    if (env.doTypeChecking(flat))
+        return EXIT_FAILURE;
+
+    ast = env.parse(src.substr(0, src.find("2.0")) + "2%2, --1)) == K.zyx", true);
+    if (!ast)
+        return EXIT_FAILURE;
+
+    flat = FlatExpression(ast);
+    if (!env.doTypeChecking(flat) || flat.returnType() != ElementaryType::Boolean)
+        return EXIT_FAILURE;
+
+    if (!env.doTypeChecking(ast))
+        return EXIT_FAILURE;
+
+    // Types of all nodes have to match the tree
+    FlatExpression typedFlat(ast);
+    for (size_t i = 0; i < flat.size(); ++i) {
+        if (flat.nodes()[i].ReturnType != typedFlat.nodes()[i].ReturnType)
+            return EXIT_FAILURE;
+    }
+
+    // Definitions resolved while type checking are used directly
+    const size_t lookups = sLookups;
+
+    DumpVisitor visitor;
+    const std::string treeOutput = env.transpile(ast, &visitor);
+    const std::string flatOutput = env.transpile(flat, &visitor);
+
+    if (lookups != sLookups)
+        return EXIT_FAILURE;
+
+    if (treeOutput != flatOutput) {
+        std::cout << "Tree: " << treeOutput << std::endl
+                  << "Flat: " << flatOutput << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include "PExpr.h"
+#include "internal/CommonSubexpressions.h"
+
+using namespace PExpr;
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("i", ElementaryType::Integer));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerNative("noise", [](Number v) { return v; });
+
+    auto interner = std::make_shared<ExpressionInterner>();
+    ParseOptions options;
+    options.Interner = interner;
+
+    // Identical sources result in the same node
+    const auto a = env.parse("sin(x*2) + uv.x", options);
+    const auto b = env.parse("sin(x * 2) + uv.x", options);
+    if (!a || a != b) {
+        std::cout << "Identical expressions were not merged" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Subtrees are shared between different expressions
+    const auto c = env.parse("sin(x*2) - 1", options);
+    const auto aLeft = std::static_pointer_cast<BinaryExpression>(a)->left();
+    const auto cLeft = std::static_pointer_cast<BinaryExpression>(c)->left();
+    if (aLeft != cLeft) {
+        std::cout << "Common subtree was not shared" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Same structure but different types are kept apart
+    const auto d = env.parse("i+1", options);
+    const auto e = env.parse("x+1", options);
+    if (d == e || std::static_pointer_cast<BinaryExpression>(d)->left() == std::static_pointer_cast<BinaryExpression>(e)->left()) {
+        std::cout << "Expressions of different type were merged" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Batches share the same pool
+    BatchParseOptions batchOptions;
+    batchOptions.ThreadCount = 2;
+    batchOptions.Interner    = interner;
+    const auto results       = env.parseBatch({ "x+1", "sin(x*2) + uv.x", "i+1" }, batchOptions);
+    if (results[0].Expression != e || results[1].Expression != a || results[2].Expression != d) {
+        std::cout << "Batch did not reuse the interned nodes" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const size_t size = interner->size();
+    env.parse("sin(x*2) + uv.x", options);
+    if (interner->size() != size || interner->usedBytes() == 0) {
+        std::cout << "Pool grew for known expression" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Shared calls with side effects are still evaluated for each occurrence
+    const auto f = env.parse("noise(x) + noise(x)", options);
+    if (internal::CommonSubexpressions(f).count() != 0) {
+        std::cout << "Impure call was merged" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto g = env.parse("sin(x) + sin(x)", options);
+    if (internal::CommonSubexpressions(g).count() != 1) {
+        std::cout << "Pure call was not merged" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -2,31 +2,72 @@
 
 using namespace PExpr;
 using namespace PExpr::internal;
-int main(int, char**)
+
+static bool checkTokens(Lexer& lexer)
 {
-    std::stringstream stream("abc(231*22.231*2.42e-3).xyz");
-    Lexer lexer(stream);
     if (lexer.next().Type != TokenType::Identifier)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::OpenParanthese)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Integer)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Mul)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Float)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Mul)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Float)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::ClosedParanthese)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Dot)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Identifier)
-        return EXIT_FAILURE;
+        return false;
     if (lexer.next().Type != TokenType::Eof)
+        return false;
+    return true;
+}
+
+static bool checkStrings(Lexer& lexer)
+{
+    auto token = lexer.next();
+    if (token.Type != TokenType::String || token.text() != "abc")
+        return false;
+    token = lexer.next();
+    if (token.Type != TokenType::String || token.text() != "a\tb")
+        return false;
+    token = lexer.next();
+    if (token.Type != TokenType::String || token.text() != "ab")
+        return false;
+    token = lexer.next();
+    if (token.Type != TokenType::Identifier || token.text() != "_x1")
+        return false;
+    return lexer.next().Type == TokenType::Eof;
+}
+
+int main(int, char**)
+{
+    const std::string input = "abc(231*22.231*2.42e-3).xyz";
+    std::stringstream stream(input);
+    Lexer streamLexer(stream);
+    if (!checkTokens(streamLexer))
+        return EXIT_FAILURE;
+
+    Lexer bufferLexer{ std::string_view(input) };
+    if (!checkTokens(bufferLexer))
+        return EXIT_FAILURE;
+
+    const std::string strings = "'abc' \"a\\tb\" 'a'  'b' _x1";
+    std::stringstream stringStream(strings);
+    Lexer stringStreamLexer(stringStream);
+    if (!checkStrings(stringStreamLexer))
         return EXIT_FAILURE;
+
+    Lexer stringBufferLexer{ std::string_view(strings) };
+    if (!checkStrings(stringBufferLexer))
+        return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
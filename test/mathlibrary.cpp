@@ -0,0 +1,127 @@
+#include "PExpr.h"
+
+#include <random>
+
+using namespace PExpr;
+
+// Distance in units in the last place between two doubles
+static double ulpDistance(double a, double b)
+{
+    if (std::isnan(a) || std::isnan(b))
+        return std::isnan(a) && std::isnan(b) ? 0 : std::numeric_limits<double>::infinity();
+    if (a == b)
+        return 0;
+    if (std::isinf(a) || std::isinf(b))
+        return std::numeric_limits<double>::infinity();
+    if (std::signbit(a) != std::signbit(b))
+        return ulpDistance(a, 0.0) + ulpDistance(0.0, b);
+
+    uint64 x, y;
+    a = std::abs(a);
+    b = std::abs(b);
+    std::memcpy(&x, &a, sizeof(x));
+    std::memcpy(&y, &b, sizeof(y));
+    return (double)(x > y ? x - y : y - x);
+}
+
+struct TestCase {
+    MathFunction Function;
+    Number (*Reference)(Number);
+    Number Min;
+    Number Max;
+    double MaxUlp;
+};
+
+int main(int, char**)
+{
+    // Keep in sync with the documentation in MathLibrary.h
+    const std::vector<TestCase> cases = {
+        { MathFunction::Sin, [](Number x) { return std::sin(x); }, -1e4, 1e4, 2 },
+        { MathFunction::Cos, [](Number x) { return std::cos(x); }, -1e4, 1e4, 1 },
+        { MathFunction::Tan, [](Number x) { return std::tan(x); }, -1e4, 1e4, 2 },
+        { MathFunction::ASin, [](Number x) { return std::asin(x); }, -1, 1, 1 },
+        { MathFunction::ACos, [](Number x) { return std::acos(x); }, -1, 1, 1 },
+        { MathFunction::ATan, [](Number x) { return std::atan(x); }, -1e3, 1e3, 1 },
+        { MathFunction::Exp, [](Number x) { return std::exp(x); }, -700, 700, 2 },
+        { MathFunction::Log, [](Number x) { return std::log(x); }, 1e-300, 1e300, 1 },
+    };
+
+    constexpr size_t Count = 100003; // Not a multiple of the vector width
+    std::mt19937_64 rng(1234);
+
+    bool failed = false;
+    for (const auto& test : cases) {
+        // Sample uniformly and logarithmically to cover small values as well
+        std::vector<Number> in(Count);
+        std::uniform_real_distribution<Number> dist(test.Min, test.Max);
+        std::uniform_real_distribution<Number> expDist(-20, std::log10(std::max(std::abs(test.Min), std::abs(test.Max))));
+        for (size_t i = 0; i < Count; ++i) {
+            if (i % 2 == 0) {
+                in[i] = dist(rng);
+            } else {
+                in[i] = std::pow(10.0, expDist(rng));
+                if (test.Min < 0 && i % 4 == 1)
+                    in[i] = -in[i];
+                in[i] = std::clamp(in[i], test.Min, test.Max);
+            }
+        }
+
+        double maxUlp = 0;
+        std::vector<Number> reference(Count);
+        for (size_t i = 0; i < Count; ++i) {
+            reference[i] = MathLibrary::evaluate(test.Function, in[i]);
+            maxUlp       = std::max(maxUlp, ulpDistance(reference[i], test.Reference(in[i])));
+        }
+
+        std::cout << MathLibrary::name(test.Function) << ": " << maxUlp << " ulp" << std::endl;
+        if (maxUlp > test.MaxUlp)
+            failed = true;
+
+        // All instruction sets have to match the scalar path exactly
+        for (auto level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            std::vector<Number> out(Count);
+            MathLibrary::evaluate(test.Function, in.data(), out.data(), Count, level);
+            if (std::memcmp(out.data(), reference.data(), Count * sizeof(Number)) != 0) {
+                std::cout << MathLibrary::name(test.Function) << ": Mismatch for simd level " << (int)level << std::endl;
+                failed = true;
+            }
+        }
+    }
+
+    // Special values
+    const Number inf = std::numeric_limits<Number>::infinity();
+    if (!std::isnan(MathLibrary::evaluate(MathFunction::Log, -1)) || MathLibrary::evaluate(MathFunction::Log, 0) != -inf
+        || MathLibrary::evaluate(MathFunction::Log, inf) != inf || MathLibrary::evaluate(MathFunction::Exp, 1000) != inf
+        || MathLibrary::evaluate(MathFunction::Exp, -1000) != 0 || !std::isnan(MathLibrary::evaluate(MathFunction::ASin, 2))
+        || !std::isnan(MathLibrary::evaluate(MathFunction::Sin, inf)) || MathLibrary::evaluate(MathFunction::Sin, 1e20) != std::sin(1e20)
+        || ulpDistance(MathLibrary::evaluate(MathFunction::Log, 1e-310), std::log(1e-310)) > 1)
+        failed = true;
+
+    // Integration with the environment and the evaluators
+    Environment env;
+    MathLibrary::registerFunctions(env);
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+
+    auto expr = env.parse("sin(uv) * exp(1)");
+    Ptr<const Program> program = expr ? env.compile(expr, MathLibrary::resolveNative) : nullptr;
+    if (!program)
+        return EXIT_FAILURE;
+
+    std::vector<Number> u = { 0.1, 0.2, 0.3 }, v = { 1, 2, 3 }, outU(3), outV(3);
+    BatchEvaluator evaluator(program, MathLibrary::resolveBatchNative);
+    evaluator.bindInput(program->variableIndex("uv"), 0, u.data());
+    evaluator.bindInput(program->variableIndex("uv"), 1, v.data());
+    evaluator.bindOutput(0, outU.data());
+    evaluator.bindOutput(1, outV.data());
+    evaluator.evaluate(3);
+
+    VirtualMachine vm(program);
+    for (size_t i = 0; i < 3; ++i) {
+        vm.setVec2(program->variableIndex("uv"), Vec2{ u[i], v[i] });
+        vm.run();
+        if (vm.resultVec2() != Vec2{ outU[i], outV[i] } || ulpDistance(outU[i], std::sin(u[i]) * std::exp(1)) > 2)
+            failed = true;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
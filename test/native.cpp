@@ -0,0 +1,128 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+static Number scale(Number x, Integer n) { return x * (Number)n; }
+static Vec3 cross(Vec3 a, Vec3 b) { return Vec3{ a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] }; }
+
+/// Calls bound natives by index only
+class IndexVisitor : public TranspileVisitor<Number> {
+public:
+    explicit IndexVisitor(const Environment& env)
+        : mEnv(env)
+    {
+    }
+
+    Number onVariable(const std::string&, ElementaryType) override { return 0; }
+    Number onInteger(Integer v) override { return (Number)v; }
+    Number onNumber(Number v) override { return v; }
+    Number onBool(bool v) override { return v ? 1 : 0; }
+    Number onString(const std::string&) override { return 0; }
+    Number onCast(const Number& v, ElementaryType, ElementaryType) override { return v; }
+    Number onPosNeg(bool isNeg, ElementaryType, const Number& v) override { return isNeg ? -v : v; }
+    Number onNot(const Number& v) override { return v == 0 ? 1 : 0; }
+    Number onAddSub(bool isSub, ElementaryType, const Number& a, const Number& b) override { return isSub ? a - b : a + b; }
+    Number onMulDiv(bool isDiv, ElementaryType, const Number& a, const Number& b) override { return isDiv ? a / b : a * b; }
+    Number onScale(bool isDiv, ElementaryType, const Number& a, const Number& f) override { return isDiv ? a / f : a * f; }
+    Number onPow(ElementaryType, const Number& a, const Number& f) override { return std::pow(a, f); }
+    Number onMod(const Number& a, const Number& b) override { return std::fmod(a, b); }
+    Number onAndOr(bool, const Number&, const Number&) override { return 0; }
+    Number onRelOp(RelationalOp, ElementaryType, const Number&, const Number&) override { return 0; }
+    Number onEqual(bool, ElementaryType, const Number&, const Number&) override { return 0; }
+    Number onAccess(const Number& v, size_t, const std::vector<uint8>&) override { return v; }
+
+    Number onFunctionCall(const std::string&, ElementaryType, const std::vector<ElementaryType>&, const std::vector<Number>&) override
+    {
+        mFailed = true;
+        return 0;
+    }
+
+    Number onResolvedCall(const FunctionDef& def, const std::vector<Number>& argumentPayloads) override
+    {
+        if (!def.hasNative() || def.returnType() != ElementaryType::Number) {
+            mFailed = true;
+            return 0;
+        }
+
+        std::vector<Cell> args(argumentPayloads.size());
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (def.parameters()[i] == ElementaryType::Integer)
+                args[i].Int = (Integer)argumentPayloads[i];
+            else
+                args[i].Num = argumentPayloads[i];
+        }
+
+        Cell result;
+        mEnv.native(def.nativeIndex())(args.data(), &result);
+        return result.Num;
+    }
+
+    bool mFailed = false;
+
+private:
+    const Environment& mEnv;
+};
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("a", ElementaryType::Vec3));
+    env.registerVariable(VariableDef("b", ElementaryType::Vec3));
+    env.registerVariable(VariableDef("s", ElementaryType::String));
+
+    env.registerNative("scale", &scale);
+    env.registerNative("cross", cross);
+    env.registerNative("sq", [](Number x) { return x * x; });
+    env.registerNative("sq", [](Integer x) { return x * x; });
+    env.registerNative("len", [](const std::string& s) { return (Integer)s.size(); });
+    env.registerNative("pick", [](bool c, Number a, Number b) { return c ? a : b; });
+
+    if (env.nativeCount() != 6)
+        return EXIT_FAILURE;
+
+    // Deduced signatures
+    const auto scaleDef = env.parse("scale(2, 3)");
+    if (!scaleDef || scaleDef->returnType() != ElementaryType::Number)
+        return EXIT_FAILURE;
+
+    const auto crossDef = env.parse("cross(a, b)");
+    if (!crossDef || crossDef->returnType() != ElementaryType::Vec3)
+        return EXIT_FAILURE;
+
+    if (env.parse("sq(2)")->returnType() != ElementaryType::Integer || env.parse("sq(2.0)")->returnType() != ElementaryType::Number)
+        return EXIT_FAILURE;
+
+    // Implicit casts of arguments are handled by the transpiler
+    IndexVisitor visitor(env);
+    const Number value = env.transpile(env.parse("scale(sq(1.5), 4) + sq(2.0)"), &visitor);
+    if (visitor.mFailed || value != 1.5 * 1.5 * 4 + 4)
+        return EXIT_FAILURE;
+
+    // Compile without any resolver
+    auto program = env.compile(env.parse("cross(a, b) * pick(len(s) > 3, scale(0.5, len(s)), -1.0)"), nullptr);
+    if (!program || program->resultType() != ElementaryType::Vec3)
+        return EXIT_FAILURE;
+
+    const std::string longStr  = "abcd";
+    const std::string shortStr = "ab";
+    VirtualMachine vm(program);
+    vm.setVec3(program->variableIndex("a"), Vec3{ 1, 0, 0 });
+    vm.setVec3(program->variableIndex("b"), Vec3{ 0, 1, 0 });
+    vm.setString(program->variableIndex("s"), &longStr);
+    vm.run();
+    if (vm.resultVec3() != Vec3{ 0, 0, 2 })
+        return EXIT_FAILURE;
+
+    vm.setString(program->variableIndex("s"), &shortStr);
+    vm.run();
+    if (vm.resultVec3() != Vec3{ 0, 0, -1 })
+        return EXIT_FAILURE;
+
+    // Unbound functions still require a resolver
+    env.registerFunction(FunctionDef("unbound", ElementaryType::Number, {}));
+    DiagnosticList diagnostics;
+    if (env.compile(env.parse("unbound()"), nullptr, &diagnostics) || !diagnostics.hasError())
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
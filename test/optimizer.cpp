@@ -0,0 +1,111 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+static bool check(const Environment& env, const std::string& src, const std::string& expected, const OptimizeOptions& options = OptimizeOptions())
+{
+    auto expr = env.parse(src);
+    if (!expr)
+        return false;
+
+    const std::string before = StringVisitor::visit(expr);
+    auto optimized           = env.optimize(expr, options);
+    const std::string result = StringVisitor::visit(optimized);
+    if (result != expected) {
+        std::cout << src << " optimized to " << result << " but expected " << expected << std::endl;
+        return false;
+    }
+
+    // The input tree is not modified
+    return StringVisitor::visit(expr) == before && optimized->returnType() == expr->returnType();
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("n", ElementaryType::Integer));
+    env.registerVariable(VariableDef("b", ElementaryType::Boolean));
+    env.registerVariable(VariableDef("v", ElementaryType::Vec3));
+    env.registerNative("vec3", [](Number a, Number b, Number c) { return Vec3{ a, b, c }; }, true);
+    env.registerNative("dot", [](const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }, true);
+    env.registerNative("noise", []() { return 0.5; });
+    MathLibrary::registerFunctions(env);
+
+    OptimizeOptions options;
+    options.Resolver = MathLibrary::resolveNative;
+
+    // Constant folding
+    if (!check(env, "1 + 2 * 3", "7")
+        || !check(env, "7 / 2", "3")
+        || !check(env, "2^3 + 1.5", "9.500000")
+        || !check(env, "'a' == 'a' && 1 < 2", "true")
+        || !check(env, "vec3(1, 2, 3).y * x", "(2.000000)*(x)")
+        || !check(env, "v * vec3(1 + 1, 2, 3)", "(v)*(vec3(2,2,3))")
+        || !check(env, "dot(vec3(1, 2, 3), vec3(1, 1, 1))", "6.000000")
+        || !check(env, "exp(0) * x", "x", options))
+        return EXIT_FAILURE;
+
+    // Mixed 'int' and 'num' equality is folded as 'num'
+    if (!check(env, "1 == 1.0", "true")
+        || !check(env, "1.0 == 1", "true")
+        || !check(env, "1 != 1.0", "false")
+        || !check(env, "2 == 2.5", "false")
+        || !check(env, "2.5 != 2", "true"))
+        return EXIT_FAILURE;
+
+    // Overflowing integer arithmetic folds to the wrapped around result of the evaluators
+    if (!check(env, "9223372036854775807 + 1", "-9223372036854775808")
+        || !check(env, "-(9223372036854775807 + 1)", "-9223372036854775808")
+        || !check(env, "4611686018427387904 * 4", "0")
+        || !check(env, "3037000500 * 3037000500", "-9223372036709301616")
+        || !check(env, "10 ^ 100", "0")
+        || !check(env, "3 ^ 41", "-420491770248316829")
+        || !check(env, "2 ^ (0 - 1)", "0"))
+        return EXIT_FAILURE;
+
+    // Impure functions, unresolved natives and integer divisions by zero are kept
+    if (!check(env, "noise() + 1", "(noise())+(1)")
+        || !check(env, "exp(0) * x", "(exp(0))*(x)")
+        || !check(env, "n / (1 - 1)", "(n)/(0)")
+        || !check(env, "n % 0", "(n)%(0)"))
+        return EXIT_FAILURE;
+
+    // Identities
+    if (!check(env, "x * 1 + 0", "x")
+        || !check(env, "1 * v / 1", "v")
+        || !check(env, "n - 0", "n")
+        || !check(env, "!!b", "b")
+        || !check(env, "--x", "x")
+        || !check(env, "+x", "x")
+        || !check(env, "b && true || false", "b")
+        || !check(env, "n * 1.0", "(n)*(1.000000)")) // Conversion to 'num' has to be kept
+        return EXIT_FAILURE;
+
+    OptimizeOptions noFolding;
+    noFolding.FoldConstants = false;
+    if (!check(env, "--x * (1 + 1)", "(x)*((1)+(1))", noFolding))
+        return EXIT_FAILURE;
+
+    // Optimized trees behave the same
+    const auto expr = env.parse("dot(v * (3 - 2), vec3(0.5 * 2, 0, -(-1))) + x * (2^2) - 0");
+    auto original   = env.compile(expr, nullptr);
+    auto optimized  = env.compile(env.optimize(expr), nullptr);
+    if (!original || !optimized || optimized->instructions().size() >= original->instructions().size())
+        return EXIT_FAILURE;
+
+    VirtualMachine vm1(original);
+    VirtualMachine vm2(optimized);
+    for (int i = 0; i < 8; ++i) {
+        vm1.setVec3(original->variableIndex("v"), Vec3{ (Number)i, 1, -2 });
+        vm1.setNumber(original->variableIndex("x"), i * 0.3);
+        vm2.setVec3(optimized->variableIndex("v"), Vec3{ (Number)i, 1, -2 });
+        vm2.setNumber(optimized->variableIndex("x"), i * 0.3);
+        vm1.run();
+        vm2.run();
+        if (vm1.resultNumber() != vm2.resultNumber())
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
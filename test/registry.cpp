@@ -0,0 +1,80 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("Pi", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerFunction(FunctionDef("sin", ElementaryType::Number, { ElementaryType::Number }));
+    env.registerFunction(FunctionDef("sin", ElementaryType::Vec2, { ElementaryType::Vec2 }));
+    env.registerFunction(FunctionDef("mix", ElementaryType::Number, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }));
+    env.registerFunction(FunctionDef("f", ElementaryType::Number, { ElementaryType::Integer, ElementaryType::Number }));
+    env.registerFunction(FunctionDef("f", ElementaryType::Number, { ElementaryType::Number, ElementaryType::Integer }));
+
+    size_t callbacks = 0;
+    const VariableLookupFunction varLookup = [&](const VariableLookup& lkp) -> std::optional<VariableDef> {
+        ++callbacks;
+        if (lkp.name() == "dyn")
+            return VariableDef(lkp.name(), ElementaryType::Integer);
+        return {};
+    };
+
+    // Lookups can be constructed directly, e.g., to test a callback
+    const std::string dynName = "dyn";
+    if (!varLookup(VariableLookup(Location(0), dynName)) || callbacks != 1)
+        return EXIT_FAILURE;
+    callbacks = 0;
+
+    env.registerVariableLookupFunction(varLookup);
+
+    // Overloads with exact and converted signatures
+    auto ast = env.parse("sin(uv) * (sin(1) + mix(Pi, 1, 2))");
+    if (!ast || ast->returnType() != ElementaryType::Vec2 || callbacks != 0)
+        return EXIT_FAILURE;
+
+    // Fallback to lookup functions
+    ast = env.parse("dyn + 1");
+    if (!ast || ast->returnType() != ElementaryType::Integer || callbacks != 1)
+        return EXIT_FAILURE;
+
+    // Exact matches are preferred, but conversions to multiple overloads are ambiguous
+    if (!env.parse("f(1, 2.0)") || !env.parse("f(1.0, 2)"))
+        return EXIT_FAILURE;
+    if (env.parse("f(1, 2)") || env.parse("sin(1, 2)"))
+        return EXIT_FAILURE;
+
+    // Memoization of lookup functions
+    size_t funcCallbacks = 0;
+    const FunctionLookupFunction funcLookup = [&](const FunctionLookup& lkp) -> std::optional<FunctionDef> {
+        ++funcCallbacks;
+        if (lkp.name() == "noise" && lkp.matchParameter({ ElementaryType::Vec2 }))
+            return FunctionDef(lkp.name(), ElementaryType::Number, { ElementaryType::Vec2 });
+        return {};
+    };
+
+    const std::string noiseName                   = "noise";
+    const std::vector<ElementaryType> noiseParams = { ElementaryType::Vec2 };
+    if (!funcLookup(FunctionLookup(Location(0), noiseName, noiseParams)) || funcCallbacks != 1)
+        return EXIT_FAILURE;
+    funcCallbacks = 0;
+
+    env.registerFunctionLookupFunction(funcLookup);
+    env.enableFunctionCache();
+
+    for (int i = 0; i < 3; ++i) {
+        if (!env.parse("noise(uv) + noise(uv * 2)"))
+            return EXIT_FAILURE;
+    }
+
+    auto stats = env.functionCacheStatistics();
+    if (funcCallbacks != 1 || stats.Misses != 1 || stats.Hits != 5 || stats.Entries != 1)
+        return EXIT_FAILURE;
+
+    // Registering invalidates the cache
+    env.registerFunction(FunctionDef("g", ElementaryType::Number, {}));
+    if (env.functionCacheStatistics().Entries != 0 || !env.parse("noise(uv) + g()") || funcCallbacks != 2)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
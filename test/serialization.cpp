@@ -0,0 +1,264 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+// Hand written binary expression data, see Environment::serialize for the layout
+class RawData {
+public:
+    inline uint32 string(const std::string& str)
+    {
+        u32(mStrings, (uint32)str.size());
+        mStrings += str;
+        return mStringCount++;
+    }
+
+    inline uint32 variable(ElementaryType type, const std::string& name)
+    {
+        header(ExpressionType::Variable, type);
+        u32(mNodes, string(name));
+        mNodes += (char)1; // Has definition
+        return mNodeCount++;
+    }
+
+    inline uint32 binary(ElementaryType type, BinaryOperation op, uint32 left, uint32 right)
+    {
+        header(ExpressionType::Binary, type);
+        mNodes += (char)op;
+        u32(mNodes, left);
+        u32(mNodes, right);
+        return mNodeCount++;
+    }
+
+    inline uint32 call(ElementaryType type, const std::string& name, const std::vector<ElementaryType>& params, const std::vector<uint32>& args)
+    {
+        header(ExpressionType::Call, type);
+        u32(mNodes, string(name));
+        mNodes += (char)3; // Has definition, pure
+        mNodes += (char)type;
+        u32(mNodes, (uint32)params.size());
+        for (auto param : params)
+            mNodes += (char)param;
+        u32(mNodes, (uint32)args.size());
+        for (uint32 arg : args)
+            u32(mNodes, arg);
+        return mNodeCount++;
+    }
+
+    inline uint32 access(ElementaryType type, uint32 inner, const std::string& swizzle)
+    {
+        header(ExpressionType::Access, type);
+        u32(mNodes, string(swizzle));
+        u32(mNodes, inner);
+        return mNodeCount++;
+    }
+
+    inline std::string finish(uint32 root) const
+    {
+        std::string data = "PXAB";
+        u32(data, 1);
+        u32(data, mStringCount);
+        u32(data, mNodeCount);
+        u32(data, 1);
+        data += mStrings + mNodes;
+        u32(data, root);
+        return data;
+    }
+
+private:
+    static inline void u32(std::string& out, uint32 value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out += (char)((value >> (8 * i)) & 0xFF);
+    }
+
+    inline void header(ExpressionType kind, ElementaryType type)
+    {
+        mNodes += (char)kind;
+        mNodes += (char)type;
+        u32(mNodes, 0);
+    }
+
+    std::string mStrings;
+    std::string mNodes;
+    uint32 mStringCount = 0;
+    uint32 mNodeCount   = 0;
+};
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerVariable(VariableDef("name", ElementaryType::String));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerNative("noise", [](Number v) { return v; });
+
+    const std::vector<std::string> sources = {
+        "sin(x*2) + uv.y",
+        "-uv.yx * 0.5",
+        "!(x == 1) && name != 'test'",
+        "noise(x) ^ 3.5 + 7 % 2",
+        "sin(x*2) * 4",
+    };
+
+    std::vector<Ptr<Expression>> exprs;
+    for (const auto& src : sources) {
+        exprs.push_back(env.parse(src));
+        if (!exprs.back()) {
+            std::cout << "Could not parse " << src << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string data = Environment::serialize(exprs);
+
+    // Restored trees are structurally identical, including the resolved definitions
+    DiagnosticList diagnostics;
+    ParseOptions options;
+    options.Diagnostics = &diagnostics;
+    const auto restored = env.deserialize(data, options);
+    if (!restored.has_value() || restored->size() != exprs.size()) {
+        std::cout << "Could not restore expressions" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < exprs.size(); ++i) {
+        if (fingerprint(exprs[i]) != fingerprint(restored->at(i)) || StringVisitor::visit(exprs[i]) != StringVisitor::visit(restored->at(i))) {
+            std::cout << sources[i] << " was restored as " << StringVisitor::visit(restored->at(i)) << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto call = std::static_pointer_cast<CallExpression>(std::static_pointer_cast<BinaryExpression>(restored->at(0))->left());
+    if (!call->definition().has_value() || !call->definition()->hasNative() || !call->definition()->isPure()) {
+        std::cout << "Function definition was not resolved" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Shared subtrees are written once
+    ParseOptions internOptions;
+    internOptions.Interner = std::make_shared<ExpressionInterner>();
+    std::vector<Ptr<Expression>> interned;
+    for (const auto& src : sources)
+        interned.push_back(env.parse(src, internOptions));
+    if (Environment::serialize(interned).size() >= data.size()) {
+        std::cout << "Shared subtrees were not deduplicated" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Files are memory mapped
+    const auto path = std::filesystem::temp_directory_path() / "pexpr_serialization_test.pxab";
+    if (!Environment::serializeToFile(path, exprs)) {
+        std::cout << "Could not write file" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto fromFile = env.deserializeFile(path);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (!fromFile.has_value() || fingerprint(fromFile->at(3)) != fingerprint(exprs[3])) {
+        std::cout << "Could not restore expressions from file" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Missing definitions are detected, unless the stored ones are used
+    Environment other;
+    other.registerVariable(VariableDef("x", ElementaryType::Integer));
+    diagnostics.clear();
+    if (other.deserialize(data, options).has_value() || !diagnostics.hasError()) {
+        std::cout << "Missing definitions were not detected" << std::endl;
+        return EXIT_FAILURE;
+    }
+    options.UseStoredDefinitions = true;
+    if (!other.deserialize(data, options).has_value()) {
+        std::cout << "Stored definitions were not used" << std::endl;
+        return EXIT_FAILURE;
+    }
+    options.UseStoredDefinitions = false;
+
+    // Stored types violating the type rules are rejected, also if the stored definitions are used
+    {
+        using T = ElementaryType;
+        std::vector<std::pair<std::string, std::string>> invalid;
+
+        const auto withSwizzle = [](T type, const std::string& swizzle) {
+            RawData raw;
+            return raw.finish(raw.access(type, raw.variable(T::Vec2, "uv"), swizzle));
+        };
+        invalid.emplace_back("Out of range swizzle", withSwizzle(T::Vec2, "ww"));
+        invalid.emplace_back("Empty swizzle", withSwizzle(T::Number, ""));
+        invalid.emplace_back("Too long swizzle", withSwizzle(T::Vec4, "xyxyx"));
+        invalid.emplace_back("Unknown swizzle", withSwizzle(T::Vec2, "xq"));
+        invalid.emplace_back("Mismatching swizzle type", withSwizzle(T::Vec3, "xy"));
+
+        const auto withArgs = [](const std::vector<std::string>& args) {
+            RawData raw;
+            std::vector<uint32> nodes;
+            for (const auto& arg : args)
+                nodes.push_back(raw.variable(arg == "name" ? T::String : T::Number, arg));
+            return raw.finish(raw.call(T::Number, "sin", { T::Number }, nodes));
+        };
+        invalid.emplace_back("Too many arguments", withArgs({ "x", "x" }));
+        invalid.emplace_back("Too few arguments", withArgs({}));
+        invalid.emplace_back("Mismatching argument", withArgs({ "name" }));
+
+        const auto withBinary = [](T type, BinaryOperation op, T right) {
+            RawData raw;
+            const uint32 x = raw.variable(T::Number, "x");
+            return raw.finish(raw.binary(type, op, x, raw.variable(right, right == T::String ? "name" : "x")));
+        };
+        invalid.emplace_back("Mismatching operand", withBinary(T::Number, BinaryOperation::Add, T::String));
+        invalid.emplace_back("Mismatching result", withBinary(T::Number, BinaryOperation::Less, T::Number));
+
+        // The hand written data is valid otherwise
+        if (!env.deserialize(withSwizzle(T::Vec2, "yx"), options).has_value()
+            || !env.deserialize(withArgs({ "x" }), options).has_value()
+            || !env.deserialize(withBinary(T::Boolean, BinaryOperation::Less, T::Number), options).has_value()) {
+            std::cout << "Valid hand written data was rejected" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        for (const auto& [what, invalidData] : invalid) {
+            for (bool useStored : { false, true }) {
+                options.UseStoredDefinitions = useStored;
+                diagnostics.clear();
+                if (env.deserialize(invalidData, options).has_value() || !diagnostics.hasError()) {
+                    std::cout << what << " was accepted" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        options.UseStoredDefinitions = false;
+    }
+
+    // Deeply shared subtrees are handled in linear time, also when interned
+    {
+        RawData raw;
+        uint32 node = raw.variable(ElementaryType::Number, "x");
+        for (int i = 0; i < 64; ++i)
+            node = raw.binary(ElementaryType::Number, BinaryOperation::Add, node, node);
+
+        ParseOptions dagOptions;
+        dagOptions.Interner = std::make_shared<ExpressionInterner>();
+        const auto dag      = env.deserialize(raw.finish(node), dagOptions);
+        if (!dag.has_value() || dagOptions.Interner->size() != 65) {
+            std::cout << "Shared subtrees were not restored" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Corrupted data is rejected
+    for (size_t size = 0; size < data.size(); size += 7) {
+        if (env.deserialize(std::string_view(data.data(), size), options).has_value()) {
+            std::cout << "Truncated data was accepted" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::string corrupted = data;
+    corrupted[4]          = 42;
+    if (env.deserialize(corrupted, options).has_value()) {
+        std::cout << "Unknown version was accepted" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
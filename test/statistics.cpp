@@ -0,0 +1,80 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+    env.registerVariableLookupFunction([](const VariableLookup& lookup) -> std::optional<VariableDef> {
+        if (lookup.name() == "y")
+            return VariableDef("y", ElementaryType::Number);
+        return {};
+    });
+    env.registerFunctionLookupFunction([](const FunctionLookup& lookup) -> std::optional<FunctionDef> {
+        if (lookup.name() == "f" && lookup.parameters().size() == 1)
+            return FunctionDef("f", ElementaryType::Number, { ElementaryType::Number });
+        return {};
+    });
+    env.enableFunctionCache();
+
+    // Nothing is recorded while disabled
+    env.parse("sin(x*2) + uv.x");
+    if (env.isStatisticsEnabled() || env.statistics().Nodes != 0 || env.statistics().Tokens != 0) {
+        std::cout << "Statistics recorded while disabled" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    env.enableStatistics();
+    const auto expr = env.parse("sin(x*2) + uv.x");
+    auto stats      = env.statistics();
+    if (!expr || stats.Nodes != 7 || stats.Tokens < 10 || stats.Errors != 0) {
+        std::cout << "Unexpected counters " << stats.Nodes << " nodes, " << stats.Tokens << " tokens, " << stats.Errors << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (stats.LexNanoseconds + stats.ParseNanoseconds == 0 || stats.TypeCheckNanoseconds == 0 || stats.TranspileNanoseconds != 0) {
+        std::cout << "Unexpected timings" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!env.compile(expr, NativeResolver()) || env.statistics().TranspileNanoseconds == 0) {
+        std::cout << "Compilation was not timed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Lookup functions are only called for unregistered names, the second call of f is served by the cache
+    env.resetStatistics();
+    env.parse("y + f(x) + f(y)");
+    stats = env.statistics();
+    if (stats.Nodes != 7 || stats.VariableLookups != 2 || stats.FunctionLookups != 1 || stats.CacheHits != 1) {
+        std::cout << "Unexpected lookup counters " << stats.VariableLookups << " variables, " << stats.FunctionLookups << " functions, " << stats.CacheHits << " hits" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Syntax and type errors
+    env.resetStatistics();
+    DiagnosticList diagnostics;
+    ParseOptions options;
+    options.Diagnostics = &diagnostics;
+    env.parse("x +", options);
+    env.parse("x && uv", options);
+    if (env.statistics().Errors != 2 || !diagnostics.hasError()) {
+        std::cout << "Errors were not counted" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Counters are shared between threads
+    env.resetStatistics();
+    const std::vector<std::string_view> sources(64, "x + 1");
+    BatchParseOptions batchOptions;
+    batchOptions.ThreadCount = 4;
+    env.parseBatch(sources, batchOptions);
+    if (env.statistics().Nodes != 3 * sources.size()) {
+        std::cout << "Counters of the batch are incomplete" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#include "PExpr.h"
+
+#include <sstream>
+
+using namespace PExpr;
+
+static size_t countEvents(const std::vector<TraceRecorder::Event>& events, std::string_view name)
+{
+    return std::count_if(events.begin(), events.end(), [&](const TraceRecorder::Event& event) { return name == event.Name; });
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerNative("sin", [](Number v) { return std::sin(v); }, true);
+
+    auto recorder = std::make_shared<TraceRecorder>(42);
+    env.setTraceRecorder(recorder);
+
+    const auto expr = env.parse("sin(x*2) + uv.x");
+    if (!expr || !env.compile(expr, NativeResolver())) {
+        std::cout << "Could not compile expression" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Type checking is nested inside the parse span, which ends last
+    auto events = recorder->events();
+    if (events.size() != 3 || events[0].Name != std::string_view("typecheck") || events[1].Name != std::string_view("parse") || events[2].Name != std::string_view("transpile")) {
+        std::cout << "Unexpected events" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (const auto& event : events) {
+        if (event.Id != expr.get() || event.Size != 7 || event.End < event.Start || event.Thread != 1) {
+            std::cout << "Event '" << event.Name << "' has unexpected id or size " << event.Size << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (events[1].Start > events[0].Start || events[1].End < events[0].End) {
+        std::cout << "Type checking is not nested inside parsing" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Failed parse calls are recorded without id
+    recorder->clear();
+    DiagnosticList diagnostics;
+    ParseOptions options;
+    options.Diagnostics = &diagnostics;
+    env.parse("x +", options);
+    events = recorder->events();
+    if (events.size() != 1 || events[0].Id != nullptr) {
+        std::cout << "Failed parse was not recorded" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Lookups are optional
+    recorder->clear();
+    env.setTraceRecorder(recorder, true);
+    env.parse("sin(x) + sin(uv.y)");
+    events = recorder->events();
+    if (countEvents(events, "lookupVariable") != 2 || countEvents(events, "lookupFunction") != 2 || countEvents(events, "parse") != 1) {
+        std::cout << "Lookups were not recorded" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::stringstream stream;
+    recorder->write(stream);
+    const std::string json = stream.str();
+    if (json.rfind("{\"traceEvents\":[", 0) != 0
+        || json.find("\"name\":\"lookupFunction\",\"cat\":\"pexpr\",\"ph\":\"X\"") == std::string::npos
+        || json.find("\"pid\":42,\"tid\":1") == std::string::npos
+        || json.find("\"detail\":\"sin\"") == std::string::npos) {
+        std::cout << "Unexpected trace output:" << std::endl
+                  << json << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Threads of a batch get their own tracks
+    recorder->clear();
+    const std::vector<std::string_view> sources(32, "x + 1");
+    BatchParseOptions batchOptions;
+    batchOptions.ThreadCount = 2;
+    env.parseBatch(sources, batchOptions);
+    if (countEvents(recorder->events(), "parse") != sources.size()) {
+        std::cout << "Batch was not recorded completely" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Nothing is recorded without a recorder
+    recorder->clear();
+    env.setTraceRecorder(nullptr);
+    env.parse("x + 1");
+    if (recorder->eventCount() != 0) {
+        std::cout << "Recorded while disabled" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
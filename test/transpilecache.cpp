@@ -0,0 +1,168 @@
+#include "PExpr.h"
+
+#include <fstream>
+#include <thread>
+
+using namespace PExpr;
+
+// Simple visitor producing a prefix notation of the transpiled operations and counting visited variables
+class DumpVisitor : public TranspileVisitor<std::string> {
+public:
+    std::string onVariable(const std::string& name, ElementaryType) override
+    {
+        ++Visits;
+        return name;
+    }
+    std::string onInteger(Integer v) override { return std::to_string(v); }
+    std::string onNumber(Number v) override { return std::to_string(v); }
+    std::string onBool(bool v) override { return v ? "true" : "false"; }
+    std::string onString(const std::string& v) override { return "'" + v + "'"; }
+    std::string onCast(const std::string& v, ElementaryType, ElementaryType) override { return "cast(" + v + ")"; }
+    std::string onPosNeg(bool isNeg, ElementaryType, const std::string& v) override { return (isNeg ? "neg(" : "pos(") + v + ")"; }
+    std::string onNot(const std::string& v) override { return "not(" + v + ")"; }
+    std::string onAddSub(bool isSub, ElementaryType, const std::string& a, const std::string& b) override { return (isSub ? "sub(" : "add(") + a + "," + b + ")"; }
+    std::string onMulDiv(bool isDiv, ElementaryType, const std::string& a, const std::string& b) override { return (isDiv ? "div(" : "mul(") + a + "," + b + ")"; }
+    std::string onScale(bool isDiv, ElementaryType, const std::string& a, const std::string& f) override { return (isDiv ? "sdiv(" : "smul(") + a + "," + f + ")"; }
+    std::string onPow(ElementaryType, const std::string& a, const std::string& f) override { return "pow(" + a + "," + f + ")"; }
+    std::string onMod(const std::string& a, const std::string& b) override { return "mod(" + a + "," + b + ")"; }
+    std::string onAndOr(bool isOr, const std::string& a, const std::string& b) override { return (isOr ? "or(" : "and(") + a + "," + b + ")"; }
+    std::string onRelOp(RelationalOp op, ElementaryType, const std::string& a, const std::string& b) override { return "rel" + std::to_string((int)op) + "(" + a + "," + b + ")"; }
+    std::string onEqual(bool isNeg, ElementaryType, const std::string& a, const std::string& b) override { return (isNeg ? "neq(" : "eq(") + a + "," + b + ")"; }
+    std::string onFunctionCall(const std::string& name, ElementaryType, const std::vector<ElementaryType>&, const std::vector<std::string>& args) override
+    {
+        std::string str = name + "(";
+        for (const auto& arg : args)
+            str += arg + ";";
+        return str + ")";
+    }
+    std::string onAccess(const std::string& v, size_t, const std::vector<uint8>& perm) override
+    {
+        std::string str = v + ".";
+        for (auto p : perm)
+            str += std::to_string(p);
+        return str;
+    }
+
+    size_t Visits = 0;
+};
+
+int main(int, char**)
+{
+    const auto directory = std::filesystem::temp_directory_path() / "pexpr_transpilecache_test";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+
+    const auto expr = env.parse("x*2 + uv.y");
+    const std::string expected = "add(mul(x,cast(2)),uv.1)";
+
+    {
+        TranspileCache cache(directory);
+        DumpVisitor visitor;
+        if (env.transpile(expr, &visitor, cache, "dump-v1") != expected || visitor.Visits != 2 || cache.misses() != 1) {
+            std::cout << "First transpile failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A new instance, e.g., after a restart, does not need the visitor. Whitespace is irrelevant
+    {
+        TranspileCache cache(directory);
+        DumpVisitor visitor;
+        if (env.transpile(env.parse(" x * 2 +uv.y "), &visitor, cache, "dump-v1") != expected || visitor.Visits != 0 || cache.hits() != 1) {
+            std::cout << "Cached payload was not used" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Different backend keys and options are separate entries
+        if (env.transpile(expr, &visitor, cache, "dump-v2") != expected || visitor.Visits != 2) {
+            std::cout << "Backend key was ignored" << std::endl;
+            return EXIT_FAILURE;
+        }
+        TranspileOptions options;
+        options.EliminateCommonSubexpressions = true;
+        if (env.transpile(expr, &visitor, cache, "dump-v1", options) != expected || visitor.Visits != 4) {
+            std::cout << "Options were ignored" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Least recently used entries are evicted
+    {
+        TranspileCache cache(directory, 300);
+        cache.clear();
+
+        const Fingerprint a = fingerprint(env.parse("x"));
+        const Fingerprint b = fingerprint(env.parse("x+1"));
+        const Fingerprint c = fingerprint(env.parse("x+2"));
+        const std::string data(100, 'a');
+
+        cache.store(a, "key", data);
+        cache.store(b, "key", data);
+        if (!cache.load(a, "key").has_value()) {
+            std::cout << "Stored entry not found" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Make b the least recently used entry independent of the resolution of the file system time
+        std::filesystem::last_write_time(directory / (b.combine("key").toString() + ".pxtc"), std::filesystem::file_time_type::clock::now() - std::chrono::hours(1), ec);
+
+        cache.store(c, "key", data);
+        if (cache.evictions() != 1 || cache.load(b, "key").has_value() || !cache.load(a, "key").has_value() || !cache.load(c, "key").has_value()) {
+            std::cout << "Wrong entry evicted" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (cache.sizeBytes() > cache.maxBytes()) {
+            std::cout << "Cache exceeds limit" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Concurrent stores stay consistent and within the limit once all writers are done
+    {
+        TranspileCache cache(directory, 1000);
+        cache.clear();
+
+        std::vector<Fingerprint> prints;
+        for (int i = 0; i < 32; ++i)
+            prints.push_back(fingerprint(env.parse("x+" + std::to_string(i))));
+        const std::string data(100, 'a');
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < prints.size(); i += 4)
+                    cache.store(prints[i], "key", data);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        if (cache.sizeBytes() > cache.maxBytes() || cache.evictions() == 0) {
+            std::cout << "Concurrent stores exceed limit" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Temporaries of crashed writers are removed once they are old enough, young ones might belong to running writers
+    {
+        const auto stale = directory / "0123.pxtc.tmp42_0";
+        const auto young = directory / "4567.pxtc.tmp42_1";
+        std::ofstream(stale) << "partial";
+        std::ofstream(young) << "partial";
+        std::filesystem::last_write_time(stale, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1), ec);
+
+        TranspileCache cache(directory);
+        if (std::filesystem::exists(stale) || !std::filesystem::exists(young)) {
+            std::cout << "Temporary files were not swept correctly" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::filesystem::remove_all(directory, ec);
+    return EXIT_SUCCESS;
+}
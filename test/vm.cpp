@@ -0,0 +1,147 @@
+#include "PExpr.h"
+
+using namespace PExpr;
+
+static NativeFunction resolveNative(const FunctionDef& def)
+{
+    if (def.name() == "sin" && def.returnType() == ElementaryType::Number)
+        return [](const Cell* args, Cell* result) { result[0].Num = std::sin(args[0].Num); };
+    if (def.name() == "vec3")
+        return [](const Cell* args, Cell* result) {
+            for (int i = 0; i < 3; ++i)
+                result[i].Num = args[i].Num;
+        };
+    if (def.name() == "len")
+        return [](const Cell* args, Cell* result) { result[0].Int = (Integer)args[0].Str->size(); };
+    return {};
+}
+
+static std::optional<FunctionDef> functionLookup(const FunctionLookup& lkp)
+{
+    if (lkp.name() == "vec3" && lkp.matchParameter({ ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }))
+        return FunctionDef("vec3", ElementaryType::Vec3, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number });
+    if (lkp.name() == "sin" && lkp.matchParameter({ ElementaryType::Number }))
+        return FunctionDef("sin", ElementaryType::Number, { ElementaryType::Number });
+    if (lkp.name() == "len" && lkp.matchParameter({ ElementaryType::String }))
+        return FunctionDef("len", ElementaryType::Integer, { ElementaryType::String });
+    if (lkp.name() == "cos" && lkp.matchParameter({ ElementaryType::Number }))
+        return FunctionDef("cos", ElementaryType::Number, { ElementaryType::Number });
+    return {};
+}
+
+static Ptr<Program> compile(const Environment& env, const std::string& str)
+{
+    auto expr = env.parse(str);
+    if (!expr)
+        return nullptr;
+    return env.compile(expr, resolveNative);
+}
+
+int main(int, char**)
+{
+    Environment env;
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("n", ElementaryType::Integer));
+    env.registerVariable(VariableDef("v", ElementaryType::Vec3));
+    env.registerFunctionLookupFunction(functionLookup);
+
+    // Arithmetic with implicit casts and natives
+    auto program = compile(env, "sin(x) * 2 + n / 2 - 1.5^2");
+    if (!program || program->resultType() != ElementaryType::Number)
+        return EXIT_FAILURE;
+
+    VirtualMachine vm(program);
+    for (int i = 0; i < 10; ++i) {
+        vm.setNumber(program->variableIndex("x"), i * 0.5);
+        vm.setInteger(program->variableIndex("n"), i);
+        vm.run();
+        if (std::abs(vm.resultNumber() - (std::sin(i * 0.5) * 2 + (i / 2) - std::pow(1.5, 2))) > 1e-12)
+            return EXIT_FAILURE;
+    }
+
+    // Vectors, swizzles and arguments requiring a move and a cast
+    program = compile(env, "(vec3(1, x, sin(2)) * 2 + v).zyx + v.xxx");
+    if (!program || program->resultType() != ElementaryType::Vec3)
+        return EXIT_FAILURE;
+
+    VirtualMachine vm2(program);
+    vm2.setNumber(program->variableIndex("x"), 4);
+    vm2.setVec3(program->variableIndex("v"), Vec3{ 1, 2, 3 });
+    vm2.run();
+    const Vec3 expected = { std::sin(2) * 2 + 3 + 1, 4 * 2 + 2 + 1, 2 + 1 + 1 };
+    if (vm2.resultVec3() != expected)
+        return EXIT_FAILURE;
+
+    // Booleans, integers and strings
+    program = compile(env, "(n % 3 == 1 || !(x > 2)) && \"ab\" != \"cd\" && len(\"abc\") == 3");
+    if (!program || program->resultType() != ElementaryType::Boolean)
+        return EXIT_FAILURE;
+
+    VirtualMachine vm3(program);
+    vm3.setInteger(program->variableIndex("n"), 4);
+    vm3.setNumber(program->variableIndex("x"), 10);
+    vm3.run();
+    if (!vm3.resultBool())
+        return EXIT_FAILURE;
+    vm3.setInteger(program->variableIndex("n"), 5);
+    vm3.run();
+    if (vm3.resultBool())
+        return EXIT_FAILURE;
+
+    // Mixed integer and number operands are compared as numbers
+    for (const auto& [source, result] : std::vector<std::pair<const char*, bool>>{
+             { "n == 1.0", true }, { "1.0 == n", true }, { "n != 1.0", false }, { "1.0 != n", false },
+             { "n == 1.5", false }, { "1.5 != n", true } }) {
+        program = compile(env, source);
+        if (!program)
+            return EXIT_FAILURE;
+
+        VirtualMachine vm4(program);
+        vm4.setInteger(program->variableIndex("n"), 1);
+        vm4.run();
+        if (vm4.resultBool() != result) {
+            std::cout << "Unexpected result of " << source << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Integer division and remainder by zero are defined
+    program = compile(env, "n / (n - 4) + n % (n - 4)");
+    if (!program)
+        return EXIT_FAILURE;
+
+    VirtualMachine vm5(program);
+    vm5.setInteger(program->variableIndex("n"), 4);
+    vm5.run();
+    if (vm5.resultInteger() != 0)
+        return EXIT_FAILURE;
+
+    // Integer arithmetic wraps around on overflow and powers are exact
+    constexpr Integer Max = std::numeric_limits<Integer>::max();
+    constexpr Integer Min = std::numeric_limits<Integer>::min();
+    for (const auto& [source, n, result] : std::vector<std::tuple<const char*, Integer, Integer>>{
+             { "n + 1", Max, Min }, { "n - 1", Min, Max }, { "-n", Min, Min }, { "n * n", 3037000500, -9223372036709301616 },
+             { "2 ^ n", 63, Min }, { "2 ^ n", 64, 0 }, { "3 ^ n", 41, -420491770248316829 }, { "7 ^ n", 100, 3728452490685454945 },
+             { "n ^ 3", -2, -8 }, { "n ^ 0", 0, 1 }, { "3 ^ n", -1, 0 }, { "n ^ (0 - 1)", 0, 0 },
+             { "n ^ (0 - 2)", 1, 1 }, { "n ^ (0 - 3)", -1, -1 }, { "n ^ (0 - 2)", -1, 1 } }) {
+        program = compile(env, source);
+        if (!program)
+            return EXIT_FAILURE;
+
+        VirtualMachine vm6(program);
+        vm6.setInteger(program->variableIndex("n"), n);
+        vm6.run();
+        if (vm6.resultInteger() != result) {
+            std::cout << "Unexpected result " << vm6.resultInteger() << " of " << source << " with n = " << n << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Functions without a native implementation can not be compiled
+    DiagnosticList diagnostics;
+    auto expr = env.parse("cos(x)");
+    if (!expr || env.compile(expr, resolveNative, &diagnostics) != nullptr || !diagnostics.hasError())
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
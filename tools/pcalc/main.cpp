@@ -114,11 +114,23 @@ inline ValueBlock func1Cwise(const ValueBlock& A, ElementaryType fromType, Func
 }
 class CalcVisitor : public TranspileVisitor<ValueBlock> {
 public:
+    CalcVisitor(const Environment& env, const Bindings& bindings)
+        : mEnv(env)
+        , mBindings(bindings)
+    {
+    }
+
     ValueBlock onVariable(const std::string& name, ElementaryType) override
     {
         return Constants.at(name);
     }
 
+    /// All constants are numbers fetched by slot, see main()
+    ValueBlock onSlotVariable(const VariableDef&, uint32 slot) override
+    {
+        return mBindings.getNumber(slot);
+    }
+
     ValueBlock onInteger(Integer v) override { return v; }
     ValueBlock onNumber(Number v) override { return v; }
     ValueBlock onBool(bool v) override { return v; }
@@ -225,40 +237,66 @@ public:
         return isNeg ? !res : res;
     }
 
-    /// name(...). Call to a function. Necessary casts are already handled.
-    ValueBlock onFunctionCall(const std::string& name,
-                              ElementaryType, const std::vector<ElementaryType>& argumentTypes,
-                              const std::vector<ValueBlock>& argumentPayloads) override
+    /// name(...). All functions are bound natively, see registerNatives()
+    ValueBlock onFunctionCall(const std::string&,
+                              ElementaryType, const std::vector<ElementaryType>&,
+                              const std::vector<ValueBlock>&) override
     {
-        using NumFunc = Number (*)(Number);
-        if (name == "vec2") {
-            return Vec2{ std::get<Number>(argumentPayloads[0]), std::get<Number>(argumentPayloads[1]) };
-        } else if (name == "vec3") {
-            return Vec3{ std::get<Number>(argumentPayloads[0]), std::get<Number>(argumentPayloads[1]), std::get<Number>(argumentPayloads[2]) };
-        } else if (name == "vec4") {
-            return Vec4{ std::get<Number>(argumentPayloads[0]), std::get<Number>(argumentPayloads[1]), std::get<Number>(argumentPayloads[2]), std::get<Number>(argumentPayloads[3]) };
-        } else if (name == "sin") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::sin);
-        } else if (name == "cos") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::cos);
-        } else if (name == "tan") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::tan);
-        } else if (name == "asin") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::asin);
-        } else if (name == "acos") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::acos);
-        } else if (name == "atan") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::atan);
-        } else if (name == "exp") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::exp);
-        } else if (name == "log") {
-            return func1Cwise(argumentPayloads[0], argumentTypes[0], (NumFunc)std::log);
-        }
-
         PEXPR_ASSERT(false, "Should not reach this point");
         return Number(0); // Error should be caught in type checking
     }
 
+    /// name(...). Call the bound native by index. Necessary casts are already handled.
+    ValueBlock onResolvedCall(const FunctionDef& def, const std::vector<ValueBlock>& argumentPayloads) override
+    {
+        std::vector<Cell> args;
+        for (const auto& arg : argumentPayloads) {
+            std::visit(
+                [&](auto&& v) {
+                    using T = std::decay_t<decltype(v)>;
+                    Cell cell;
+                    if constexpr (std::is_same_v<T, bool>) {
+                        cell.Bool = v;
+                        args.push_back(cell);
+                    } else if constexpr (std::is_same_v<T, Integer>) {
+                        cell.Int = v;
+                        args.push_back(cell);
+                    } else if constexpr (std::is_same_v<T, Number>) {
+                        cell.Num = v;
+                        args.push_back(cell);
+                    } else if constexpr (std::is_same_v<T, std::string>) {
+                        cell.Str = &v;
+                        args.push_back(cell);
+                    } else {
+                        for (Number c : v) {
+                            cell.Num = c;
+                            args.push_back(cell);
+                        }
+                    }
+                },
+                arg);
+        }
+
+        Cell result[4];
+        mEnv.native(def.nativeIndex())(args.data(), result);
+
+        switch (def.returnType()) {
+        default:
+        case ElementaryType::Number:
+            return result[0].Num;
+        case ElementaryType::Boolean:
+            return result[0].Bool;
+        case ElementaryType::Integer:
+            return result[0].Int;
+        case ElementaryType::Vec2:
+            return Vec2{ result[0].Num, result[1].Num };
+        case ElementaryType::Vec3:
+            return Vec3{ result[0].Num, result[1].Num, result[2].Num };
+        case ElementaryType::Vec4:
+            return Vec4{ result[0].Num, result[1].Num, result[2].Num, result[3].Num };
+        }
+    }
+
     /// a.xyz Access operator for vector types
     ValueBlock onAccess(const ValueBlock& v, size_t inputSize, const std::vector<uint8>& outputPermutation) override
     {
@@ -291,6 +329,10 @@ public:
                          getC(outputPermutation[3]) };
         }
     }
+
+private:
+    const Environment& mEnv;
+    const Bindings& mBindings;
 };
 
 static std::optional<VariableDef> variableLookup(const VariableLookup& lkp)
@@ -300,51 +342,32 @@ static std::optional<VariableDef> variableLookup(const VariableLookup& lkp)
     return {};
 }
 
-static std::optional<FunctionDef> functionLookup(const FunctionLookup& lkp)
+template <size_t N>
+static std::array<Number, N> applyCwise(MathFunction func, const std::array<Number, N>& v)
 {
-    if (lkp.name() == "vec2" && lkp.matchParameter({ ElementaryType::Number, ElementaryType::Number }))
-        return FunctionDef("vec2", ElementaryType::Vec2, { ElementaryType::Number, ElementaryType::Number });
-    if (lkp.name() == "vec3" && lkp.matchParameter({ ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }))
-        return FunctionDef("vec3", ElementaryType::Vec3, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number });
-    if (lkp.name() == "vec4" && lkp.matchParameter({ ElementaryType::Number, ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }))
-        return FunctionDef("vec4", ElementaryType::Vec4, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number, ElementaryType::Number });
-
-    if (lkp.parameters().size() == 1 && isArithmetic(lkp.parameters()[0])) {
-        if (lkp.name() == "sin" || lkp.name() == "cos" || lkp.name() == "tan"
-            || lkp.name() == "asin" || lkp.name() == "acos" || lkp.name() == "atan"
-            || lkp.name() == "exp" || lkp.name() == "log") {
-            ElementaryType type = lkp.parameters()[0] != ElementaryType::Integer ? lkp.parameters()[0] : ElementaryType::Number;
-            return FunctionDef(lkp.name(), type, { type });
-        }
-    }
-
-    return {};
+    std::array<Number, N> ret;
+    for (size_t i = 0; i < N; ++i)
+        ret[i] = MathLibrary::evaluate(func, v[i]);
+    return ret;
 }
 
-int main(int argc, char** argv)
+static void registerNatives(Environment& env)
 {
-    std::string input;
-    for (int i = 1; i < argc; ++i) {
-        input += argv[i];
-        input += " ";
+    env.registerNative("vec2", [](Number x, Number y) { return Vec2{ x, y }; });
+    env.registerNative("vec3", [](Number x, Number y, Number z) { return Vec3{ x, y, z }; });
+    env.registerNative("vec4", [](Number x, Number y, Number z, Number w) { return Vec4{ x, y, z, w }; });
+
+    for (auto name : { "sin", "cos", "tan", "asin", "acos", "atan", "exp", "log" }) {
+        const MathFunction func = MathLibrary::find(name).value();
+        env.registerNative(name, [=](Number x) { return MathLibrary::evaluate(func, x); });
+        env.registerNative(name, [=](const Vec2& v) { return applyCwise(func, v); });
+        env.registerNative(name, [=](const Vec3& v) { return applyCwise(func, v); });
+        env.registerNative(name, [=](const Vec4& v) { return applyCwise(func, v); });
     }
+}
 
-    Environment env;
-    env.registerVariableLookupFunction(variableLookup);
-    env.registerFunctionLookupFunction(functionLookup);
-
-    auto ast = env.parse(input);
-
-    if (ast == nullptr)
-        return EXIT_FAILURE;
-
-#if 0
-    std::cout << StringVisitor::visit(ast) << std::endl;
-#endif
-
-    CalcVisitor visitor;
-    auto ret = env.transpile(ast, &visitor);
-
+static void printValue(const ValueBlock& value)
+{
     std::visit(
         [](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
@@ -363,6 +386,77 @@ int main(int argc, char** argv)
             else if constexpr (std::is_same_v<T, std::string>)
                 std::cout << "'" << arg << "'" << std::endl;
         },
-        ret);
+        value);
+}
+
+int main(int argc, char** argv)
+{
+    // --dump FILE stores the parsed expression in binary form, --load FILE evaluates all expressions stored in FILE instead of parsing the input
+    // --trace FILE writes the spans of all pipeline stages as Chrome trace event JSON
+    std::string input;
+    std::string dumpFile;
+    std::string loadFile;
+    std::string traceFile;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--dump" && i + 1 < argc) {
+            dumpFile = argv[++i];
+        } else if (arg == "--load" && i + 1 < argc) {
+            loadFile = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else {
+            input += argv[i];
+            input += " ";
+        }
+    }
+
+    Environment env;
+    env.registerVariableLookupFunction(variableLookup);
+    registerNatives(env);
+
+    if (!traceFile.empty())
+        env.setTraceRecorder(std::make_shared<TraceRecorder>(), true);
+
+    std::vector<Ptr<Expression>> asts;
+    if (!loadFile.empty()) {
+        auto loaded = env.deserializeFile(loadFile);
+        if (!loaded.has_value())
+            return EXIT_FAILURE;
+        asts = std::move(loaded.value());
+    } else {
+        auto ast = env.parse(input);
+        if (ast == nullptr)
+            return EXIT_FAILURE;
+        asts.push_back(ast);
+    }
+
+    if (!dumpFile.empty() && !Environment::serializeToFile(dumpFile, asts)) {
+        std::cerr << "Could not write " << dumpFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (const auto& ast : asts) {
+#if 0
+        std::cout << StringVisitor::visit(ast) << std::endl;
+#endif
+
+        // Resolve the constants once instead of on every access
+        auto layout = std::make_shared<VariableLayout>();
+        layout->assign(ast);
+
+        Bindings bindings(layout);
+        for (uint32 slot = 0; slot < layout->size(); ++slot)
+            bindings.setNumber(slot, Constants.at(layout->variable(slot).name()));
+
+        CalcVisitor visitor(env, bindings);
+        printValue(env.transpile(ast, &visitor));
+    }
+
+    if (!traceFile.empty() && !env.traceRecorder()->writeToFile(traceFile)) {
+        std::cerr << "Could not write " << traceFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,422 @@
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "PExpr.h"
+
+using namespace PExpr;
+
+/* Generator of random, but well typed expressions following the rules of the type checker.
+ * The vocabulary is fixed, see registerVocabulary(), therefore the output can be checked by an environment with the same definitions.
+ * The same seed and options produce the same output on all platforms.
+ */
+
+struct Options {
+    uint64 Seed        = 1;
+    size_t Nodes       = 100;  // Target number of nodes per expression
+    size_t Count       = 1;    // Number of expressions, one per line
+    size_t MaxDepth    = 32;   // Subtrees deeper than this are replaced by leafs
+    size_t FanOut      = 4;    // Maximum number of operands combined by an operator chain
+    double CallDensity = 0.2;  // Probability of an inner node being a function call
+    double VectorRatio = 0.25; // Probability of scalars being computed in vector space and swizzled back
+    std::string Operators = "+-*/^%";
+    ElementaryType Type   = ElementaryType::Number;
+    bool Check            = false;
+};
+
+static const char* FunctionNames[] = { "sin", "cos", "tan", "exp", "log", "atan" };
+
+static void registerVocabulary(Environment& env)
+{
+    env.registerVariable(VariableDef("x", ElementaryType::Number));
+    env.registerVariable(VariableDef("y", ElementaryType::Number));
+    env.registerVariable(VariableDef("i", ElementaryType::Integer));
+    env.registerVariable(VariableDef("j", ElementaryType::Integer));
+    env.registerVariable(VariableDef("flag", ElementaryType::Boolean));
+    env.registerVariable(VariableDef("name", ElementaryType::String));
+    env.registerVariable(VariableDef("uv", ElementaryType::Vec2));
+    env.registerVariable(VariableDef("pos", ElementaryType::Vec3));
+    env.registerVariable(VariableDef("color", ElementaryType::Vec4));
+
+    for (auto name : FunctionNames) {
+        for (auto type : { ElementaryType::Number, ElementaryType::Vec2, ElementaryType::Vec3, ElementaryType::Vec4 })
+            env.registerFunction(FunctionDef(name, type, { type }));
+    }
+    env.registerFunction(FunctionDef("vec2", ElementaryType::Vec2, { ElementaryType::Number, ElementaryType::Number }));
+    env.registerFunction(FunctionDef("vec3", ElementaryType::Vec3, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }));
+    env.registerFunction(FunctionDef("vec4", ElementaryType::Vec4, { ElementaryType::Number, ElementaryType::Number, ElementaryType::Number, ElementaryType::Number }));
+}
+
+class Generator {
+public:
+    explicit Generator(const Options& options)
+        : mOptions(options)
+        , mRandom(options.Seed)
+        , mNodes(0)
+    {
+        mNumberOps  = filterOps("+-*/^");
+        mIntegerOps = filterOps("+-*/%^");
+        mVectorOps  = filterOps("+-*/");
+    }
+
+    /// Append an expression of the given type with approximately the given number of nodes
+    void generate(std::string& out, ElementaryType type, size_t budget, size_t depth = 0)
+    {
+        if (budget <= 1 || depth >= mOptions.MaxDepth) {
+            leaf(out, type);
+            return;
+        }
+
+        switch (type) {
+        case ElementaryType::Boolean:
+            generateBoolean(out, budget, depth);
+            break;
+        case ElementaryType::Integer:
+            generateInteger(out, budget, depth);
+            break;
+        case ElementaryType::Vec2:
+        case ElementaryType::Vec3:
+        case ElementaryType::Vec4:
+            generateVector(out, type, budget, depth);
+            break;
+        default:
+            generateNumber(out, budget, depth);
+            break;
+        }
+    }
+
+    /// Number of nodes generated so far
+    inline size_t nodes() const { return mNodes; }
+
+private:
+    using OperatorList = std::vector<std::string>;
+
+    /// Restrict the user given operators to the ones allowed for a type. Repetitions are kept, as they weight the choice
+    OperatorList filterOps(const char* allowed) const
+    {
+        OperatorList ops;
+        for (char c : mOptions.Operators) {
+            if (std::strchr(allowed, c))
+                ops.emplace_back(1, c);
+        }
+        if (ops.empty())
+            ops.emplace_back("+");
+        return ops;
+    }
+
+    // Own mappings of the engine output, as the standard distributions are implementation defined
+    inline size_t uniform(size_t n) { return (size_t)(mRandom() % n); }
+    inline double uniform01() { return (double)(mRandom() >> 11) * (1.0 / 9007199254740992.0); }
+    inline bool chance(double p) { return uniform01() < p; }
+    inline const std::string& pick(const OperatorList& ops) { return ops[uniform(ops.size())]; }
+
+    static inline size_t components(ElementaryType type) { return typeArraySize(type); }
+    static inline ElementaryType vectorType(size_t components) { return components == 2 ? ElementaryType::Vec2 : (components == 3 ? ElementaryType::Vec3 : ElementaryType::Vec4); }
+    inline ElementaryType randomVectorType() { return vectorType(2 + uniform(3)); }
+
+    void leaf(std::string& out, ElementaryType type)
+    {
+        ++mNodes;
+        switch (type) {
+        case ElementaryType::Boolean:
+            out += chance(0.5) ? "flag" : (chance(0.5) ? "true" : "false");
+            break;
+        case ElementaryType::Integer:
+            out += chance(0.5) ? (chance(0.5) ? "i" : "j") : std::to_string(1 + uniform(9));
+            break;
+        case ElementaryType::Vec2:
+            out += "uv";
+            break;
+        case ElementaryType::Vec3:
+            out += "pos";
+            break;
+        case ElementaryType::Vec4:
+            out += "color";
+            break;
+        default:
+            if (chance(0.5))
+                out += chance(0.5) ? "x" : "y";
+            else
+                out += std::to_string(uniform(10)) + "." + std::to_string(1 + uniform(99));
+            break;
+        }
+    }
+
+    /// Split the budget of the children evenly
+    static inline size_t share(size_t budget, size_t count, size_t index)
+    {
+        return budget / count + (index < budget % count ? 1 : 0);
+    }
+
+    /// (a op b op c ...) with all operands of the given type. Returns false if the budget is too small
+    bool chain(std::string& out, ElementaryType operandType, const OperatorList& ops, size_t budget, size_t depth)
+    {
+        if (budget < 3)
+            return false;
+
+        const size_t count    = std::min(mOptions.FanOut < 2 ? 2 : mOptions.FanOut, (budget + 1) / 2);
+        const size_t children = budget - (count - 1);
+        mNodes += count - 1;
+
+        out += "(";
+        for (size_t k = 0; k < count; ++k) {
+            if (k > 0) {
+                out += ' ';
+                out += pick(ops);
+                out += ' ';
+            }
+            generate(out, operandType, share(children, count, k), depth + 1);
+        }
+        out += ")";
+        return true;
+    }
+
+    void call(std::string& out, const char* name, const std::vector<ElementaryType>& params, size_t budget, size_t depth)
+    {
+        ++mNodes;
+        out += name;
+        out += "(";
+        const size_t children = std::max<size_t>(budget - 1, params.size());
+        for (size_t k = 0; k < params.size(); ++k) {
+            if (k > 0)
+                out += ", ";
+            generate(out, params[k], share(children, params.size(), k), depth + 1);
+        }
+        out += ")";
+    }
+
+    /// (vec).xyz with a swizzle valid for the random inner vector type
+    void swizzle(std::string& out, size_t outComponents, size_t budget, size_t depth)
+    {
+        static const char* letters = "xyzw";
+
+        const ElementaryType inner = randomVectorType();
+        ++mNodes;
+        out += "(";
+        generate(out, inner, budget - 1, depth + 1);
+        out += ").";
+        for (size_t k = 0; k < outComponents; ++k)
+            out += letters[uniform(components(inner))];
+    }
+
+    void unary(std::string& out, const char* op, ElementaryType type, size_t budget, size_t depth)
+    {
+        ++mNodes;
+        out += op;
+        out += "(";
+        generate(out, type, budget - 1, depth + 1);
+        out += ")";
+    }
+
+    void generateNumber(std::string& out, size_t budget, size_t depth)
+    {
+        if (chance(mOptions.CallDensity))
+            return call(out, FunctionNames[uniform(std::size(FunctionNames))], { ElementaryType::Number }, budget, depth);
+        if (chance(mOptions.VectorRatio))
+            return swizzle(out, 1, budget, depth);
+        if (chance(0.05))
+            return unary(out, "-", ElementaryType::Number, budget, depth);
+
+        // Mixing in integers exercises the implicit conversion. The first operand keeps the chain a number
+        if (budget < 3)
+            return unary(out, "-", ElementaryType::Number, budget, depth);
+
+        const size_t count    = std::min(mOptions.FanOut < 2 ? 2 : mOptions.FanOut, (budget + 1) / 2);
+        const size_t children = budget - (count - 1);
+        mNodes += count - 1;
+
+        out += "(";
+        for (size_t k = 0; k < count; ++k) {
+            if (k > 0) {
+                out += ' ';
+                out += pick(mNumberOps);
+                out += ' ';
+            }
+            const ElementaryType type = (k > 0 && chance(0.2)) ? ElementaryType::Integer : ElementaryType::Number;
+            generate(out, type, share(children, count, k), depth + 1);
+        }
+        out += ")";
+    }
+
+    void generateInteger(std::string& out, size_t budget, size_t depth)
+    {
+        if (chance(0.05) || !chain(out, ElementaryType::Integer, mIntegerOps, budget, depth))
+            unary(out, "-", ElementaryType::Integer, budget, depth);
+    }
+
+    void generateBoolean(std::string& out, size_t budget, size_t depth)
+    {
+        static const char* relations[] = { "<", ">", "<=", ">=", "==", "!=" };
+
+        static const OperatorList logical = { "&&", "||" };
+
+        const size_t choice = uniform(10);
+        if (choice == 0 || budget < 3)
+            return unary(out, "!", ElementaryType::Boolean, budget, depth);
+        if (choice == 1 && budget == 3) {
+            mNodes += 3;
+            out += "(name == 'pexpr')";
+            return;
+        }
+        if (choice < 5 && chain(out, ElementaryType::Boolean, logical, budget, depth))
+            return;
+
+        // Comparisons of numbers or, rarely, equality of vectors
+        const bool vector         = chance(mOptions.VectorRatio * 0.5);
+        const ElementaryType type = vector ? randomVectorType() : ElementaryType::Number;
+        const char* relation      = vector ? (chance(0.5) ? "==" : "!=") : relations[uniform(std::size(relations))];
+        ++mNodes;
+        out += "(";
+        generate(out, type, share(budget - 1, 2, 0), depth + 1);
+        out += ' ';
+        out += relation;
+        out += ' ';
+        generate(out, type, share(budget - 1, 2, 1), depth + 1);
+        out += ")";
+    }
+
+    void generateVector(std::string& out, ElementaryType type, size_t budget, size_t depth)
+    {
+        const size_t size = components(type);
+
+        if (chance(mOptions.CallDensity)) {
+            if (chance(0.5))
+                return call(out, FunctionNames[uniform(std::size(FunctionNames))], { type }, budget, depth);
+            static const char* constructors[] = { "", "", "vec2", "vec3", "vec4" };
+            return call(out, constructors[size], std::vector<ElementaryType>(size, ElementaryType::Number), budget, depth);
+        }
+        if (chance(mOptions.VectorRatio))
+            return swizzle(out, size, budget, depth);
+
+        // vec * f, vec / f, vec ^ f
+        if (chance(0.2) && budget >= 3) {
+            static const char* scales = "*/^";
+            const char op             = scales[uniform(3)];
+            if (mOptions.Operators.find(op) != std::string::npos) {
+                ++mNodes;
+                out += "(";
+                generate(out, type, share(budget - 1, 2, 0), depth + 1);
+                out += ' ';
+                out += op;
+                out += ' ';
+                generate(out, ElementaryType::Number, share(budget - 1, 2, 1), depth + 1);
+                out += ")";
+                return;
+            }
+        }
+
+        if (chance(0.05) || !chain(out, type, mVectorOps, budget, depth))
+            unary(out, "-", type, budget, depth);
+    }
+
+    const Options mOptions;
+    std::mt19937_64 mRandom;
+    size_t mNodes;
+    OperatorList mNumberOps;
+    OperatorList mIntegerOps;
+    OperatorList mVectorOps;
+};
+
+static bool parseType(std::string_view str, ElementaryType& type)
+{
+    static const std::pair<std::string_view, ElementaryType> types[] = {
+        { "bool", ElementaryType::Boolean },
+        { "int", ElementaryType::Integer },
+        { "num", ElementaryType::Number },
+        { "vec2", ElementaryType::Vec2 },
+        { "vec3", ElementaryType::Vec3 },
+        { "vec4", ElementaryType::Vec4 },
+    };
+
+    for (const auto& [name, value] : types) {
+        if (name == str) {
+            type = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "Prints random but well typed expressions, one per line." << std::endl
+              << "  --seed N           Seed of the generator [1]" << std::endl
+              << "  --nodes N          Approximate number of nodes per expression [100]" << std::endl
+              << "  --count N          Number of expressions [1]" << std::endl
+              << "  --depth N          Maximum depth of the trees [32]" << std::endl
+              << "  --fanout N         Maximum number of operands per operator chain [4]" << std::endl
+              << "  --ops STR          Allowed arithmetic operators out of '+-*/^%', repetitions weight them [+-*/^%]" << std::endl
+              << "  --call-density P   Probability of an inner node being a function call [0.2]" << std::endl
+              << "  --vector-ratio P   Probability of using vectors and swizzles [0.25]" << std::endl
+              << "  --type T           Type of the expressions: bool, int, num, vec2, vec3, vec4 [num]" << std::endl
+              << "  --check            Parse and type check each expression, statistics are printed to stderr" << std::endl
+              << "Variables: x, y (num), i, j (int), flag (bool), name (str), uv (vec2), pos (vec3), color (vec4)" << std::endl
+              << "Functions: sin, cos, tan, exp, log, atan for num and vectors; vec2, vec3, vec4 constructors" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool hasValue        = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (arg == "--check") {
+            options.Check = true;
+        } else if (arg == "--seed" && hasValue) {
+            options.Seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--nodes" && hasValue) {
+            options.Nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--count" && hasValue) {
+            options.Count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--depth" && hasValue) {
+            options.MaxDepth = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--fanout" && hasValue) {
+            options.FanOut = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--ops" && hasValue) {
+            options.Operators = argv[++i];
+        } else if (arg == "--call-density" && hasValue) {
+            options.CallDensity = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--vector-ratio" && hasValue) {
+            options.VectorRatio = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--type" && hasValue && parseType(argv[i + 1], options.Type)) {
+            ++i;
+        } else {
+            std::cerr << "Invalid argument '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Environment env;
+    if (options.Check)
+        registerVocabulary(env);
+
+    Generator generator(options);
+    std::string line;
+    size_t failures = 0;
+    for (size_t k = 0; k < options.Count; ++k) {
+        line.clear();
+        generator.generate(line, options.Type, std::max<size_t>(1, options.Nodes));
+
+        if (options.Check) {
+            const auto expr = env.parse(line);
+            if (!expr || expr->returnType() != options.Type) {
+                std::cerr << "Expression " << k << " is not well typed" << std::endl;
+                ++failures;
+            }
+        }
+
+        line += '\n';
+        std::cout.write(line.data(), (std::streamsize)line.size());
+    }
+
+    if (options.Check)
+        std::cerr << options.Count << " expressions, " << generator.nodes() << " nodes, " << failures << " failures" << std::endl;
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}